@@ -0,0 +1,211 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Abstract AVL Tree Template Example 3.
+// Version: 1.6
+
+// This example shows how to use the optional update() member function
+// of the abstractor to create an interval tree, the reservations class.
+// Each reservation of a room is for a time interval.  We want to find
+// all the reservations whose intervals overlap a given time window.
+//
+// The nodes are in order by start time.  Each node also holds the
+// greatest end time of the intervals in its subtree, which update()
+// keeps up to date as the tree changes.  Searching for overlaps can then
+// skip any subtree whose intervals all end before the window starts.
+
+#include <stdio.h>
+
+#include "avl_tree.h"
+
+// Reservations of a room, for half-open intervals [start, end) of time
+// (in minutes).  No two reservations may have the same start time.
+class reservations
+  {
+  private:
+
+    struct node
+      {
+	// Child pointers.
+	node *gt, *lt;
+
+	signed char bf;
+
+	unsigned start, end;
+
+	// Greatest end time of the reservations in the subtree with this
+	// node as its root.
+	unsigned max_end;
+
+	const char *who;
+      };
+
+    // Abstractor class for avl_tree template.
+    struct abstr
+      {
+	typedef node *handle;
+
+	// Key is start time.
+	typedef unsigned key;
+
+	typedef unsigned size;
+
+	static handle get_less(handle h, bool) { return(h->lt); }
+	static void set_less(handle h, handle lh) { h->lt = lh; }
+	static handle get_greater(handle h, bool) { return(h->gt); }
+	static void set_greater(handle h, handle gh) { h->gt = gh; }
+
+	static int get_balance_factor(handle h) { return(h->bf); }
+	static void set_balance_factor(handle h, int bf) { h->bf = bf; }
+
+	static int compare_key_node(key k, handle h)
+	  { return((k > h->start) - (k < h->start)); }
+
+	static int compare_node_node(handle h1, handle h2)
+	  { return(compare_key_node(h1->start, h2)); }
+
+	static handle null(void) { return(0); }
+
+	// Called by the tree whenever the subtree with root h changes,
+	// after the children of h are up to date.
+	static void update(handle h)
+	  {
+	    h->max_end = h->end;
+	    if (h->lt and (h->lt->max_end > h->max_end))
+	      h->max_end = h->lt->max_end;
+	    if (h->gt and (h->gt->max_end > h->max_end))
+	      h->max_end = h->gt->max_end;
+	  }
+
+	// Nodes are in memory, so there are never read errors.
+	static const bool has_read_error = false;
+      };
+
+    // Derived class to get at the root of the tree, so searches for
+    // overlaps can descend through the nodes.
+    class tree_t : public abstract_container::avl_tree<abstr>
+      {
+      public:
+	node * root(void) { return(abs.root); }
+      };
+
+    tree_t tree;
+
+    // Print the reservations in the subtree with root n that overlap
+    // [start, end), in order by start time.
+    static void overlaps(node *n, unsigned start, unsigned end)
+      {
+	// If every interval in the subtree ends at or before the start of
+	// the window, none of them overlap it.
+	while (n and (n->max_end > start))
+	  {
+	    overlaps(n->lt, start, end);
+
+	    // If n starts at or after the end of the window, so do all
+	    // the nodes in its greater subtree.
+	    if (n->start >= end)
+	      break;
+
+	    if (n->end > start)
+	      printf("  %4u-%4u %s\n", n->start, n->end, n->who);
+
+	    n = n->gt;
+	  }
+      }
+
+  public:
+
+    // Returns false if there is already a reservation with the same
+    // start time.
+    bool reserve(unsigned start, unsigned end, const char *who)
+      {
+	node *n = new node;
+
+	n->start = start;
+	n->end = end;
+	n->who = who;
+
+	if (tree.insert(n) != n)
+	  {
+	    delete n;
+	    return(false);
+	  }
+
+	return(true);
+      }
+
+    void cancel(unsigned start)
+      {
+	node *n = tree.remove(start);
+
+	delete n;
+      }
+
+    // Print the reservations that overlap the window [start, end).
+    void print_overlaps(unsigned start, unsigned end)
+      {
+	printf("Overlapping %u-%u:\n", start, end);
+	overlaps(tree.root(), start, end);
+      }
+
+    ~reservations(void)
+      {
+	tree_t::iter it;
+	node *n;
+
+	it.start_iter_least(tree);
+
+	// Death march (see avl_ex1.cpp).
+	for (n = *it; n; n = *it)
+	  {
+	    it++;
+	    delete n;
+	  }
+
+	tree.purge();
+      }
+  };
+
+// Demo main program.
+int main(void)
+  {
+    reservations r;
+
+    r.reserve(540, 600, "staff meeting");
+    r.reserve(600, 660, "design review");
+    r.reserve(480, 1020, "all-day workshop");
+    r.reserve(720, 780, "lunch talk");
+    r.reserve(840, 870, "interview");
+    r.reserve(900, 960, "planning");
+    r.reserve(1020, 1080, "cleanup");
+
+    if (!r.reserve(720, 750, "double booking"))
+      printf("720 is already reserved\n\n");
+
+    r.print_overlaps(590, 610);
+    r.print_overlaps(1000, 1030);
+    r.print_overlaps(1080, 1200);
+
+    r.cancel(480);
+
+    printf("\nAfter cancelling the workshop:\n");
+    r.print_overlaps(700, 900);
+
+    return(0);
+  }
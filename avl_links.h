@@ -0,0 +1,275 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_AVL_LINKS_H_
+#define ABSTRACT_CONTAINER_AVL_LINKS_H_
+
+// Compact link fields for the nodes of an avl_tree, and abstractor base
+// classes that implement the link and balance factor member functions
+// with them.  The balance factor is packed into the child links, as in
+// avl_ex2.cpp, so it takes no space of its own.  The abstractors have the
+// optional get_child() member function, so that choosing between the two
+// links, which must be unpacked, does not take a branch.
+//
+// For example, in an array of up to 2 ** 31 - 1 nodes, the links and
+// balance factor of a node take 8 bytes (rather than 24 for two 64-bit
+// pointers and a padded balance factor), so a node with a 32-bit key
+// takes 12 bytes:
+//
+//   struct node
+//     {
+//       std::uint32_t key;
+//       avl_index_links<std::uint32_t> links;
+//     };
+//
+//   struct abstr :
+//     public avl_array_abs<
+//       node, avl_index_links<std::uint32_t>, &node::links>
+//     {
+//       typedef std::uint32_t key;
+//       typedef std::uint32_t size;
+//
+//       int compare_key_node(key k, handle h)
+//         {
+//           key hk = node_array[h].key;
+//
+//           return((k > hk) - (k < hk));
+//         }
+//
+//       int compare_node_node(handle h1, handle h2)
+//         { return(compare_key_node(node_array[h1].key, h2)); }
+//
+//       static bool read_error() { return(false); }
+//     };
+//
+// The node_array member of abstr must be set (for example, by a class
+// derived from avl_tree<abstr>, which can access the protected abs member)
+// before the tree is used.
+
+#include <cstdint>
+#include <type_traits>
+
+namespace abstract_container
+{
+
+// Less and greater child links that are indexes (of an unsigned integral
+// type) into an array of nodes, with the balance factor in one bit of
+// each.  The magnitude of the balance factor is in the less link, and the
+// sign in the greater link.  If bf_low_bits is false, the balance factor
+// bits are the high bits of the links.  Otherwise, they are the low bits,
+// and the indexes are shifted up one bit.  Either way, the largest valid
+// index is null_index - 1.  When constructed, both links are null and
+// the balance factor is 0, so the setters never read an uninitialized
+// link.
+//
+template <typename index_t, bool bf_low_bits = false>
+class avl_index_links
+  {
+  public:
+
+    static_assert(
+      std::is_integral<index_t>::value and std::is_unsigned<index_t>::value,
+      "index_t must be an unsigned integral type");
+
+    // Index stored in a link to indicate no child.
+    static const index_t null_index = index_t(~index_t(0)) >> 1;
+
+    typedef index_t index;
+
+    index_t get_less() const { return(get_index(link[0])); }
+    void set_less(index_t i) { link[0] = set_index(link[0], i); }
+
+    index_t get_greater() const { return(get_index(link[1])); }
+    void set_greater(index_t i) { link[1] = set_index(link[1], i); }
+
+    // Same as get_greater() if greater is true, otherwise same as
+    // get_less().  Selects with a mask rather than an array index,
+    // because compilers tend to turn link[greater] into a branch.
+    index_t get_child(bool greater) const
+      {
+        index_t mask = index_t(index_t(0) - index_t(greater));
+
+        return(get_index(index_t(link[0] ^ ((link[0] ^ link[1]) & mask))));
+      }
+
+    int get_balance_factor() const
+      {
+        if (link[1] & bf_bit)
+          return(-1);
+
+        return((link[0] & bf_bit) ? 1 : 0);
+      }
+
+    void set_balance_factor(int bf)
+      {
+        link[0] = index_t(bf ? link[0] | bf_bit : link[0] & ~bf_bit);
+        link[1] = index_t(bf < 0 ? link[1] | bf_bit : link[1] & ~bf_bit);
+      }
+
+  private:
+
+    static const index_t bf_bit =
+      bf_low_bits ?
+        index_t(1) : index_t(index_t(1) << ((8 * sizeof(index_t)) - 1));
+
+    static index_t get_index(index_t link)
+      { return(bf_low_bits ? index_t(link >> 1) : index_t(link & ~bf_bit)); }
+
+    static index_t set_index(index_t link, index_t i)
+      {
+        return(
+          bf_low_bits ?
+            index_t((link & bf_bit) | index_t(i << 1)) :
+            index_t((link & bf_bit) | i));
+      }
+
+    // Less link, then greater link.
+    index_t link[2] =
+      { set_index(0, null_index), set_index(0, null_index) };
+  };
+
+// Less and greater child links that are pointers to nodes of type node,
+// with the balance factor in the low bit of each.  The alignment of node
+// must be at least 2, so that the low bit of a pointer to a node is
+// always 0.  With 64-bit pointers, a node with these links and a 64-bit
+// key takes 24 bytes rather than 32.  As with avl_index_links, both links
+// are null and the balance factor is 0 when constructed.
+//
+template <class node>
+class avl_tagged_ptr_links
+  {
+  public:
+
+    node * get_less() const { return(get_ptr(link[0])); }
+    void set_less(node *p) { link[0] = set_ptr(link[0], p); }
+
+    node * get_greater() const { return(get_ptr(link[1])); }
+    void set_greater(node *p) { link[1] = set_ptr(link[1], p); }
+
+    // Same as avl_index_links::get_child().
+    node * get_child(bool greater) const
+      {
+        std::uintptr_t mask = std::uintptr_t(0) - std::uintptr_t(greater);
+
+        return(get_ptr(link[0] ^ ((link[0] ^ link[1]) & mask)));
+      }
+
+    int get_balance_factor() const
+      {
+        if (link[1] & 1)
+          return(-1);
+
+        return(int(link[0] & 1));
+      }
+
+    void set_balance_factor(int bf)
+      {
+        link[0] = bf ? link[0] | 1 : link[0] & ~std::uintptr_t(1);
+        link[1] = bf < 0 ? link[1] | 1 : link[1] & ~std::uintptr_t(1);
+      }
+
+  private:
+
+    static node * get_ptr(std::uintptr_t link)
+      { return(reinterpret_cast<node *>(link & ~std::uintptr_t(1))); }
+
+    static std::uintptr_t set_ptr(std::uintptr_t link, node *p)
+      { return((link & 1) | reinterpret_cast<std::uintptr_t>(p)); }
+
+    std::uintptr_t link[2] = { 0, 0 };
+  };
+
+// Base class for an avl_tree abstractor.  The nodes are elements of the
+// array node_array, of nodes of type node, with links of type links_t
+// (an avl_index_links instantiation) as the data member links.  Handles
+// are indexes into node_array.  The class derived from this must define
+// the key and size types, and the compare_key_node(), compare_node_node()
+// and read_error() member functions.
+//
+template <class node, class links_t, links_t node::*links>
+class avl_array_abs
+  {
+  public:
+
+    typedef typename links_t::index handle;
+
+    // Pointer to the first element of the array of nodes.
+    node *node_array = nullptr;
+
+    handle get_less(handle h, bool) const
+      { return((node_array[h].*links).get_less()); }
+    void set_less(handle h, handle lh) { (node_array[h].*links).set_less(lh); }
+
+    handle get_greater(handle h, bool) const
+      { return((node_array[h].*links).get_greater()); }
+    void set_greater(handle h, handle gh)
+      { (node_array[h].*links).set_greater(gh); }
+
+    handle get_child(handle h, bool greater, bool) const
+      { return((node_array[h].*links).get_child(greater)); }
+
+    int get_balance_factor(handle h) const
+      { return((node_array[h].*links).get_balance_factor()); }
+    void set_balance_factor(handle h, int bf)
+      { (node_array[h].*links).set_balance_factor(bf); }
+
+    static handle null() { return(links_t::null_index); }
+  };
+
+// Base class for an avl_tree abstractor whose handles are pointers to
+// nodes of type node, with the links as the data member links.  Has no
+// data members.  The class derived from this has the same required
+// members as for avl_array_abs.
+//
+template <class node, avl_tagged_ptr_links<node> node::*links>
+class avl_tagged_ptr_abs
+  {
+  public:
+
+    typedef node *handle;
+
+    static handle get_less(handle h, bool) { return((h->*links).get_less()); }
+    static void set_less(handle h, handle lh) { (h->*links).set_less(lh); }
+
+    static handle get_greater(handle h, bool)
+      { return((h->*links).get_greater()); }
+    static void set_greater(handle h, handle gh)
+      { (h->*links).set_greater(gh); }
+
+    static handle get_child(handle h, bool greater, bool)
+      { return((h->*links).get_child(greater)); }
+
+    static int get_balance_factor(handle h)
+      { return((h->*links).get_balance_factor()); }
+    static void set_balance_factor(handle h, int bf)
+      { (h->*links).set_balance_factor(bf); }
+
+    static handle null() { return(nullptr); }
+
+  private:
+
+    static_assert(
+      alignof(node) >= 2,
+      "node alignment leaves no bit for the balance factor");
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
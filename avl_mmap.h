@@ -0,0 +1,452 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_AVL_MMAP_H_
+#define ABSTRACT_CONTAINER_AVL_MMAP_H_
+
+// AVL tree whose nodes are in a memory-mapped file (POSIX only).  The
+// handles are indexes into the array of nodes in the file, so the file
+// can be mapped at any address.  A tree that is written (for example,
+// with build()) and closed can be reopened, even read-only, with no
+// conversion of the nodes, since a search only reads the nodes it
+// visits.
+//
+// The file has a header (avl_file_header), followed by the array of
+// nodes at offset avl_file_header::nodes_offset.  The node type must be
+// trivially copyable, and have its links as a data member of type
+// avl_index_links (see avl_links.h).  For example:
+//
+//   struct node
+//     {
+//       std::uint64_t key;
+//       avl_index_links<std::uint32_t> links;
+//     };
+//
+//   struct abstr :
+//     public avl_mmap_abs<
+//       node, avl_index_links<std::uint32_t>, &node::links>
+//     {
+//       typedef std::uint64_t key;
+//       typedef std::uint32_t size;
+//
+//       int compare_key_node(key k, handle h)
+//         {
+//           key hk = node_array[h].key;
+//
+//           return((k > hk) - (k < hk));
+//         }
+//
+//       int compare_node_node(handle h1, handle h2)
+//         { return(compare_key_node(node_array[h1].key, h2)); }
+//     };
+//
+//   avl_mmap_tree<abstr> tree;
+//
+//   tree.create("index.avl", n);
+//   // ... set the keys of tree.get_node(0) to tree.get_node(n - 1), in
+//   // ascending order.
+//   tree.build_all();
+//   tree.close();
+//
+//   tree.open("index.avl");
+//   tree.search(k);
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "avl_links.h"
+#include "avl_tree.h"
+
+namespace abstract_container
+{
+
+// Memory mapping of a whole file.
+//
+class mapped_file
+  {
+  public:
+
+    mapped_file() : addr(nullptr), len(0), writable_(false) { }
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file & operator = (const mapped_file &) = delete;
+
+    ~mapped_file() { close(); }
+
+    // Maps the existing file at path.  Returns false if it cannot be
+    // opened or mapped.
+    bool open(const char *path, bool writable = false)
+      {
+        close();
+
+        int fd = ::open(path, writable ? O_RDWR : O_RDONLY);
+
+        if (fd < 0)
+          return(false);
+
+        struct stat st;
+
+        bool ok = (::fstat(fd, &st) == 0) and (st.st_size > 0);
+
+        if (ok)
+          ok = map(fd, std::size_t(st.st_size), writable);
+
+        ::close(fd);
+
+        return(ok);
+      }
+
+    // Creates (or truncates) the file at path, with size bytes (all
+    // zero), and maps it writable.  Returns false on failure.
+    bool create(const char *path, std::size_t size)
+      {
+        close();
+
+        int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+        if (fd < 0)
+          return(false);
+
+        bool ok = (::ftruncate(fd, off_t(size)) == 0) and map(fd, size, true);
+
+        ::close(fd);
+
+        return(ok);
+      }
+
+    // Writes changes in the mapping to the file.
+    bool sync() { return(!addr or (::msync(addr, len, MS_SYNC) == 0)); }
+
+    void close()
+      {
+        if (addr)
+          {
+            ::munmap(addr, len);
+            addr = nullptr;
+            len = 0;
+          }
+      }
+
+    bool is_open() const { return(addr != nullptr); }
+
+    bool writable() const { return(writable_); }
+
+    void * data() const { return(addr); }
+
+    std::size_t size() const { return(len); }
+
+  private:
+
+    void *addr;
+    std::size_t len;
+    bool writable_;
+
+    bool map(int fd, std::size_t size, bool writable)
+      {
+        void *p =
+          ::mmap(
+            nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+            MAP_SHARED, fd, 0);
+
+        if (p == MAP_FAILED)
+          return(false);
+
+        addr = p;
+        len = size;
+        writable_ = writable;
+
+        return(true);
+      }
+  };
+
+// Header at the start of a file with an AVL tree.  The fields are in the
+// byte order of the CPU that wrote the file.
+//
+struct avl_file_header
+  {
+    static const std::uint64_t magic_value = 0x314c5641544e4241ULL;
+
+    // Offset of the node array in the file.  A multiple of 64.
+    static const std::size_t nodes_offset = 64;
+
+    // Always magic_value.
+    std::uint64_t magic;
+
+    // sizeof the node type.
+    std::uint64_t node_bytes;
+
+    // Number of nodes in the array.
+    std::uint64_t num_nodes;
+
+    // Handle of the root node.
+    std::uint64_t root;
+  };
+
+// Base class for an avl_tree abstractor for nodes in a mapped file.  It
+// is the same as avl_array_abs, with this addition.  If checked is true,
+// every link read is checked to be less than the number of nodes in the
+// file (or null), so out-of-range indexes are detected.  A bad link reads
+// as null, and the tree's read_error() then returns true (so the
+// operation fails).  Only the range of each link is checked, not the
+// shape of the tree, so links that form a cycle are not detected, and
+// can make the tree's operations loop forever or overrun their paths.
+// So checked mode is not safe for untrusted files.  If checked is false,
+// has_read_error is false, and all read error checks are removed at
+// compile time.
+//
+template <class node, class links_t, links_t node::*links,
+          bool checked = false>
+class avl_mmap_abs : public avl_array_abs<node, links_t, links>
+  {
+  private:
+
+    typedef avl_array_abs<node, links_t, links> base;
+
+  public:
+
+    typedef typename base::handle handle;
+
+    static_assert(
+      std::is_trivially_copyable<node>::value,
+      "node type for avl_mmap_abs must be trivially copyable");
+
+    static const bool has_read_error = checked;
+
+    // Number of nodes in node_array.
+    std::uint64_t num_nodes = 0;
+
+    handle get_less(handle h, bool access)
+      { return(check(base::get_less(h, access))); }
+
+    handle get_greater(handle h, bool access)
+      { return(check(base::get_greater(h, access))); }
+
+    handle get_child(handle h, bool greater, bool access)
+      { return(check(base::get_child(h, greater, access))); }
+
+    // Returns true if a bad link has been read since the last call.
+    bool read_error()
+      {
+        bool e = error;
+
+        error = false;
+
+        return(e);
+      }
+
+  private:
+
+    bool error = false;
+
+    handle check(handle h)
+      { return(check(h, std::integral_constant<bool, checked>())); }
+
+    handle check(handle h, std::false_type) { return(h); }
+
+    handle check(handle h, std::true_type)
+      {
+        if ((h != base::null()) and (h >= num_nodes))
+          {
+            error = true;
+            return(base::null());
+          }
+
+        return(h);
+      }
+  };
+
+namespace impl
+{
+
+// Forward iterator over the handles 0, 1, 2, ...
+//
+template <typename handle>
+class avl_counting_iter
+  {
+  public:
+
+    explicit avl_counting_iter(handle h_) : h(h_) { }
+
+    handle operator * () const { return(h); }
+
+    avl_counting_iter & operator ++ () { ++h; return(*this); }
+
+    avl_counting_iter operator ++ (int) { return(avl_counting_iter(h++)); }
+
+  private:
+
+    handle h;
+  };
+
+} // end namespace impl
+
+// AVL tree in a mapped file.  The abstractor must be derived from
+// avl_mmap_abs.  Functions that change the tree must only be used if
+// the file is open for writing.  The root is saved in the file header
+// by commit() and close().
+//
+template <class abstractor, unsigned max_depth = 32>
+class avl_mmap_tree : public avl_tree<abstractor, max_depth>
+  {
+  private:
+
+    typedef avl_tree<abstractor, max_depth> base;
+
+  public:
+
+    typedef typename base::handle handle;
+    typedef typename base::size size;
+
+    typedef
+      typename std::remove_reference<
+        decltype(*std::declval<abstractor &>().node_array)>::type
+      node;
+
+    avl_mmap_tree() = default;
+
+    ~avl_mmap_tree() { close(); }
+
+    // Creates the file at path, with room for num_nodes nodes, and an
+    // empty tree.  The nodes are all zero bytes.  Returns false on
+    // failure, or if num_nodes is too many for the handle type.
+    bool create(const char *path, std::uint64_t num_nodes)
+      {
+        close();
+
+        if (num_nodes > std::uint64_t(null()))
+          return(false);
+
+        std::uint64_t bytes =
+          avl_file_header::nodes_offset + (num_nodes * sizeof(node));
+
+        if (!file.create(path, std::size_t(bytes)))
+          return(false);
+
+        header()->magic = avl_file_header::magic_value;
+        header()->node_bytes = sizeof(node);
+        header()->num_nodes = num_nodes;
+        attach(null());
+
+        return(commit());
+      }
+
+    // Opens the file at path, which must have been written by an
+    // avl_mmap_tree for the same node type.  Returns false on failure, or
+    // if the header does not match the node type or file size.
+    bool open(const char *path, bool writable = false)
+      {
+        close();
+
+        if (!file.open(path, writable))
+          return(false);
+
+        const avl_file_header *hdr = header();
+        const std::size_t off = avl_file_header::nodes_offset;
+
+        if ((file.size() < off) or
+            (hdr->magic != avl_file_header::magic_value) or
+            (hdr->node_bytes != sizeof(node)) or
+            (hdr->num_nodes > ((file.size() - off) / sizeof(node))) or
+            (hdr->num_nodes > std::uint64_t(null())) or
+            ((hdr->root != std::uint64_t(null())) and
+             (hdr->root >= hdr->num_nodes)))
+          {
+            file.close();
+            return(false);
+          }
+
+        attach(handle(hdr->root));
+
+        return(true);
+      }
+
+    // Saves the root in the file, and writes all changes to the file.
+    bool commit()
+      {
+        if (!file.is_open() or !file.writable())
+          return(false);
+
+        header()->root = std::uint64_t(this->abs.root);
+
+        return(file.sync());
+      }
+
+    // Commits (if open for writing) and closes.
+    void close()
+      {
+        if (file.is_open())
+          {
+            if (file.writable())
+              commit();
+
+            file.close();
+          }
+
+        this->abs.node_array = nullptr;
+        this->abs.num_nodes = 0;
+        this->abs.root = null();
+      }
+
+    bool is_open() const { return(file.is_open()); }
+
+    // Number of nodes in the file (whether or not they are in the tree).
+    std::uint64_t num_nodes() const { return(this->abs.num_nodes); }
+
+    node & get_node(handle h) { return(this->abs.node_array[h]); }
+
+    // Builds the tree from all the nodes in the file, which must be in
+    // ascending key order.
+    bool build_all()
+      {
+        return(
+          this->build(
+            impl::avl_counting_iter<handle>(0), size(this->abs.num_nodes)));
+      }
+
+    handle null() { return(this->abs.null()); }
+
+  private:
+
+    mapped_file file;
+
+    avl_file_header * header()
+      { return(static_cast<avl_file_header *>(file.data())); }
+
+    void attach(handle root)
+      {
+        this->abs.node_array =
+          reinterpret_cast<node *>(
+            static_cast<char *>(file.data()) + avl_file_header::nodes_offset);
+        this->abs.num_nodes = header()->num_nodes;
+        this->abs.root = root;
+      }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
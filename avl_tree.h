@@ -31,7 +31,11 @@ SOFTWARE.
 // define the depth of the root node to be 0 (0-based depth) rather than
 // 1 (1-based depth).
 
+#include "algorithm"
 #include "bitset"
+#include "thread"
+#include "type_traits"
+#include "utility"
 
 namespace abstract_container
 {
@@ -55,6 +59,216 @@ enum search_type
 
 #endif
 
+namespace impl
+{
+
+// avl_has_parent<abstractor>::value is true if the abstractor has the
+// optional get_parent() and set_parent() member functions.
+//
+template <class abstractor>
+class avl_has_parent
+  {
+  private:
+
+    template <class A>
+    static char test(
+      decltype(std::declval<A &>().get_parent(
+	std::declval<typename A::handle>(), true)) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+// avl_has_size<abstractor>::value is true if the abstractor has the
+// optional get_size() and set_size() member functions.
+//
+template <class abstractor>
+class avl_has_size
+  {
+  private:
+
+    template <class A>
+    static char test(
+      decltype(std::declval<A &>().get_size(
+	std::declval<typename A::handle>())) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+// avl_has_update<abstractor>::value is true if the abstractor has the
+// optional update() member function.
+//
+template <class abstractor>
+class avl_has_update
+  {
+  private:
+
+    template <class A>
+    static char test(
+      decltype(std::declval<A &>().update(
+	std::declval<typename A::handle>())) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+// avl_has_get_child<abstractor>::value is true if the abstractor has the
+// optional get_child() member function.
+//
+template <class abstractor>
+class avl_has_get_child
+  {
+  private:
+
+    template <class A>
+    static char test(
+      decltype(std::declval<A &>().get_child(
+	std::declval<typename A::handle>(), true, true)) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+// avl_may_read_error<abstractor>::value is false if the abstractor has
+// a has_read_error static data member that is false, otherwise true.
+//
+template <class abstractor>
+class avl_may_read_error
+  {
+  private:
+
+    template <class A>
+    static std::integral_constant<bool, A::has_read_error> test(
+      decltype(&A::has_read_error));
+
+    template <class A>
+    static std::true_type test(...);
+
+  public:
+
+    static const bool value = decltype(test<abstractor>(nullptr))::value;
+  };
+
+// avl_iter_has_failed<iter>::value is true if the iterator type has a
+// failed() member function (see base_avl_tree::build()).
+//
+template <class iter>
+class avl_iter_has_failed
+  {
+  private:
+
+    template <class I>
+    static char test(decltype(std::declval<const I &>().failed()) *);
+
+    template <class I>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<iter>(nullptr)) == 1;
+  };
+
+// avl_has_prefetch<abstractor>::value is true if the abstractor has the
+// optional prefetch() member function.
+//
+template <class abstractor>
+class avl_has_prefetch
+  {
+  private:
+
+    template <class A>
+    static char test(
+      decltype(std::declval<A &>().prefetch(
+	std::declval<typename A::handle>())) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+} // end namespace impl
+
+// Stats policy for base_avl_tree, that counts nothing.  Adds no code or
+// data to the tree.
+//
+class avl_no_stats
+  {
+  protected:
+
+    void count_single_rotation(void) { }
+    void count_double_rotation(void) { }
+    void count_comparison(void) { }
+    void count_read_error(void) { }
+
+  public:
+
+    unsigned long long single_rotations(void) const { return(0); }
+    unsigned long long double_rotations(void) const { return(0); }
+    unsigned long long comparisons(void) const { return(0); }
+    unsigned long long read_errors(void) const { return(0); }
+
+    void reset_stats(void) { }
+  };
+
+// Stats policy for base_avl_tree, that counts rotations done to
+// rebalance the tree (a double rotation counts only as a double rotation),
+// calls to the abstractor's compare_key_node() and compare_node_node(),
+// and calls to read_error() that returned true.  The counters are not
+// atomic.  Comparisons done by build_unsorted() are not counted, because
+// it may compare in multiple threads.
+//
+class avl_count_stats
+  {
+  protected:
+
+    void count_single_rotation(void) { ++single_rotations_; }
+    void count_double_rotation(void) { ++double_rotations_; }
+    void count_comparison(void) { ++comparisons_; }
+    void count_read_error(void) { ++read_errors_; }
+
+  public:
+
+    unsigned long long single_rotations(void) const
+      { return(single_rotations_); }
+    unsigned long long double_rotations(void) const
+      { return(double_rotations_); }
+    unsigned long long comparisons(void) const { return(comparisons_); }
+    unsigned long long read_errors(void) const { return(read_errors_); }
+
+    void reset_stats(void)
+      {
+	single_rotations_ = 0;
+	double_rotations_ = 0;
+	comparisons_ = 0;
+	read_errors_ = 0;
+      }
+
+  private:
+
+    unsigned long long single_rotations_ = 0, double_rotations_ = 0,
+      comparisons_ = 0, read_errors_ = 0;
+  };
+
 // The base_avl_tree template is the same as the avl_tree template,
 // except for one additional template parameter: bset.  Here is the
 // reference class for bset.
@@ -83,8 +297,83 @@ enum search_type
 //     void reset(void);
 //   };
 //
-template <class abstractor, unsigned max_depth, class bset>
-class base_avl_tree
+// The abstractor may optionally have these member functions, to store
+// a parent link in each node:
+//
+// handle get_parent(handle h, bool access) -- returns the handle most
+//   recently stored in the node h by set_parent().  The access flag has
+//   the same meaning as for get_less() and get_greater().
+// void set_parent(handle h, handle parent) -- store the handle of the
+//   parent of the node h in the node.  The null value is stored in the
+//   root node.
+//
+// If the abstractor has them, insert(), remove(), subst() and build()
+// keep the parent links up to date, and iter is parent_iter rather than
+// path_iter.  parent_iter holds only the tree and the current node, and
+// does not need the stack of node handles that path_iter has.
+//
+// The abstractor may optionally have these member functions, to store
+// the number of nodes in the subtree rooted at each node:
+//
+// size get_size(handle h) -- returns the value most recently stored in
+//   the node h by set_size().
+// void set_size(handle h, size s) -- store the number of nodes in the
+//   subtree whose root is h (including h) in the node.
+//
+// If the abstractor has them, insert(), remove(), subst() and build()
+// keep the subtree sizes up to date, and the select(), rank() and
+// count() member functions, and the start_iter_select() iterator member
+// function, may be used.  They take time proportional to the depth of
+// the tree.
+//
+// The abstractor may optionally have this member function, to keep a
+// value in each node that is calculated from the nodes in its subtree
+// (for example, the greatest end point of the intervals in the subtree,
+// for an interval tree):
+//
+// void update(handle h) -- recalculate the value for the node h from the
+//   node itself and its children (if any).  The value must depend only
+//   on which nodes are in the subtree, not on its shape.
+//
+// If the abstractor has it, every member function that changes the tree
+// calls update() for each node whose subtree has changed, in each case
+// after the children of the node are up to date (and after the subtree
+// size of the node, if the abstractor has subtree sizes).  This includes
+// the nodes rotated in rebalancing, and the nodes on the path from a
+// node inserted, removed or substituted back up to the root.
+//
+// The abstractor may optionally have this member function:
+//
+// handle get_child(handle h, bool greater, bool access) -- returns the
+//   same value as get_greater(h, access) if greater is true, otherwise
+//   the same value as get_less(h, access).  search(), search_many(),
+//   insert(), remove() and subst() use it to step down the tree.  It is
+//   faster if it chooses the link without a branch (for example, by
+//   indexing an array of the two links), when the links are not simple
+//   pointers.
+//
+// The abstractor may optionally have this static data member:
+//
+// static const bool has_read_error -- if false, read errors cannot
+//   happen.  The read_error() member function of the tree always
+//   returns false, and the abstractor does not need a read_error()
+//   member function.  So all checks for read errors are removed at
+//   compile time, even if the abstractor's read_error() could not be
+//   inlined.
+//
+// The abstractor may optionally have this member function:
+//
+// void prefetch(handle h) -- a hint that the node h (which is not null)
+//   will be accessed soon.  For example, it could call
+//   __builtin_prefetch() with the address of the node.  It is only called
+//   by search_many().
+//
+// The stats_policy parameter class is avl_no_stats (the default) or
+// avl_count_stats, or a class with the same members.
+//
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy = avl_no_stats>
+class base_avl_tree : public stats_policy
   {
   public:
 
@@ -94,19 +383,140 @@ class base_avl_tree
 
     inline handle insert(handle h);
 
+    class path_iter;
+
+    // Same as insert(h), but the search for the insertion point starts
+    // at the node hint refers to, and only goes up hint's path as far as
+    // needed.  So if h's key is near the key of that node, few nodes are
+    // compared with h (for ascending inserts, only one).  If hint is
+    // invalid, the search starts at the root.  On return, hint refers to
+    // h (or to the node with the same key, if h was not inserted), so a
+    // sequence of inserts can share one hint.  hint must be an iterator
+    // for this tree, and the tree must not have been changed (other than
+    // by inserts with hint) since hint was last positioned.
+    inline handle insert(handle h, path_iter &hint);
+
     inline handle search(key k, search_type st = EQUAL);
+
+    // Same as search(k, st), but the search starts at the node it refers
+    // to, and only goes up its path as far as needed.  On return, it
+    // refers to the returned node (it is invalid if null is returned).
+    // If it is invalid on entry, the search starts at the root.  The
+    // requirements for it are the same as for the hint for insert().
+    inline handle search(key k, search_type st, path_iter &it);
+
+    // For each i from 0 to n - 1, sets out[i] to search(k[i], st).  The
+    // searches are done in lock-step, in groups, so that the node accesses
+    // for the different keys can overlap.  This is faster than separate
+    // searches when the nodes are not in cache.
+    inline void search_many(
+      const key *k, size n, handle *out, search_type st = EQUAL);
     inline handle search_least(void);
     inline handle search_greatest(void);
 
     inline handle remove(key k);
 
+    // Removes the node h, which must be in the tree, and returns h.  If
+    // the abstractor has parent links, the path to h is found by following
+    // them up to the root, so no nodes are compared.  Otherwise, the
+    // position of h is found by comparing it with other nodes (with
+    // compare_node_node()), so its key does not have to be known.
+    // Returns null on a read error.
+    handle remove_node(handle h) { return(remove_node(h, parent_links_t())); }
+
+    // Moves the nodes with keys greater than k to the tree greater (which
+    // must be empty), leaving the nodes with keys less than k in this
+    // tree.  Returns the node with key k, which is left in neither tree,
+    // or null if there is none (or on a read error).  Takes time
+    // proportional to the depth of the tree.
+    inline handle split(key k, base_avl_tree &greater);
+
+    // Moves all the nodes of the tree greater into this tree.  The keys
+    // of the nodes in greater must all be greater than the keys of the
+    // nodes in this tree.  Takes time proportional to the depth of the
+    // deeper tree.  Returns false on a read error.
+    inline bool join(base_avl_tree &greater);
+
+    // Set operations.  They move nodes between trees, and rebalance by
+    // joining subtrees (as in Blelloch, Ferizovic and Sun, "Just Join for
+    // Parallel Ordered Sets"), so for trees of m and n nodes, m <= n, they
+    // take time proportional to m log(n / m + 1).  Nodes of the two trees
+    // are compared with compare_node_node().  The trees must have
+    // equivalent abstractors.
+    //
+    // If num_threads is more than 1, up to num_threads threads are used.
+    // As for build_unsorted(), the abstractor member functions must then
+    // be safe to call for different nodes concurrently.  The stats policy
+    // must also be safe to call from different threads (avl_no_stats is,
+    // avl_count_stats is not).
+    //
+    // They return false on a read error, in which case the trees are left
+    // in an undefined state.
+
+    // Makes this tree the union of it and other.  Where both trees have a
+    // node with the same key, the node in this tree is kept, and the node
+    // in other is left in other.  All the other nodes of other are moved
+    // into this tree.
+    inline bool unite(base_avl_tree &other, unsigned num_threads = 1);
+
+    // Moves the nodes of this tree whose keys are not keys of nodes in
+    // other to the tree removed (which must be empty).  other has the
+    // same nodes after as before (but may be restructured).
+    inline bool intersect(
+      base_avl_tree &other, base_avl_tree &removed, unsigned num_threads = 1);
+
+    // Same as intersect(), except the nodes of this tree whose keys are
+    // keys of nodes in other are moved to removed.
+    inline bool subtract(
+      base_avl_tree &other, base_avl_tree &removed, unsigned num_threads = 1);
+
     inline handle subst(handle new_node);
 
+    // Returns the node that is preceded by n nodes (in ascending key
+    // order), or null if there are n or fewer nodes in the tree.
+    // Requires subtree sizes.
+    inline handle select(size n);
+
+    // Returns the number of nodes whose keys are less than k.  Requires
+    // subtree sizes.
+    inline size rank(key k);
+
+    // Returns the number of nodes in the tree.  Requires subtree sizes.
+    size count(void) { return(sub_size(abs.root)); }
+
+    // Calls f(h) for the handle h of each node whose key is not less than
+    // lo and less than hi, in ascending key order.  f returns a value that
+    // converts to bool, false to stop the visit.  Only subtrees that may
+    // have nodes in the range are visited, and keys are only compared
+    // with nodes that may be at a bound of the range.  Returns false if
+    // f returned false, or there was a read error.
+    template <class visitor>
+    bool visit_range(key lo, key hi, visitor f)
+      { return(visit_range_sub(abs.root, lo, hi, true, true, f)); }
+
+    // Returns the number of nodes whose keys are not less than lo and less
+    // than hi (or 0 on a read error).  With subtree sizes, takes time
+    // proportional to the depth of the tree.  Otherwise, visits each
+    // node in the range.
+    size count_range(key lo, key hi)
+      { return(count_range(lo, hi, subtree_sizes_t())); }
+
     void purge(void) { abs.root = null(); }
 
     bool is_empty(void) { return(abs.root == null()); }
 
-    bool read_error(void) { return(abs.read_error()); }
+    bool read_error(void)
+      {
+	return(
+	  read_error(
+	    std::integral_constant<
+	      bool, impl::avl_may_read_error<abstractor>::value>()));
+      }
+
+    // Sets hist[d] to the number of nodes at (0-based) depth d, for d
+    // from 0 to max_depth - 1.  Takes time proportional to the number of
+    // nodes.  Returns false if there was a read error.
+    inline bool depth_histogram(size *hist);
 
     base_avl_tree(void) { abs.root = null(); }
 
@@ -114,7 +524,16 @@ class base_avl_tree
 
     base_avl_tree & operator = (const base_avl_tree &) = delete;
 
-    class iter
+    // True if the abstractor has get_parent() and set_parent().
+    static const bool parent_links = impl::avl_has_parent<abstractor>::value;
+
+    // True if the abstractor has get_size() and set_size().
+    static const bool subtree_sizes = impl::avl_has_size<abstractor>::value;
+
+    // True if the abstractor has update().
+    static const bool augmented = impl::avl_has_update<abstractor>::value;
+
+    class path_iter
       {
       public:
 
@@ -124,7 +543,7 @@ class base_avl_tree
 
 	// Initialize depth to invalid value, to indicate iterator is
 	// invalid.   (Depth is zero-base.)
-	constexpr iter(void) : depth(unsigned(~0)) { }
+	constexpr path_iter(void) : depth(unsigned(~0)) { }
 
 	void start_iter(base_avl_tree &tree, key k, search_type st = EQUAL)
 	  {
@@ -233,6 +652,43 @@ class base_avl_tree
 	      }
 	  }
 
+	// Start at the node that is preceded by n nodes.  Requires
+	// subtree sizes.
+	void start_iter_select(base_avl_tree &tree, size n)
+	  {
+	    tree_ = &tree;
+
+	    handle h = tree_->abs.root;
+	    unsigned d = 0;
+
+	    depth = unsigned(~0);
+
+	    while (h != null())
+	      {
+		handle lh = get_lt(h);
+		if (read_error())
+		  break;
+		size less_size = tree_->sub_size(lh);
+		if (n == less_size)
+		  {
+		    depth = d;
+		    break;
+		  }
+		bool is_greater = n > less_size;
+		if (is_greater)
+		  {
+		    n -= less_size + 1;
+		    h = get_gt(h);
+		  }
+		else
+		  h = lh;
+		if (read_error() or (h == null()))
+		  break;
+		branch[d] = is_greater;
+		path_h[d++] = h;
+	      }
+	  }
+
 	handle operator * (void)
 	  {
 	    if (depth == unsigned(~0))
@@ -342,109 +798,428 @@ class base_avl_tree
 	// Handles of nodes in path from root to current node (returned by *).
 	handle path_h[max_depth - 1];
 
-	int cmp_k_n(key k, handle h)
-	  { return(tree_->abs.compare_key_node(k, h)); }
-	int cmp_n_n(handle h1, handle h2)
-	  { return(tree_->abs.compare_node_node(h1, h2)); }
+	int cmp_k_n(key k, handle h) { return(tree_->cmp_k_n(k, h)); }
+	int cmp_n_n(handle h1, handle h2) { return(tree_->cmp_n_n(h1, h2)); }
 	handle get_lt(handle h)
 	  { return(tree_->abs.get_less(h, true)); }
 	handle get_gt(handle h)
 	  { return(tree_->abs.get_greater(h, true)); }
 	handle null(void) { return(tree_->abs.null()); }
 
-      };
+	// Node at (zero-based) depth d in the path.
+	handle path_node(unsigned d)
+	  { return(d == 0 ? tree_->abs.root : path_h[d - 1]); }
+
+	// Shortens the path, until the position of the key or node that
+	// cmp compares with is in the subtree whose root is the current
+	// node (which must be valid).  cmp(h) returns the result of
+	// comparing the key or node with the node h.  Returns the result of
+	// comparing with the current node after shortening.  Only nodes in
+	// the path where it changes direction are compared.
+	template <class compare>
+	int climb(compare cmp)
+	  {
+	    int c = cmp(**this);
 
-    template<typename fwd_iter>
-    bool build(fwd_iter p, size num_nodes)
-      {
-	// NOTE:  GCC allows me to define this outside the class definition
-	// using the following syntax:
-	//
-	// template <class abstractor, unsigned max_depth, class bset>
-	// template<typename fwd_iter>
-	// inline void base_avl_tree<abstractor, max_depth, bset>::build(
-	//   fwd_iter p, size num_nodes)
-	//   {
-	//     ...
-	//   }
-	//
-	// but Visual C++ .NET won't accept it.  Is this a GCC extension?
+	    while (c != 0)
+	      {
+		// Find the nearest node in the path that is on the other
+		// side of the key or node.
+		unsigned d = depth;
+		do
+		  {
+		    if (d == 0)
+		      return(c);
+		    d--;
+		  }
+		while (bool(branch[d]) != (c < 0));
 
-	if (num_nodes == 0)
-	  {
-	    abs.root = null();
-	    return(true);
+		int cd = cmp(path_node(d));
+		if ((cd != 0) and ((cd > 0) != (c > 0)))
+		  // The position is between the two nodes, so it is in the
+		  // subtree of the current node.
+		  break;
+		depth = d;
+		c = cd;
+	      }
+
+	    return(c);
 	  }
 
-	// Gives path to subtree being built.  If branch[N] is false, branch
-	// less from the node at depth N, if true branch greater.
-	bset branch;
+	// Same as start_iter(), but the search starts at the current node
+	// (which must be valid), using climb().
+	void finger_iter(key k, search_type st)
+	  {
+	    const int MASK_HIGH_BIT = (int) ~ ((~ (unsigned) 0) >> 1);
 
-	// If rem[N] is true, then for the current subtree at depth N, it's
-	// greater subtree has one more node than it's less subtree.
-	bset rem;
+	    const int target_cmp = search_target(st);
 
-        // Depth of root node of current subtree.
-	unsigned depth = 0;
+	    int cmp = climb([this, k](handle h) { return(cmp_k_n(k, h)); });
+	    handle h = **this;
+	    unsigned d = depth;
 
-        // Number of nodes in current subtree.
-	size num_sub = num_nodes;
+	    // The key is on the side of each node above in the path that
+	    // the path branches to, so the nearest such node on the target
+	    // side is the best match so far.
+	    depth = unsigned(~0);
+	    if (target_cmp != 0)
+	      for (unsigned i = d; i-- > 0; )
+		if (bool(branch[i]) == (target_cmp > 0))
+		  {
+		    depth = i;
+		    break;
+		  }
 
-	// The algorithm relies on a stack of nodes whose less subtree has
-	// been built, but whose right subtree has not yet been built.  The
-	// stack is implemented as linked list.  The nodes are linked
-	// together by having the "greater" handle of a node set to the
-	// next node in the list.  "less_parent" is the handle of the first
-	// node in the list.
-	handle less_parent = null();
+	    for ( ; ; )
+	      {
+		if (cmp == 0)
+		  {
+		    if (st & EQUAL)
+		      {
+			depth = d;
+			break;
+		      }
+		    cmp = -target_cmp;
+		  }
+		else if (target_cmp != 0)
+		  if (!((cmp ^ target_cmp) & MASK_HIGH_BIT))
+		    // cmp and target_cmp are both negative or both positive.
+		    depth = d;
+		h = cmp < 0 ? get_lt(h) : get_gt(h);
+		if (read_error())
+		  {
+		    depth = unsigned(~0);
+		    break;
+		  }
+		if (h == null())
+		  break;
+		branch[d] = cmp > 0;
+		path_h[d++] = h;
+		cmp = cmp_k_n(k, h);
+	      }
+	  }
 
-	// h is root of current subtree, child is one of its children.
-	handle h, child;
+	friend class base_avl_tree;
 
-	for ( ; ; )
+      };
+
+    // Iterator for trees with parent links.  Has the same public member
+    // functions as path_iter.
+    //
+    class parent_iter
+      {
+      public:
+
+	parent_iter(void) : tree_(nullptr) { }
+
+	void start_iter(base_avl_tree &tree, key k, search_type st = EQUAL)
 	  {
-	    while (num_sub > 2)
-	      {
-		// Subtract one for root of subtree.
-		num_sub--;
-		rem[depth] = !!(num_sub & 1);
-		branch[depth++] = false;
-		num_sub >>= 1;
-	      }
+	    tree_ = &tree;
+	    curr = tree_->search(k, st);
+	  }
 
-	    if (num_sub == 2)
-	      {
-		// Build a subtree with two nodes, slanting to greater.
-		// I arbitrarily chose to always have the extra node in the
-		// greater subtree when there is an odd number of nodes to
-		// split between the two subtrees.
+	void start_iter_least(base_avl_tree &tree)
+	  {
+	    tree_ = &tree;
+	    curr = tree_->search_least();
+	  }
 
-		h = *p;
-		if (read_error())
+	void start_iter_greatest(base_avl_tree &tree)
+	  {
+	    tree_ = &tree;
+	    curr = tree_->search_greatest();
+	  }
+
+	void start_iter_select(base_avl_tree &tree, size n)
+	  {
+	    tree_ = &tree;
+	    curr = tree_->select(n);
+	  }
+
+	handle operator * (void) { return(curr); }
+
+	void operator ++ (void) { step(true); }
+
+	void operator -- (void) { step(false); }
+
+	void operator ++ (int) { ++(*this); }
+
+	void operator -- (int) { --(*this); }
+
+	bool read_error(void) { return(tree_->read_error()); }
+
+      protected:
+
+	// Tree being iterated over.
+	base_avl_tree *tree_;
+
+	// Handle of current node (returned by *).
+	handle curr;
+
+	// Go to the next node in the given direction.
+	void step(bool is_greater)
+	  {
+	    if (curr == null())
+	      return;
+
+	    handle h = child(curr, is_greater);
+	    if (read_error())
+	      {
+		curr = null();
+		return;
+	      }
+
+	    if (h != null())
+	      {
+		// Go to the nearest node in the subtree in the given
+		// direction.
+		do
+		  {
+		    curr = h;
+		    h = child(h, !is_greater);
+		    if (read_error())
+		      {
+			curr = null();
+			return;
+		      }
+		  }
+		while (h != null());
+	      }
+	    else
+	      {
+		// Climb until we come up out of a subtree in the opposite
+		// direction.
+		for ( ; ; )
+		  {
+		    h = tree_->get_par(curr);
+		    if (read_error() or (h == null()))
+		      {
+			curr = null();
+			break;
+		      }
+		    bool from_greater = child(h, true) == curr;
+		    if (read_error())
+		      {
+			curr = null();
+			break;
+		      }
+		    curr = h;
+		    if (from_greater != is_greater)
+		      break;
+		  }
+	      }
+	  }
+
+	handle child(handle h, bool is_greater)
+	  {
+	    return(
+	      is_greater ? tree_->abs.get_greater(h, true) :
+			   tree_->abs.get_less(h, true));
+	  }
+
+	handle null(void) { return(tree_->abs.null()); }
+
+	friend class base_avl_tree;
+
+      };
+
+    typedef
+      typename std::conditional<parent_links, parent_iter, path_iter>::type
+      iter;
+
+    // Removes the node the iterator is at, and returns its handle (or
+    // null if the iterator is invalid, or on a read error).  The path to
+    // the node recorded in the iterator is used, so no nodes are compared.
+    // The iterator is invalid after the call.
+    inline handle remove(path_iter &it);
+
+    // Same as remove_node(*it), with the iterator invalid after the call.
+    handle remove(parent_iter &it)
+      {
+	handle h = it.curr;
+
+	it.curr = null();
+
+	return(h == null() ? h : remove_node(h));
+      }
+
+    // Links the num_nodes nodes of the sequence starting at p, which must
+    // be in ascending key order, into a balanced tree, which replaces the
+    // nodes (if any) that were in the tree.  If the iterator type has
+    // a failed() member function (for example, because the nodes are
+    // being read from a stream), it is called after each node is read
+    // from the sequence, and if it returns true, the build stops, and
+    // the tree is left unchanged (with the links of the nodes already
+    // read undefined).  Returns false on failure or a read error.
+    template<typename fwd_iter>
+    bool build(fwd_iter p, size num_nodes)
+      {
+	handle h;
+
+	if (!build_sub(p, num_nodes, h))
+	  return(false);
+
+	abs.root = h;
+	orphan(h);
+
+	return(true);
+      }
+
+    // Same as build(), except that the num_nodes handles in the sequence
+    // starting at p do not have to be in ascending key order.  The
+    // sequence is sorted (in place) using up to num_threads threads,
+    // and then the tree is linked by up to num_threads threads.  If
+    // num_threads is 0, the number of threads is chosen based on the
+    // number of nodes and the number of CPU cores.  The resulting tree
+    // is identical to the tree build() would produce from the sorted
+    // sequence.  The keys of the nodes must be unique.
+    //
+    // Nodes are only ever accessed by one thread at a time, but
+    // different nodes are accessed concurrently by different threads.
+    // The abstractor member functions must be safe to call under these
+    // conditions (they are if they only access the nodes themselves).
+    //
+    template<typename rand_iter>
+    bool build_unsorted(rand_iter p, size num_nodes, unsigned num_threads = 0)
+      {
+	if (num_threads == 0)
+	  {
+	    num_threads = std::thread::hardware_concurrency();
+
+	    // Don't use threads for less than about this many nodes each.
+	    const size min_per_thread = 1 << 14;
+
+	    while ((num_threads > 1) and
+		   ((num_nodes / num_threads) < min_per_thread))
+	      num_threads >>= 1;
+
+	    if (num_threads == 0)
+	      num_threads = 1;
+	  }
+
+	par_sort(p, num_nodes, num_threads);
+	if (read_error())
+	  return(false);
+
+	handle h;
+
+	if (!par_build_sub(p, num_nodes, num_threads, h))
+	  return(false);
+
+	abs.root = h;
+	orphan(h);
+
+	return(true);
+      }
+
+  protected:
+
+    friend class path_iter;
+    friend class parent_iter;
+
+    // Link the num_nodes nodes in the sequence starting at p into a
+    // balanced subtree, and put its root into sub_root.  The shape of
+    // the subtree depends only on num_nodes.  The less subtree of the
+    // root has (num_nodes - 1) / 2 nodes.
+    //
+    template<typename fwd_iter>
+    bool build_sub(fwd_iter p, size num_nodes, handle &sub_root)
+      {
+	// NOTE:  GCC allows me to define this outside the class definition
+	// using the following syntax:
+	//
+	// template <class abstractor, unsigned max_depth, class bset>
+	// template<typename fwd_iter>
+	// inline void base_avl_tree<abstractor, max_depth, bset, stats_policy>::build(
+	//   fwd_iter p, size num_nodes)
+	//   {
+	//     ...
+	//   }
+	//
+	// but Visual C++ .NET won't accept it.  Is this a GCC extension?
+
+	if (num_nodes == 0)
+	  {
+	    sub_root = null();
+	    return(true);
+	  }
+
+	// Gives path to subtree being built.  If branch[N] is false, branch
+	// less from the node at depth N, if true branch greater.
+	bset branch;
+
+	// If rem[N] is true, then for the current subtree at depth N, it's
+	// greater subtree has one more node than it's less subtree.
+	bset rem;
+
+        // Depth of root node of current subtree.
+	unsigned depth = 0;
+
+        // Number of nodes in current subtree.
+	size num_sub = num_nodes;
+
+	// The algorithm relies on a stack of nodes whose less subtree has
+	// been built, but whose right subtree has not yet been built.  The
+	// stack is implemented as linked list.  The nodes are linked
+	// together by having the "greater" handle of a node set to the
+	// next node in the list.  "less_parent" is the handle of the first
+	// node in the list.
+	handle less_parent = null();
+
+	// h is root of current subtree, child is one of its children.
+	handle h, child;
+
+	for ( ; ; )
+	  {
+	    while (num_sub > 2)
+	      {
+		// Subtract one for root of subtree.
+		num_sub--;
+		rem[depth] = !!(num_sub & 1);
+		branch[depth++] = false;
+		num_sub >>= 1;
+	      }
+
+	    if (num_sub == 2)
+	      {
+		// Build a subtree with two nodes, slanting to greater.
+		// I arbitrarily chose to always have the extra node in the
+		// greater subtree when there is an odd number of nodes to
+		// split between the two subtrees.
+
+		h = *p;
+		if (read_error() or iter_failed(p))
 		  return(false);
 		p++;
 		child = *p;
-		if (read_error())
+		if (read_error() or iter_failed(p))
 		  return(false);
 		p++;
 		set_lt(child, null());
 		set_gt(child, null());
 		set_bf(child, 0);
+		put_size(child, 1);
+		update_node(child);
 		set_gt(h, child);
 		set_lt(h, null());
 		set_bf(h, 1);
+		put_size(h, 2);
+		adopt(child, h);
+		update_node(h);
 	      }
 	    else  // num_sub == 1
 	      {
 		// Build a subtree with one node.
 
 		h = *p;
-		if (read_error())
+		if (read_error() or iter_failed(p))
 		  return(false);
 		p++;
 		set_lt(h, null());
 		set_gt(h, null());
 		set_bf(h, 0);
+		put_size(h, 1);
+		update_node(h);
 	      }
 
 	    while (depth)
@@ -463,9 +1238,12 @@ class base_avl_tree
 		if (read_error())
 		  return(false);
 		set_gt(h, child);
+		adopt(child, h);
 		// num_sub = 2 * (num_sub - rem[depth]) + rem[depth] + 1
 		num_sub <<= 1;
 		num_sub += 1 - rem[depth];
+		put_size(h, num_sub);
+		update_node(h);
 		if (num_sub & (num_sub - 1))
 		  // num_sub is not a power of 2
 		  set_bf(h, 0);
@@ -483,10 +1261,11 @@ class base_avl_tree
 
 	    child = h;
 	    h = *p;
-	    if (read_error())
+	    if (read_error() or iter_failed(p))
 	      return(false);
 	    p++;
 	    set_lt(h, child);
+	    adopt(child, h);
 
 	    // Put h into stack of less parents.
 	    set_gt(h, less_parent);
@@ -498,14 +1277,82 @@ class base_avl_tree
 
 	  } // end for ( ; ; )
 
-	abs.root = h;
+	sub_root = h;
 
 	return(true);
       }
 
-  protected:
+    // Sort the num_nodes handles starting at p into ascending key order,
+    // using up to num_threads threads.
+    template<typename rand_iter>
+    void par_sort(rand_iter p, size num_nodes, unsigned num_threads)
+      {
+	// Not counted by the stats policy, since this may be called
+	// concurrently.
+	auto less = [this](handle h1, handle h2)
+	  { return(abs.compare_node_node(h1, h2) < 0); };
+
+	if (num_threads < 2)
+	  {
+	    std::sort(p, p + num_nodes, less);
+	    return;
+	  }
+
+	size half = num_nodes / 2;
+
+	std::thread t(
+	  [=]() { this->par_sort(p, half, num_threads / 2); });
+	par_sort(p + half, num_nodes - half, num_threads - num_threads / 2);
+	t.join();
+
+	std::inplace_merge(p, p + half, p + num_nodes, less);
+      }
+
+    // Same as build_sub(), but uses up to num_threads threads.
+    template<typename rand_iter>
+    bool par_build_sub(
+      rand_iter p, size num_nodes, unsigned num_threads, handle &sub_root)
+      {
+	if ((num_threads < 2) or (num_nodes < 3))
+	  return(build_sub(p, num_nodes, sub_root));
+
+	// Split the same way as build_sub() does.
+	size num_less = (num_nodes - 1) / 2;
+	handle less_root, greater_root;
+	bool less_ok;
+
+	std::thread t(
+	  [=, &less_root, &less_ok]()
+	    {
+	      less_ok =
+		this->par_build_sub(p, num_less, num_threads / 2, less_root);
+	    });
+	bool greater_ok =
+	  par_build_sub(
+	    p + (num_less + 1), num_nodes - num_less - 1,
+	    num_threads - num_threads / 2, greater_root);
+	t.join();
+
+	if (!less_ok or !greater_ok)
+	  return(false);
+
+	handle h = p[num_less];
+	if (read_error())
+	  return(false);
 
-    friend class iter;
+	set_lt(h, less_root);
+	set_gt(h, greater_root);
+	// The greater subtree is deeper only if num_nodes is a power of 2.
+	set_bf(h, (num_nodes & (num_nodes - 1)) ? 0 : 1);
+	put_size(h, num_nodes);
+	adopt(less_root, h);
+	adopt(greater_root, h);
+	update_node(h);
+
+	sub_root = h;
+
+	return(true);
+      }
 
     // Create a class whose sole purpose is to take advantage of
     // the "empty member" optimization.
@@ -526,17 +1373,648 @@ class base_avl_tree
       { return(abs.get_greater(h, access)); }
     void set_gt(handle h, handle gh) { abs.set_greater(h, gh); }
 
+    // True if the iterator has failed() and it returns true.
+    template<typename fwd_iter>
+    bool iter_failed(const fwd_iter &p)
+      {
+	return(
+	  iter_failed(
+	    p,
+	    std::integral_constant<
+	      bool, impl::avl_iter_has_failed<fwd_iter>::value>()));
+      }
+    template<typename fwd_iter>
+    bool iter_failed(const fwd_iter &, std::false_type) { return(false); }
+    template<typename fwd_iter>
+    bool iter_failed(const fwd_iter &p, std::true_type)
+      { return(p.failed()); }
+
+    bool read_error(std::false_type) { return(false); }
+    bool read_error(std::true_type)
+      {
+	if (abs.read_error())
+	  {
+	    stats_policy::count_read_error();
+	    return(true);
+	  }
+	return(false);
+      }
+
+    handle get_child(handle h, bool greater)
+      {
+	return(
+	  get_child(
+	    h, greater,
+	    std::integral_constant<
+	      bool, impl::avl_has_get_child<abstractor>::value>()));
+      }
+    handle get_child(handle h, bool greater, std::false_type)
+      { return(greater ? get_gt(h) : get_lt(h)); }
+    handle get_child(handle h, bool greater, std::true_type)
+      { return(abs.get_child(h, greater, true)); }
+
     int get_bf(handle h) { return(abs.get_balance_factor(h)); }
     void set_bf(handle h, int bf) { abs.set_balance_factor(h, bf); }
 
-    int cmp_k_n(key k, handle h) { return(abs.compare_key_node(k, h)); }
+    int cmp_k_n(key k, handle h)
+      {
+	stats_policy::count_comparison();
+	return(abs.compare_key_node(k, h));
+      }
     int cmp_n_n(handle h1, handle h2)
-      { return(abs.compare_node_node(h1, h2)); }
+      {
+	stats_policy::count_comparison();
+	return(abs.compare_node_node(h1, h2));
+      }
 
     handle null(void) { return(abs.null()); }
 
+    // Number of searches search_many() does in lock-step.
+    static const unsigned search_lanes = 16;
+
+    // Returns the comparison result for which a node is a candidate for
+    // the search type (0 if only an equal node matches).
+    static int search_target(search_type st)
+      {
+	if (st & LESS)
+	  return(1);
+	if (st & GREATER)
+	  return(-1);
+	return(0);
+      }
+
+    // One step of a search for k, at node h.  match_h is the best match
+    // so far.  Returns false if the search is finished (with the result
+    // in match_h).  Otherwise, h is changed to the next node to look at.
+    bool search_step(
+      key k, search_type st, int target_cmp, handle &h, handle &match_h)
+      {
+	const int MASK_HIGH_BIT = (int) ~ ((~ (unsigned) 0) >> 1);
+
+	if (h == null())
+	  return(false);
+
+	int cmp = cmp_k_n(k, h);
+	if (cmp == 0)
+	  {
+	    if (st & EQUAL)
+	      {
+		match_h = h;
+		return(false);
+	      }
+	    cmp = -target_cmp;
+	  }
+	else if (target_cmp != 0)
+	  if (!((cmp ^ target_cmp) & MASK_HIGH_BIT))
+	    // cmp and target_cmp are both positive or both negative.
+	    match_h = h;
+	h = get_child(h, cmp > 0);
+	if (read_error())
+	  {
+	    match_h = null();
+	    return(false);
+	  }
+	return(h != null());
+      }
+
+    // Calls the abstractor's prefetch() for h, if it has one and h is
+    // not null.
+    void prefetch(handle h)
+      {
+	prefetch(
+	  h,
+	  std::integral_constant<
+	    bool, impl::avl_has_prefetch<abstractor>::value>());
+      }
+    void prefetch(handle, std::false_type) { }
+    void prefetch(handle h, std::true_type)
+      {
+	if (h != null())
+	  abs.prefetch(h);
+      }
+
+    // Parent link helpers.  All but get_par() do nothing if the
+    // abstractor does not have parent links.
+
+    typedef std::integral_constant<bool, parent_links> parent_links_t;
+
+    handle get_par(handle h, bool access = true)
+      { return(abs.get_parent(h, access)); }
+
+    // Make h the parent of its less child.
+    void adopt_lt(handle h) { adopt_lt(h, parent_links_t()); }
+    void adopt_lt(handle, std::false_type) { }
+    void adopt_lt(handle h, std::true_type) { adopt(get_lt(h), h); }
+
+    // Make h the parent of its greater child.
+    void adopt_gt(handle h) { adopt_gt(h, parent_links_t()); }
+    void adopt_gt(handle, std::false_type) { }
+    void adopt_gt(handle h, std::true_type) { adopt(get_gt(h), h); }
+
+    // Make h the parent of child (if child is not null).
+    void adopt(handle child, handle h)
+      { adopt(child, h, parent_links_t()); }
+    void adopt(handle, handle, std::false_type) { }
+    void adopt(handle child, handle h, std::true_type)
+      {
+	if (child != null())
+	  abs.set_parent(child, h);
+      }
+
+    // Give node h the same parent as node old_h.  h is taking the place
+    // of old_h in the tree.
+    void take_par(handle h, handle old_h)
+      { take_par(h, old_h, parent_links_t()); }
+    void take_par(handle, handle, std::false_type) { }
+    void take_par(handle h, handle old_h, std::true_type)
+      { abs.set_parent(h, get_par(old_h)); }
+
+    // Set the parent link of h (if h is not null) to make it the root.
+    void orphan(handle h) { adopt(h, null()); }
+
+    // Subtree size helpers.  All but sub_size() do nothing if the
+    // abstractor does not have subtree sizes.
+
+    typedef std::integral_constant<bool, subtree_sizes> subtree_sizes_t;
+
+    // Returns the size of the subtree whose root is h (or 0 if h is
+    // null).
+    size sub_size(handle h)
+      { return(h == null() ? size(0) : abs.get_size(h)); }
+
+    void put_size(handle h, size s) { put_size(h, s, subtree_sizes_t()); }
+    void put_size(handle, size, std::false_type) { }
+    void put_size(handle h, size s, std::true_type) { abs.set_size(h, s); }
+
+    // Give node h the same subtree size as node from_h.
+    void copy_size(handle h, handle from_h)
+      { copy_size(h, from_h, subtree_sizes_t()); }
+    void copy_size(handle, handle, std::false_type) { }
+    void copy_size(handle h, handle from_h, std::true_type)
+      { abs.set_size(h, abs.get_size(from_h)); }
+
+    // Recalculate the size of the subtree with root h from the sizes of
+    // its child subtrees.
+    void fix_size(handle h) { fix_size(h, subtree_sizes_t()); }
+    void fix_size(handle, std::false_type) { }
+    void fix_size(handle h, std::true_type)
+      { abs.set_size(h, 1 + sub_size(get_lt(h)) + sub_size(get_gt(h))); }
+
+    // Add one to the size of each node on the path (specified as for
+    // path_iter) from the root to the node h, not including h.
+    void grow_path(bset &branch, handle h)
+      { grow_path(branch, h, subtree_sizes_t()); }
+    void grow_path(bset &, handle, std::false_type) { }
+    void grow_path(bset &branch, handle h, std::true_type)
+      {
+	handle hh = abs.root;
+	unsigned depth = 0;
+
+	while (hh != h)
+	  {
+	    abs.set_size(hh, abs.get_size(hh) + 1);
+	    hh = branch[depth++] ? get_gt(hh) : get_lt(hh);
+	    if (read_error())
+	      break;
+	  }
+      }
+
+    // Node update helpers.  They do nothing if the abstractor does not
+    // have update().
+
+    typedef std::integral_constant<bool, augmented> augmented_t;
+
+    void update_node(handle h) { update_node(h, augmented_t()); }
+    void update_node(handle, std::false_type) { }
+    void update_node(handle h, std::true_type) { abs.update(h); }
+
+    // Recalculate the size (if any) of the subtree with root h, and then
+    // call update() for h.
+    void fix_node(handle h)
+      {
+	fix_size(h);
+	update_node(h);
+      }
+
+    // Call update() for each node on the path (specified as for
+    // path_iter) from the root to the node h, including h, from h up.
+    void update_path(bset &branch, handle h)
+      { update_path(branch, h, augmented_t()); }
+    void update_path(bset &, handle, std::false_type) { }
+    void update_path(bset &branch, handle h, std::true_type)
+      {
+	handle path_h[max_depth];
+	handle hh = abs.root;
+	unsigned depth = 0;
+
+	for ( ; ; )
+	  {
+	    path_h[depth] = hh;
+	    if (hh == h)
+	      break;
+	    hh = branch[depth++] ? get_gt(hh) : get_lt(hh);
+	    if (read_error())
+	      return;
+	  }
+
+	for ( ; ; )
+	  {
+	    abs.update(path_h[depth]);
+	    if (depth == 0)
+	      break;
+	    depth--;
+	  }
+      }
+
   private:
 
+    // A subtree, and its height (0 if it is empty), for splitting and
+    // joining subtrees.  Balance factors give the heights of the
+    // subtrees of a node from its height, so heights only have to be
+    // found (by descending the tree) for whole trees.
+    struct sub_tree
+      {
+	handle root;
+	int height;
+      };
+
+    sub_tree empty_sub(void)
+      {
+	sub_tree t = { null(), 0 };
+	return(t);
+      }
+
+    // The whole tree.
+    sub_tree whole(void)
+      {
+	sub_tree t = { abs.root, 0 };
+
+	for (handle h = abs.root; h != null(); t.height++)
+	  {
+	    h = get_bf(h) < 0 ? get_lt(h) : get_gt(h);
+	    if (read_error())
+	      return(empty_sub());
+	  }
+
+	return(t);
+      }
+
+    // Make the subtree t the whole tree.
+    void set_whole(sub_tree t)
+      {
+	abs.root = t.root;
+	orphan(t.root);
+      }
+
+    // The less and greater subtrees of the (non-empty) subtree t.
+    sub_tree less_sub(sub_tree t)
+      {
+	sub_tree s =
+	  { get_lt(t.root), t.height - (get_bf(t.root) > 0 ? 2 : 1) };
+	return(s);
+      }
+    sub_tree greater_sub(sub_tree t)
+      {
+	sub_tree s =
+	  { get_gt(t.root), t.height - (get_bf(t.root) < 0 ? 2 : 1) };
+	return(s);
+      }
+
+    // Makes l and r the less and greater subtrees of the node m, whose
+    // heights must differ by no more than one.
+    sub_tree join_node(sub_tree l, handle m, sub_tree r)
+      {
+	set_lt(m, l.root);
+	set_gt(m, r.root);
+	set_bf(m, r.height - l.height);
+	adopt_lt(m);
+	adopt_gt(m);
+	fix_node(m);
+
+	sub_tree t = { m, (l.height > r.height ? l.height : r.height) + 1 };
+	return(t);
+      }
+
+    // Joins the subtree l, the node m, and the subtree r, where the keys
+    // in l are less than the key of m, and the keys in r greater.
+    sub_tree join3(sub_tree l, handle m, sub_tree r)
+      {
+	if (l.height > (r.height + 1))
+	  return(join_right(l, m, r));
+	if (r.height > (l.height + 1))
+	  return(join_left(l, m, r));
+	return(join_node(l, m, r));
+      }
+
+    // join3(), where l is more than one deeper than r.  m and r are
+    // joined to the subtree at the depth in the right spine of l where
+    // they fit, and the rebalancing is then as for an insert.
+    sub_tree join_right(sub_tree l, handle m, sub_tree r)
+      {
+	handle h = l.root;
+	sub_tree ll = less_sub(l), c = greater_sub(l);
+	if (read_error())
+	  return(empty_sub());
+
+	c = c.height <= (r.height + 1) ?
+	      join_node(c, m, r) : join_right(c, m, r);
+	set_gt(h, c.root);
+	adopt_gt(h);
+
+	int bf = c.height - ll.height;
+	if (bf < 2)
+	  {
+	    set_bf(h, bf);
+	    fix_node(h);
+	    sub_tree t = { h, (bf < 0 ? ll.height : c.height) + 1 };
+	    return(t);
+	  }
+
+	// The greater subtree is two deeper.  Only the sign of the balance
+	// factor of h is used by balance().  If c is balanced, the single
+	// rotation does not reduce the height.
+	set_bf(h, 1);
+	int deep_bf = get_bf(c.root);
+	sub_tree t = { balance(h), c.height + (deep_bf == 0 ? 1 : 0) };
+	return(t);
+      }
+
+    // join3(), where r is more than one deeper than l.
+    sub_tree join_left(sub_tree l, handle m, sub_tree r)
+      {
+	handle h = r.root;
+	sub_tree c = less_sub(r), rr = greater_sub(r);
+	if (read_error())
+	  return(empty_sub());
+
+	c = c.height <= (l.height + 1) ?
+	      join_node(l, m, c) : join_left(l, m, c);
+	set_lt(h, c.root);
+	adopt_lt(h);
+
+	int bf = rr.height - c.height;
+	if (bf > -2)
+	  {
+	    set_bf(h, bf);
+	    fix_node(h);
+	    sub_tree t = { h, (bf > 0 ? rr.height : c.height) + 1 };
+	    return(t);
+	  }
+
+	set_bf(h, -1);
+	int deep_bf = get_bf(c.root);
+	sub_tree t = { balance(h), c.height + (deep_bf == 0 ? 1 : 0) };
+	return(t);
+      }
+
+    // Removes the greatest node from the (non-empty) subtree t, and puts
+    // its handle in last.  Returns the rest of the subtree.
+    sub_tree split_last(sub_tree t, handle &last)
+      {
+	sub_tree ls = less_sub(t), gs = greater_sub(t);
+	if (read_error())
+	  return(empty_sub());
+
+	if (gs.root == null())
+	  {
+	    last = t.root;
+	    return(ls);
+	  }
+
+	gs = split_last(gs, last);
+
+	return(join3(ls, t.root, gs));
+      }
+
+    // Joins the subtrees l and r, where the keys in l are less than the
+    // keys in r.
+    sub_tree join2(sub_tree l, sub_tree r)
+      {
+	if (l.root == null())
+	  return(r);
+	if (r.root == null())
+	  return(l);
+
+	handle m;
+	l = split_last(l, m);
+
+	return(join3(l, m, r));
+      }
+
+    // Splits the subtree t into l, with the nodes less than the key or
+    // node that cmp compares with, and r, with the nodes greater.  cmp(h)
+    // returns the result of comparing the key or node with the node h.
+    // Returns the node that compared equal, or null if none did.
+    template <class compare>
+    handle split_sub(sub_tree t, compare cmp, sub_tree &l, sub_tree &r)
+      {
+	if (t.root == null())
+	  {
+	    l = r = t;
+	    return(null());
+	  }
+
+	sub_tree ls = less_sub(t), gs = greater_sub(t);
+	int c = cmp(t.root);
+	if (read_error())
+	  {
+	    l = r = empty_sub();
+	    return(null());
+	  }
+
+	if (c == 0)
+	  {
+	    l = ls;
+	    r = gs;
+	    return(t.root);
+	  }
+
+	handle found;
+
+	if (c < 0)
+	  {
+	    found = split_sub(ls, cmp, l, ls);
+	    r = join3(ls, t.root, gs);
+	  }
+	else
+	  {
+	    found = split_sub(gs, cmp, gs, r);
+	    l = join3(ls, t.root, gs);
+	  }
+
+	return(found);
+      }
+
+    // Split the subtree t by the key of the node m.
+    handle split_by_node(handle m, sub_tree t, sub_tree &l, sub_tree &r)
+      {
+	return(
+	  split_sub(t, [this, m](handle h) { return(cmp_n_n(m, h)); }, l, r));
+      }
+
+    // Does unite() for the subtrees t1 (of this tree) and t2 (of other).
+    // u is the union, and dup has the nodes of t2 left out of it.
+    void unite_sub(
+      sub_tree t1, sub_tree t2, unsigned num_threads, sub_tree &u,
+      sub_tree &dup)
+      {
+	if ((t1.root == null()) or (t2.root == null()))
+	  {
+	    u = t1.root == null() ? t2 : t1;
+	    dup = empty_sub();
+	    return;
+	  }
+
+	handle m = t1.root;
+	sub_tree l1 = less_sub(t1), r1 = greater_sub(t1), l2, r2;
+	handle f = split_by_node(m, t2, l2, r2);
+	sub_tree ul, ur, dl, dr;
+
+	if (num_threads >= 2)
+	  {
+	    std::thread t(
+	      [=, &ul, &dl]()
+		{ this->unite_sub(l1, l2, num_threads / 2, ul, dl); });
+	    unite_sub(r1, r2, num_threads - num_threads / 2, ur, dr);
+	    t.join();
+	  }
+	else
+	  {
+	    unite_sub(l1, l2, 1, ul, dl);
+	    unite_sub(r1, r2, 1, ur, dr);
+	  }
+
+	u = join3(ul, m, ur);
+	dup = f == null() ? join2(dl, dr) : join3(dl, f, dr);
+      }
+
+    // Partitions the subtree t1 (of this tree) into in, the nodes whose
+    // keys are keys of nodes in the subtree t2 (of other), and out, the
+    // rest.  t2_out is t2 after being split and rejoined.
+    void partition_sub(
+      sub_tree t1, sub_tree t2, unsigned num_threads, sub_tree &in,
+      sub_tree &out, sub_tree &t2_out)
+      {
+	if ((t1.root == null()) or (t2.root == null()))
+	  {
+	    in = empty_sub();
+	    out = t1;
+	    t2_out = t2;
+	    return;
+	  }
+
+	handle m = t1.root;
+	sub_tree l1 = less_sub(t1), r1 = greater_sub(t1), l2, r2;
+	handle f = split_by_node(m, t2, l2, r2);
+	sub_tree inl, inr, outl, outr, t2l, t2r;
+
+	if (num_threads >= 2)
+	  {
+	    std::thread t(
+	      [=, &inl, &outl, &t2l]()
+		{
+		  this->partition_sub(
+		    l1, l2, num_threads / 2, inl, outl, t2l);
+		});
+	    partition_sub(
+	      r1, r2, num_threads - num_threads / 2, inr, outr, t2r);
+	    t.join();
+	  }
+	else
+	  {
+	    partition_sub(l1, l2, 1, inl, outl, t2l);
+	    partition_sub(r1, r2, 1, inr, outr, t2r);
+	  }
+
+	if (f != null())
+	  {
+	    in = join3(inl, m, inr);
+	    out = join2(outl, outr);
+	    t2_out = join3(t2l, f, t2r);
+	  }
+	else
+	  {
+	    in = join2(inl, inr);
+	    out = join3(outl, m, outr);
+	    t2_out = join2(t2l, t2r);
+	  }
+      }
+
+    // Does intersect() if in_is_kept is true, otherwise subtract().
+    inline bool partition(
+      base_avl_tree &other, base_avl_tree &removed, unsigned num_threads,
+      bool in_is_kept);
+
+    // Does visit_range() for the subtree with root h.  If check_lo is
+    // false, all the nodes in the subtree have keys not less than lo.  If
+    // check_hi is false, all the nodes have keys less than hi.
+    template <class visitor>
+    bool visit_range_sub(
+      handle h, key lo, key hi, bool check_lo, bool check_hi, visitor &f)
+      {
+	while (h != null())
+	  {
+	    bool ge_lo = !check_lo or (cmp_k_n(lo, h) <= 0);
+	    bool lt_hi = !check_hi or (cmp_k_n(hi, h) > 0);
+
+	    if (ge_lo)
+	      {
+		handle lh = get_lt(h);
+		if (read_error())
+		  return(false);
+		if (!visit_range_sub(lh, lo, hi, check_lo, !lt_hi, f))
+		  return(false);
+		if (lt_hi and !f(h))
+		  return(false);
+	      }
+
+	    if (!lt_hi)
+	      break;
+
+	    // Loop rather than recurse into the greater subtree.
+	    check_lo = !ge_lo;
+	    h = get_gt(h);
+	    if (read_error())
+	      return(false);
+	  }
+
+	return(true);
+      }
+
+    inline size count_range(key lo, key hi, std::true_type);
+
+    size count_range(key lo, key hi, std::false_type)
+      {
+	size n = 0;
+
+	if (!visit_range(lo, hi, [&n](handle) { ++n; return(true); }))
+	  return(0);
+
+	return(n);
+      }
+
+    // remove_node() for when the abstractor has parent links, and for
+    // when it does not.
+    inline handle remove_node(handle h, std::true_type);
+    inline handle remove_node(handle h, std::false_type);
+
+    // Removes the node rm, at depth depth, whose parent is parent.
+    // branch[0] to branch[depth - 1] must give the path to it from the
+    // root.
+    inline handle remove_path(
+      bset &branch, unsigned depth, handle parent, handle rm);
+
+    // Links the new leaf node h, at depth depth, into the tree as a child
+    // of parent, and rebalances.  branch[0] to branch[depth - 1] must
+    // give the path to it from the root.  unbal is the deepest node in
+    // the path with a non-zero balance factor (null if there is none),
+    // at depth unbal_depth, and parent_unbal is its parent.  On return,
+    // unbal is the root of the subtree that was rebalanced by rotation,
+    // or null if there was no rotation.  Returns false on a read error.
+    inline bool link_leaf(
+      handle h, unsigned depth, handle parent, bset &branch, handle &unbal,
+      handle parent_unbal, unsigned unbal_depth);
+
     // Balances subtree, returns handle of root node of subtree
     // after balancing.
     handle balance(handle bal_h)
@@ -557,14 +2035,23 @@ class base_avl_tree
 
 	    if (get_bf(deep_h) < 0)
 	      {
+		stats_policy::count_double_rotation();
 		handle old_h = bal_h;
 		bal_h = get_lt(deep_h);
 		if (read_error())
 		  return(null());
+		take_par(bal_h, old_h);
 		set_gt(old_h, get_lt(bal_h, false));
 		set_lt(deep_h, get_gt(bal_h, false));
 		set_lt(bal_h, old_h);
 		set_gt(bal_h, deep_h);
+		adopt_gt(old_h);
+		adopt_lt(deep_h);
+		adopt_lt(bal_h);
+		adopt_gt(bal_h);
+		fix_node(old_h);
+		fix_node(deep_h);
+		fix_node(bal_h);
 
 		int bf = get_bf(bal_h);
 		if (bf != 0)
@@ -589,8 +2076,14 @@ class base_avl_tree
 	      }
 	    else
 	      {
+		stats_policy::count_single_rotation();
+		take_par(deep_h, bal_h);
 		set_gt(bal_h, get_lt(deep_h, false));
 		set_lt(deep_h, bal_h);
+		adopt_gt(bal_h);
+		adopt_lt(deep_h);
+		fix_node(bal_h);
+		fix_node(deep_h);
 		if (get_bf(deep_h) == 0)
 		  {
 		    set_bf(deep_h, -1);
@@ -614,14 +2107,23 @@ class base_avl_tree
 
 	    if (get_bf(deep_h) > 0)
 	      {
+		stats_policy::count_double_rotation();
 		handle old_h = bal_h;
 		bal_h = get_gt(deep_h);
 		if (read_error())
 		  return(null());
+		take_par(bal_h, old_h);
 		set_lt(old_h, get_gt(bal_h, false));
 		set_gt(deep_h, get_lt(bal_h, false));
 		set_gt(bal_h, old_h);
 		set_lt(bal_h, deep_h);
+		adopt_lt(old_h);
+		adopt_gt(deep_h);
+		adopt_gt(bal_h);
+		adopt_lt(bal_h);
+		fix_node(old_h);
+		fix_node(deep_h);
+		fix_node(bal_h);
 
 		int bf = get_bf(bal_h);
 		if (bf != 0)
@@ -646,8 +2148,14 @@ class base_avl_tree
 	      }
 	    else
 	      {
+		stats_policy::count_single_rotation();
+		take_par(deep_h, bal_h);
 		set_lt(bal_h, get_gt(deep_h, false));
 		set_gt(deep_h, bal_h);
+		adopt_lt(bal_h);
+		adopt_gt(deep_h);
+		fix_node(bal_h);
+		fix_node(deep_h);
 		if (get_bf(deep_h) == 0)
 		  {
 		    set_bf(deep_h, 1);
@@ -667,24 +2175,28 @@ class base_avl_tree
 
   };
 
-template <class abstractor, unsigned max_depth, class bset>
-inline auto base_avl_tree<abstractor, max_depth, bset>::insert(handle h)
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto base_avl_tree<abstractor, max_depth, bset, stats_policy>::insert(handle h)
   -> handle
   {
     set_lt(h, null());
     set_gt(h, null());
     set_bf(h, 0);
+    put_size(h, 1);
 
     if (abs.root == null())
-      abs.root = h;
+      {
+	abs.root = h;
+	orphan(h);
+	update_node(h);
+      }
     else
       {
 	// Last unbalanced node encountered in search for insertion point.
 	handle unbal = null();
 	// Parent of last unbalanced node.
 	handle parent_unbal = null();
-	// Balance factor of last unbalanced node.
-	int unbal_bf;
 
 	// Zero-based depth in tree.
 	unsigned depth = 0, unbal_depth = 0;
@@ -712,131 +2224,309 @@ inline auto base_avl_tree<abstractor, max_depth, bset>::insert(handle h)
 	      // Duplicate key.
 	      return(hh);
 	    parent = hh;
-	    hh = cmp < 0 ? get_lt(hh) : get_gt(hh);
+	    hh = get_child(hh, cmp > 0);
 	    if (read_error())
 	      return(null());
 	    branch[depth++] = cmp > 0;
 	  }
 	while (hh != null());
 
-	//  Add node to insert as leaf of tree.
-	if (cmp < 0)
-	  set_lt(parent, h);
-	else
-	  set_gt(parent, h);
+	if (!link_leaf(
+	       h, depth, parent, branch, unbal, parent_unbal, unbal_depth))
+	  return(null());
+      }
+
+    return(h);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::insert(
+    handle h, path_iter &hint) -> handle
+  {
+    if (abs.root == null())
+      {
+	insert(h);
+	hint.tree_ = this;
+	hint.depth = 0;
+	return(h);
+      }
+
+    if (hint.depth == unsigned(~0))
+      {
+	// Start at the root.
+	hint.tree_ = this;
+	hint.depth = 0;
+      }
+
+    int cmp = hint.climb([this, h](handle hh) { return(cmp_n_n(h, hh)); });
+    unsigned depth = hint.depth;
+    handle parent = *hint;
+
+    if (cmp == 0)
+      // Duplicate key.
+      return(parent);
+
+    for ( ; ; )
+      {
+	handle hh = get_child(parent, cmp > 0);
+	if (read_error())
+	  {
+	    hint.depth = unsigned(~0);
+	    return(null());
+	  }
+	hint.branch[depth++] = cmp > 0;
+	if (hh == null())
+	  break;
+	hint.path_h[depth - 1] = hh;
+	parent = hh;
+	cmp = cmp_n_n(h, hh);
+	if (cmp == 0)
+	  {
+	    // Duplicate key.
+	    hint.depth = depth;
+	    return(hh);
+	  }
+      }
+
+    set_lt(h, null());
+    set_gt(h, null());
+    set_bf(h, 0);
+    put_size(h, 1);
+
+    // Find the last unbalanced node in the path to h.
+    handle unbal = null(), parent_unbal = null();
+    unsigned unbal_depth = depth;
+    while (unbal_depth-- > 0)
+      if (get_bf(hint.path_node(unbal_depth)) != 0)
+	{
+	  unbal = hint.path_node(unbal_depth);
+	  if (unbal_depth > 0)
+	    parent_unbal = hint.path_node(unbal_depth - 1);
+	  break;
+	}
+    if (unbal == null())
+      unbal_depth = 0;
+
+    hint.path_h[depth - 1] = h;
+    hint.depth = depth;
+
+    // Node that will be rotated down, and its child in the path.
+    handle u = unbal, c = null();
+    if (unbal != null())
+      c = hint.path_node(unbal_depth + 1);
+
+    if (!link_leaf(
+	   h, depth, parent, hint.branch, unbal, parent_unbal, unbal_depth))
+      {
+	hint.depth = unsigned(~0);
+	return(null());
+      }
+
+    if (unbal != null())
+      {
+	// u was rotated down, so remove it from the path.
+	unsigned d;
+	for (d = unbal_depth; d < hint.depth; d++)
+	  {
+	    hint.branch[d] = bool(hint.branch[d + 1]);
+	    if (d > 0)
+	      hint.path_h[d - 1] = hint.path_h[d];
+	  }
+	hint.depth--;
+
+	if (unbal != c)
+	  {
+	    // Double rotation.  The grandchild g of u in the path, which
+	    // is now one above where u was, was rotated up to where u was.
+	    // The old children of g became children of u and c.
+	    d = unbal_depth;
+	    if (d > 0)
+	      hint.path_h[d - 1] = unbal;
+	    if (hint.depth == (d + 1))
+	      // h is g.
+	      hint.depth = d;
+	    else
+	      {
+		bool c_is_gt = !hint.branch[d];
+		bool gc_is_gt = hint.branch[d + 1];
+		hint.path_h[d] = gc_is_gt == c_is_gt ? c : u;
+		hint.branch[d] = gc_is_gt;
+		hint.branch[d + 1] = !gc_is_gt;
+	      }
+	  }
+      }
+
+    return(h);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::link_leaf(
+    handle h, unsigned depth, handle parent, bset &branch, handle &unbal,
+    handle parent_unbal, unsigned unbal_depth)
+  {
+    int cmp;
+    handle hh;
+
+    if (branch[depth - 1])
+      set_gt(parent, h);
+    else
+      set_lt(parent, h);
+    adopt(h, parent);
 
-	depth = unbal_depth;
+    grow_path(branch, h);
+    update_path(branch, h);
+    if (read_error())
+      return(false);
 
-	if (unbal == null())
-	  hh = abs.root;
-	else
+    depth = unbal_depth;
+
+    if (unbal == null())
+      hh = abs.root;
+    else
+      {
+	cmp = branch[depth++] ? 1 : -1;
+	int unbal_bf = get_bf(unbal);
+	if (cmp < 0)
+	  unbal_bf--;
+	else  // cmp > 0
+	  unbal_bf++;
+	hh = cmp < 0 ? get_lt(unbal) : get_gt(unbal);
+	if (read_error())
+	  return(false);
+	if ((unbal_bf != -2) && (unbal_bf != 2))
 	  {
-	    cmp = branch[depth++] ? 1 : -1;
-	    unbal_bf = get_bf(unbal);
-	    if (cmp < 0)
-	      unbal_bf--;
-	    else  // cmp > 0
-	      unbal_bf++;
-	    hh = cmp < 0 ? get_lt(unbal) : get_gt(unbal);
-	    if (read_error())
-	      return(null());
-	    if ((unbal_bf != -2) && (unbal_bf != 2))
-	      {
-		// No rebalancing of tree is necessary.
-		set_bf(unbal, unbal_bf);
-		unbal = null();
-	      }
+	    // No rebalancing of tree is necessary.
+	    set_bf(unbal, unbal_bf);
+	    unbal = null();
 	  }
+      }
 
-	if (hh != null())
-	  while (h != hh)
+    if (hh != null())
+      while (h != hh)
+	{
+	  cmp = branch[depth++] ? 1 : -1;
+	  if (cmp < 0)
 	    {
-	      cmp = branch[depth++] ? 1 : -1;
-	      if (cmp < 0)
-		{
-		  set_bf(hh, -1);
-		  hh = get_lt(hh);
-		}
-	      else // cmp > 0
-		{
-		  set_bf(hh, 1);
-		  hh = get_gt(hh);
-		}
-	      if (read_error())
-		return(null());
+	      set_bf(hh, -1);
+	      hh = get_lt(hh);
 	    }
+	  else // cmp > 0
+	    {
+	      set_bf(hh, 1);
+	      hh = get_gt(hh);
+	    }
+	  if (read_error())
+	    return(false);
+	}
 
-	if (unbal != null())
+    if (unbal != null())
+      {
+	unbal = balance(unbal);
+	if (read_error())
+	  return(false);
+	if (parent_unbal == null())
+	  abs.root = unbal;
+	else
 	  {
-	    unbal = balance(unbal);
-	    if (read_error())
-	      return(null());
-	    if (parent_unbal == null())
-	      abs.root = unbal;
-	    else
-	      {
-		depth = unbal_depth - 1;
-		cmp = branch[depth] ? 1 : -1;
-		if (cmp < 0)
-		  set_lt(parent_unbal, unbal);
-		else  // cmp > 0
-		  set_gt(parent_unbal, unbal);
-	      }
+	    depth = unbal_depth - 1;
+	    cmp = branch[depth] ? 1 : -1;
+	    if (cmp < 0)
+	      set_lt(parent_unbal, unbal);
+	    else  // cmp > 0
+	      set_gt(parent_unbal, unbal);
 	  }
-
       }
 
-    return(h);
+    return(true);
   }
 
-template <class abstractor, unsigned max_depth, class bset>
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
 inline auto
-  base_avl_tree<abstractor, max_depth, bset>::search(key k, search_type st)
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::search(key k, search_type st)
   -> handle
   {
-    const int MASK_HIGH_BIT = (int) ~ ((~ (unsigned) 0) >> 1);
-
-    int cmp, target_cmp;
+    const int target_cmp = search_target(st);
     handle match_h = null();
     handle h = abs.root;
 
-    if (st & LESS)
-      target_cmp = 1;
-    else if (st & GREATER)
-      target_cmp = -1;
+    while (search_step(k, st, target_cmp, h, match_h))
+      ;
+
+    return(match_h);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::search(
+    key k, search_type st, path_iter &it) -> handle
+  {
+    if (it.depth == unsigned(~0))
+      it.start_iter(*this, k, st);
     else
-      target_cmp = 0;
+      it.finger_iter(k, st);
 
-    while (h != null())
+    return(*it);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline void
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::search_many(
+    const key *k, size n, handle *out, search_type st)
+  {
+    const int target_cmp = search_target(st);
+
+    // Current node, and indexes of searches not yet finished, for each
+    // search in the group.
+    handle h[search_lanes];
+    unsigned live[search_lanes];
+
+    while (n != 0)
       {
-	cmp = cmp_k_n(k, h);
-	if (cmp == 0)
+	const unsigned num = n < search_lanes ? unsigned(n) : search_lanes;
+	unsigned num_live = num;
+
+	for (unsigned i = 0; i < num; ++i)
 	  {
-	    if (st & EQUAL)
-	      {
-		match_h = h;
-		break;
-	      }
-	    cmp = -target_cmp;
+	    h[i] = abs.root;
+	    out[i] = null();
+	    live[i] = i;
 	  }
-	else if (target_cmp != 0)
-	  if (!((cmp ^ target_cmp) & MASK_HIGH_BIT))
-	    // cmp and target_cmp are both positive or both negative.
-	    match_h = h;
-	h = cmp < 0 ? get_lt(h) : get_gt(h);
-	if (read_error())
+
+	while (num_live != 0)
 	  {
-	    match_h = null();
-	    break;
+	    unsigned j = 0;
+
+	    for (unsigned l = 0; l < num_live; ++l)
+	      {
+		unsigned i = live[l];
+
+		if (search_step(k[i], st, target_cmp, h[i], out[i]))
+		  {
+		    prefetch(h[i]);
+		    live[j++] = i;
+		  }
+	      }
+
+	    num_live = j;
 	  }
-      }
 
-    return(match_h);
+	k += num;
+	out += num;
+	n -= num;
+      }
   }
 
-template <class abstractor, unsigned max_depth, class bset>
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
 inline auto
-  base_avl_tree<abstractor, max_depth, bset>::search_least(void) -> handle
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::search_least(void) -> handle
   {
     handle h = abs.root, parent = null();
 
@@ -854,9 +2544,10 @@ inline auto
     return(parent);
   }
 
-template <class abstractor, unsigned max_depth, class bset>
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
 inline auto
-  base_avl_tree<abstractor, max_depth, bset>::search_greatest(void) -> handle
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::search_greatest(void) -> handle
   {
     handle h = abs.root, parent = null();
 
@@ -874,12 +2565,13 @@ inline auto
     return(parent);
   }
 
-template <class abstractor, unsigned max_depth, class bset>
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
 inline auto
-  base_avl_tree<abstractor, max_depth, bset>::remove(key k) -> handle
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::remove(key k) -> handle
   {
     // Zero-based depth in tree.
-    unsigned depth = 0, rm_depth;
+    unsigned depth = 0;
 
     // Records a path into the tree.  If branch[n] is true, indicates
     // take greater branch from the nth node in the path, otherwise
@@ -888,8 +2580,8 @@ inline auto
     bset branch;
 
     handle h = abs.root;
-    handle parent = null(), child;
-    int cmp, cmp_shortened_sub_with_path;
+    handle parent = null();
+    int cmp;
 
     for ( ; ; )
       {
@@ -901,15 +2593,198 @@ inline auto
 	  // Found node to remove.
 	  break;
 	parent = h;
-	h = cmp < 0 ? get_lt(h) : get_gt(h);
+	h = get_child(h, cmp > 0);
+	if (read_error())
+	  return(null());
+	branch[depth++] = cmp > 0;
+      }
+
+    return(remove_path(branch, depth, parent, h));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::remove_node(
+    handle rm, std::true_type) -> handle
+  {
+    unsigned depth = 0;
+    bset branch;
+    handle h = rm;
+    handle parent = get_par(rm);
+
+    // Find the depth of rm.
+    for (handle p = parent; p != null(); p = get_par(p))
+      {
+	if (read_error())
+	  return(null());
+	h = p;
+	depth++;
+      }
+    if (read_error() or (h != abs.root))
+      return(null());
+
+    // Record the path to rm, from the bottom up.
+    h = rm;
+    for (unsigned d = depth; d != 0; )
+      {
+	handle p = get_par(h);
+	branch[--d] = get_gt(p) == h;
+	if (read_error())
+	  return(null());
+	h = p;
+      }
+
+    return(remove_path(branch, depth, parent, rm));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::remove_node(
+    handle rm, std::false_type) -> handle
+  {
+    unsigned depth = 0;
+    bset branch;
+    handle h = abs.root;
+    handle parent = null();
+    int cmp;
+
+    for ( ; ; )
+      {
+	if (h == null())
+	  return(null());
+	cmp = cmp_n_n(rm, h);
+	if (cmp == 0)
+	  break;
+	parent = h;
+	h = get_child(h, cmp > 0);
 	if (read_error())
 	  return(null());
 	branch[depth++] = cmp > 0;
-	cmp_shortened_sub_with_path = cmp;
       }
+
+    return(remove_path(branch, depth, parent, h));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::remove(
+    path_iter &it) -> handle
+  {
+    handle h = *it;
+
+    if (h == null())
+      return(h);
+
+    unsigned depth = it.depth;
+
+    it.depth = unsigned(~0);
+
+    handle parent =
+      depth == 0 ? null() : (depth == 1 ? abs.root : it.path_h[depth - 2]);
+
+    return(remove_path(it.branch, depth, parent, h));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::split(
+    key k, base_avl_tree &greater) -> handle
+  {
+    sub_tree l, r;
+    handle h =
+      split_sub(
+	whole(), [this, &k](handle n) { return(cmp_k_n(k, n)); }, l, r);
+
+    set_whole(l);
+    greater.set_whole(r);
+
+    return(read_error() ? null() : h);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::join(
+    base_avl_tree &greater)
+  {
+    set_whole(join2(whole(), greater.whole()));
+    greater.abs.root = null();
+
+    return(!read_error());
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::unite(
+    base_avl_tree &other, unsigned num_threads)
+  {
+    sub_tree u, dup;
+
+    unite_sub(whole(), other.whole(), num_threads, u, dup);
+
+    set_whole(u);
+    other.set_whole(dup);
+
+    return(!read_error());
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::intersect(
+    base_avl_tree &other, base_avl_tree &removed, unsigned num_threads)
+  {
+    return(partition(other, removed, num_threads, true));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::subtract(
+    base_avl_tree &other, base_avl_tree &removed, unsigned num_threads)
+  {
+    return(partition(other, removed, num_threads, false));
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::partition(
+    base_avl_tree &other, base_avl_tree &removed, unsigned num_threads,
+    bool in_is_kept)
+  {
+    sub_tree in, out, t2;
+
+    partition_sub(whole(), other.whole(), num_threads, in, out, t2);
+
+    set_whole(in_is_kept ? in : out);
+    removed.set_whole(in_is_kept ? out : in);
+    other.set_whole(t2);
+
+    return(!read_error());
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::remove_path(
+    bset &branch, unsigned depth, handle parent, handle h) -> handle
+  {
+    unsigned rm_depth = depth;
+    handle child;
+    int cmp;
+
+    // The side of its parent the node to remove is on.
+    int cmp_shortened_sub_with_path =
+      ((depth != 0) and branch[depth - 1]) ? 1 : -1;
+
     handle rm = h;
     handle parent_rm = parent;
-    rm_depth = depth;
 
     // If the node to remove is not a leaf node, we need to get a
     // leaf node, or a node with a single leaf as its child, to put
@@ -969,12 +2844,24 @@ inline auto
       }
 
     if (parent == null())
-      // There were only 1 or 2 nodes in this tree.
-      abs.root = child;
-    else if (cmp_shortened_sub_with_path < 0)
-      set_lt(parent, child);
+      {
+	// There were only 1 or 2 nodes in this tree.
+	abs.root = child;
+	orphan(child);
+      }
     else
-      set_gt(parent, child);
+      {
+	if (cmp_shortened_sub_with_path < 0)
+	  {
+	    set_lt(parent, child);
+	    adopt_lt(parent);
+	  }
+	else
+	  {
+	    set_gt(parent, child);
+	    adopt_gt(parent);
+	  }
+      }
 
     // "path" is the parent of the subtree being eliminated or reduced
     // from a depth of 2 to 1.  If "path" is the node to be removed, we
@@ -985,9 +2872,12 @@ inline auto
     if (h != rm)
       {
 	// Poke in the replacement for the node to be removed.
+	take_par(h, rm);
 	set_lt(h, get_lt(rm, false));
 	set_gt(h, get_gt(rm, false));
 	set_bf(h, get_bf(rm));
+	adopt_lt(h);
+	adopt_gt(h);
 	if (parent_rm == null())
 	  abs.root = h;
 	else
@@ -1032,6 +2922,7 @@ inline auto
 	cmp = cmp_shortened_sub_with_path;
 	for ( ; ; )
 	  {
+	    fix_node(h);
 	    if (reduced_depth)
 	      {
 		bf = get_bf(h);
@@ -1074,14 +2965,19 @@ inline auto
     return(rm);
   }
 
-template <class abstractor, unsigned max_depth, class bset>
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
 inline auto
-  base_avl_tree<abstractor, max_depth, bset>::subst(handle new_node) -> handle
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::subst(handle new_node) -> handle
   {
     handle h = abs.root;
     handle parent = null();
     int cmp, last_cmp;
 
+    /* Path to the node, only needed for update(). */
+    bset branch;
+    unsigned depth = 0;
+
     /* Search for node already in tree with same key. */
     for ( ; ; )
       {
@@ -1094,15 +2990,21 @@ inline auto
 	  break;
 	last_cmp = cmp;
 	parent = h;
-	h = cmp < 0 ? get_lt(h) : get_gt(h);
+	h = get_child(h, cmp > 0);
 	if (read_error())
 	  return(null());
+	if (augmented)
+	  branch[depth++] = cmp > 0;
       }
 
     /* Copy tree housekeeping fields from node in tree to new node. */
+    take_par(new_node, h);
     set_lt(new_node, get_lt(h, false));
     set_gt(new_node, get_gt(h, false));
     set_bf(new_node, get_bf(h));
+    copy_size(new_node, h);
+    adopt_lt(new_node);
+    adopt_gt(new_node);
 
     if (parent == null())
       /* New node is also new root. */
@@ -1116,17 +3018,197 @@ inline auto
 	  set_gt(parent, new_node);
       }
 
+    update_path(branch, new_node);
+
+    return(h);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::select(size n) -> handle
+  {
+    static_assert(subtree_sizes, "abstractor must have get/set_size()");
+
+    handle h = abs.root;
+
+    while (h != null())
+      {
+	handle lh = get_lt(h);
+	if (read_error())
+	  return(null());
+	size less_size = sub_size(lh);
+	if (n == less_size)
+	  break;
+	if (n > less_size)
+	  {
+	    n -= less_size + 1;
+	    h = get_gt(h);
+	    if (read_error())
+	      return(null());
+	  }
+	else
+	  h = lh;
+      }
+
     return(h);
   }
 
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::rank(key k) -> size
+  {
+    static_assert(subtree_sizes, "abstractor must have get/set_size()");
+
+    size r = 0;
+    handle h = abs.root;
+
+    while (h != null())
+      {
+	int cmp = cmp_k_n(k, h);
+	if (cmp > 0)
+	  {
+	    r += sub_size(get_lt(h)) + 1;
+	    h = get_gt(h);
+	  }
+	else
+	  {
+	    handle lh = get_lt(h);
+	    if (cmp == 0)
+	      {
+		r += sub_size(lh);
+		break;
+	      }
+	    h = lh;
+	  }
+	if (read_error())
+	  return(0);
+      }
+
+    return(r);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline auto
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::count_range(
+    key lo, key hi, std::true_type) -> size
+  {
+    handle h = abs.root;
+
+    // Descend to the first node in the range.  The rest of the nodes in
+    // the range are in its subtrees.
+    for ( ; ; )
+      {
+	if (h == null())
+	  return(0);
+	if (cmp_k_n(lo, h) > 0)
+	  h = get_gt(h);
+	else if (cmp_k_n(hi, h) <= 0)
+	  h = get_lt(h);
+	else
+	  break;
+	if (read_error())
+	  return(0);
+      }
+
+    size n = 1;
+    handle c = get_lt(h);
+
+    // Count the nodes in the less subtree whose keys are not less than lo.
+    while (c != null())
+      {
+	if (cmp_k_n(lo, c) <= 0)
+	  {
+	    n += sub_size(get_gt(c)) + 1;
+	    c = get_lt(c);
+	  }
+	else
+	  c = get_gt(c);
+	if (read_error())
+	  return(0);
+      }
+
+    c = get_gt(h);
+
+    // Count the nodes in the greater subtree whose keys are less than hi.
+    while (c != null())
+      {
+	if (cmp_k_n(hi, c) > 0)
+	  {
+	    n += sub_size(get_lt(c)) + 1;
+	    c = get_gt(c);
+	  }
+	else
+	  c = get_lt(c);
+	if (read_error())
+	  return(0);
+      }
+
+    return(n);
+  }
+
+template <class abstractor, unsigned max_depth, class bset,
+	  class stats_policy>
+inline bool
+  base_avl_tree<abstractor, max_depth, bset, stats_policy>::depth_histogram(
+    size *hist)
+  {
+    for (unsigned d = 0; d < max_depth; ++d)
+      hist[d] = 0;
+
+    // Nodes still to visit, and their depths.  Each node visited pushes
+    // at most two, after popping one, so there are never more than
+    // max_depth + 1 on the stack.
+    handle stack_h[max_depth + 1];
+    unsigned stack_d[max_depth + 1];
+    unsigned top = 0;
+
+    if (abs.root != null())
+      {
+	stack_h[0] = abs.root;
+	stack_d[0] = 0;
+	top = 1;
+      }
+
+    while (top)
+      {
+	--top;
+	handle h = stack_h[top];
+	unsigned d = stack_d[top];
+
+	++hist[d];
+
+	handle lh = get_lt(h), gh = get_gt(h);
+	if (read_error())
+	  return(false);
+
+	if (lh != null())
+	  {
+	    stack_h[top] = lh;
+	    stack_d[top++] = d + 1;
+	  }
+	if (gh != null())
+	  {
+	    stack_h[top] = gh;
+	    stack_d[top++] = d + 1;
+	  }
+      }
+
+    return(true);
+  }
+
 // I tried to avoid having a separate base_avl_tree template by having
 // bitset<max_depth> be the default for the bset template, but Visual
 // C++ would not permit this.  It may possibly be desirable to use
 // base_avl_tree directly with an optimized version of bset.
 //
-template <class abstractor, unsigned max_depth = 32>
+template <class abstractor, unsigned max_depth = 32,
+	  class stats_policy = avl_no_stats>
 class avl_tree
-  : public base_avl_tree<abstractor, max_depth, std::bitset<max_depth> >
+  : public base_avl_tree<
+      abstractor, max_depth, std::bitset<max_depth>, stats_policy>
   { };
 
 } // end namespace abstract_container
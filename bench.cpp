@@ -0,0 +1,1392 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Benchmarks for avl_tree.h (with avl_links.h), bplus_tree.h, hash_table.h, open_hash_table.h,
+// list.h and bidir_list.h, compared against the std:: and boost::intrusive
+// equivalents.
+//
+// Build (like the test drivers, this is a single translation unit):
+//
+//   g++ -std=c++11 -O2 -DNDEBUG bench.cpp -o bench
+//
+// Define BENCH_BOOST as 0 to build without Boost.  Define
+// ABSTRACT_CONTAINER_NO_SIMD to time open_hash_table with scalar tag
+// matching.
+//
+// Usage:
+//
+//   bench [max_elems [reps]]
+//
+// Element counts go from 1000 up to max_elems (default 1000000) in steps
+// of a factor of 10.  Each (container, count, key pattern) case is run
+// reps (default 3) times, and the fastest time for each operation is
+// reported, in nanoseconds per operation.  The output has one line per
+// measurement, with blank-separated fields, so that it's easy to diff
+// the output from one version against another.
+//
+// Key patterns:
+//
+// seq -- keys in ascending order.
+// rand -- keys in a random order (each key used once).
+// zipf -- keys drawn from a Zipfian distribution (theta = 0.99), so some
+//   keys are used many times and others not at all.  The popular keys
+//   are scattered over the key space.
+//
+// After all the other cases, the chained and open addressing hash
+// tables are compared at fixed sizes, with load factors from 0.5 to 0.95
+// (shown in the keys column as lf.50 through lf.95).  The miss operation
+// is a search for a key not in the table.
+
+#ifndef BENCH_BOOST
+#define BENCH_BOOST 1
+#endif
+
+#include "avl_links.h"
+#include "avl_tree.h"
+#include "bplus_tree.h"
+#include "hash_functions.h"
+#include "hash_table.h"
+#include "open_hash_table.h"
+#include "list.h"
+#include "bidir_list.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if BENCH_BOOST
+
+#include <boost/intrusive/avl_set.hpp>
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/set.hpp>
+#include <boost/intrusive/slist.hpp>
+#include <boost/intrusive/unordered_set.hpp>
+
+#endif
+
+using std::uint64_t;
+using std::size_t;
+
+namespace
+{
+
+// Keeps the compiler from optimizing out the work being timed.
+volatile uint64_t sink;
+
+// Nanoseconds per operation are reported for the best of reps runs.
+unsigned reps = 3;
+
+typedef std::vector<uint64_t> Keys;
+
+typedef std::chrono::steady_clock Clock;
+
+class Timer
+  {
+  public:
+
+    Timer() : start(Clock::now()) { }
+
+    // Elapsed nanoseconds divided by number of operations.
+    double per_op(size_t num_ops) const
+      {
+        std::chrono::duration<double, std::nano> d = Clock::now() - start;
+
+        return(d.count() / double(num_ops ? num_ops : 1));
+      }
+
+  private:
+
+    Clock::time_point start;
+  };
+
+// Best (minimum) time for each operation over all runs of a case.
+class Best
+  {
+  public:
+
+    void add(unsigned op, double ns)
+      {
+        if (op >= ns_.size())
+          ns_.resize(op + 1, -1.0);
+
+        if ((ns_[op] < 0) or (ns < ns_[op]))
+          ns_[op] = ns;
+      }
+
+    void print(
+      const char *container, const char * const *op_name,
+      const char *pattern, size_t n) const
+      {
+        for (unsigned op = 0; op < ns_.size(); ++op)
+          if (ns_[op] >= 0)
+            std::printf(
+              "%-22s %-9s %-5s %10lu %10.2f\n", container, op_name[op],
+              pattern, static_cast<unsigned long>(n), ns_[op]);
+      }
+
+  private:
+
+    std::vector<double> ns_;
+  };
+
+// Same mixing function used for every hash table, so the comparison is
+// between the tables, not the hash functions.
+using abstract_container::mix64;
+
+// Zipfian rank generator, from Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases", SIGMOD 1994.
+class Zipf
+  {
+  public:
+
+    Zipf(uint64_t n, double theta) : n_(n), theta_(theta)
+      {
+        zeta_n = zeta(n, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta =
+          (1.0 - std::pow(2.0 / double(n), 1.0 - theta)) /
+          (1.0 - zeta(2, theta) / zeta_n);
+      }
+
+    // Returns rank in the range [0, n).  Rank 0 is the most popular.
+    template <class Rng>
+    uint64_t operator () (Rng &rng)
+      {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zeta_n;
+
+        if (uz < 1.0)
+          return(0);
+
+        if (uz < (1.0 + std::pow(0.5, theta_)))
+          return(1);
+
+        uint64_t r =
+          uint64_t(double(n_) * std::pow(eta * u - eta + 1.0, alpha));
+
+        return(r < n_ ? r : n_ - 1);
+      }
+
+  private:
+
+    uint64_t n_;
+    double theta_, zeta_n, alpha, eta;
+
+    static double zeta(uint64_t n, double theta)
+      {
+        double sum = 0;
+
+        for (uint64_t i = 1; i <= n; ++i)
+          sum += 1.0 / std::pow(double(i), theta);
+
+        return(sum);
+      }
+  };
+
+enum Pattern { Seq, Rand, Zipfian, Num_patterns };
+
+const char * const Pattern_name[Num_patterns] = { "seq", "rand", "zipf" };
+
+// Returns a sequence of n keys, each in the range [0, n), following the
+// given pattern.
+Keys make_keys(Pattern p, size_t n)
+  {
+    Keys k(n);
+    std::mt19937_64 rng(12345);
+
+    for (size_t i = 0; i < n; ++i)
+      k[i] = i;
+
+    if (p == Seq)
+      return(k);
+
+    std::shuffle(k.begin(), k.end(), rng);
+
+    if (p == Rand)
+      return(k);
+
+    // Zipfian ranks, mapped through the random permutation so that the
+    // popular keys are not adjacent.
+    Zipf z(n, 0.99);
+    Keys zk(n);
+
+    for (size_t i = 0; i < n; ++i)
+      zk[i] = k[z(rng)];
+
+    return(zk);
+  }
+
+// Number of keys passed to each search_many() call.
+const size_t Batch_size = 64;
+
+//------------------------------------------------------------------------
+// Ordered containers.  Each driver has ordered set semantics:  insert()
+// of a key already present does not change the container.
+
+enum Ordered_op { O_insert, O_search, O_iter, O_remove, Num_ordered_ops };
+
+const char * const Ordered_op_name[Num_ordered_ops] =
+  { "insert", "search", "iter", "remove" };
+
+struct Avl_node
+  {
+    uint64_t key;
+    Avl_node *lt, *gt;
+    signed char bf;
+  };
+
+template <class Node>
+struct Avl_abs
+  {
+    typedef Node *handle;
+    typedef uint64_t key;
+    typedef size_t size;
+
+    static handle get_less(handle h, bool) { return(h->lt); }
+    static void set_less(handle h, handle lh) { h->lt = lh; }
+    static handle get_greater(handle h, bool) { return(h->gt); }
+    static void set_greater(handle h, handle gh) { h->gt = gh; }
+
+    static int get_balance_factor(handle h) { return(h->bf); }
+    static void set_balance_factor(handle h, int bf) { h->bf = bf; }
+
+    static int compare_key_node(key k, handle h)
+      { return((k > h->key) - (k < h->key)); }
+
+    static int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(h1->key, h2)); }
+
+    static handle null() { return(nullptr); }
+
+    static bool read_error() { return(false); }
+
+    static void prefetch(handle h) { __builtin_prefetch(h); }
+  };
+
+// Node with parent links (so the tree's iterator is parent_iter).
+struct Avl_par_node
+  {
+    uint64_t key;
+    Avl_par_node *lt, *gt, *par;
+    signed char bf;
+  };
+
+struct Avl_par_abs : public Avl_abs<Avl_par_node>
+  {
+    static handle get_parent(handle h, bool) { return(h->par); }
+    static void set_parent(handle h, handle ph) { h->par = ph; }
+  };
+
+template <class Abs>
+class Avl_driver
+  {
+  public:
+
+    explicit Avl_driver(size_t n) : node(n) { }
+
+    void insert(size_t i, uint64_t k)
+      {
+        node[i].key = k;
+        tree.insert(&node[i]);
+      }
+
+    bool search(uint64_t k) { return(tree.search(k) != nullptr); }
+
+    // Returns the number of keys found.
+    size_t search_many(const uint64_t *k, size_t n)
+      {
+        Node *out[Batch_size];
+        size_t found = 0;
+
+        tree.search_many(k, n, out);
+
+        for (size_t i = 0; i < n; ++i)
+          found += out[i] != nullptr;
+
+        return(found);
+      }
+
+    uint64_t iterate()
+      {
+        uint64_t sum = 0;
+        typename Tree::iter it;
+
+        it.start_iter_least(tree);
+
+        for (Node *p = *it; p; it++, p = *it)
+          sum += p->key;
+
+        return(sum);
+      }
+
+    void remove(uint64_t k) { tree.remove(k); }
+
+  private:
+
+    typedef typename std::remove_pointer<typename Abs::handle>::type Node;
+
+    // Maximum depth of an AVL tree with 100M nodes is 38.
+    typedef abstract_container::avl_tree<Abs, 48> Tree;
+
+    std::vector<Node> node;
+    Tree tree;
+  };
+
+// Node with 32-bit index links and a packed balance factor (16 bytes,
+// rather than 32 for Avl_node).
+struct Avl_index_node
+  {
+    uint64_t key;
+    abstract_container::avl_index_links<uint32_t> links;
+  };
+
+struct Avl_index_abs :
+  public abstract_container::avl_array_abs<
+    Avl_index_node, abstract_container::avl_index_links<uint32_t>,
+    &Avl_index_node::links>
+  {
+    typedef uint64_t key;
+    typedef size_t size;
+
+    int compare_key_node(key k, handle h)
+      {
+        key hk = node_array[h].key;
+
+        return((k > hk) - (k < hk));
+      }
+
+    int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(node_array[h1].key, h2)); }
+
+    static bool read_error() { return(false); }
+  };
+
+class Avl_index_driver
+  {
+  public:
+
+    explicit Avl_index_driver(size_t n) : node(n)
+      { tree.set_node_array(node.data()); }
+
+    void insert(size_t i, uint64_t k)
+      {
+        node[i].key = k;
+        tree.insert(uint32_t(i));
+      }
+
+    bool search(uint64_t k) { return(tree.search(k) != tree.null()); }
+
+    uint64_t iterate()
+      {
+        uint64_t sum = 0;
+        Tree::iter it;
+
+        it.start_iter_least(tree);
+
+        for (uint32_t h = *it; h != tree.null(); it++, h = *it)
+          sum += node[h].key;
+
+        return(sum);
+      }
+
+    void remove(uint64_t k) { tree.remove(k); }
+
+  private:
+
+    class Tree : public abstract_container::avl_tree<Avl_index_abs, 48>
+      {
+      public:
+
+        void set_node_array(Avl_index_node *p) { abs.node_array = p; }
+
+        uint32_t null() { return(abs.null()); }
+      };
+
+    std::vector<Avl_index_node> node;
+    Tree tree;
+  };
+
+struct Bplus_elem
+  {
+    uint64_t key;
+  };
+
+// Nodes of 4 cache lines.
+struct Bplus_abs
+  {
+    typedef Bplus_elem *handle;
+    typedef uint64_t key;
+    typedef size_t size;
+
+    static const unsigned node_bytes = 256;
+
+    static handle null() { return(nullptr); }
+
+    static key get_key(handle h) { return(h->key); }
+  };
+
+class Bplus_driver
+  {
+  public:
+
+    explicit Bplus_driver(size_t n) : elem(n) { }
+
+    void insert(size_t i, uint64_t k)
+      {
+        elem[i].key = k;
+        tree.insert(&elem[i]);
+      }
+
+    bool search(uint64_t k) { return(tree.search(k) != nullptr); }
+
+    uint64_t iterate()
+      {
+        uint64_t sum = 0;
+        Tree::iter it;
+
+        it.start_iter_least(tree);
+
+        for (Bplus_elem *p = *it; p; it++, p = *it)
+          sum += p->key;
+
+        return(sum);
+      }
+
+    void remove(uint64_t k) { tree.remove(k); }
+
+  private:
+
+    typedef abstract_container::bplus_tree<Bplus_abs> Tree;
+
+    std::vector<Bplus_elem> elem;
+    Tree tree;
+  };
+
+class Std_map_driver
+  {
+  public:
+
+    explicit Std_map_driver(size_t) { }
+
+    void insert(size_t i, uint64_t k) { m.insert(std::make_pair(k, i)); }
+
+    bool search(uint64_t k) { return(m.find(k) != m.end()); }
+
+    uint64_t iterate()
+      {
+        uint64_t sum = 0;
+
+        for (auto &v : m)
+          sum += v.first;
+
+        return(sum);
+      }
+
+    void remove(uint64_t k) { m.erase(k); }
+
+  private:
+
+    std::map<uint64_t, size_t> m;
+  };
+
+#if BENCH_BOOST
+
+namespace bi = boost::intrusive;
+
+// Driver for boost::intrusive::set (red-black) or avl_set.
+template <class Hook, template <class, class...> class Set_tmpl>
+class Boost_set_driver
+  {
+  public:
+
+    explicit Boost_set_driver(size_t n) : node(n) { }
+
+    ~Boost_set_driver() { set.clear(); }
+
+    void insert(size_t i, uint64_t k)
+      {
+        node[i].key = k;
+        set.insert(node[i]);
+      }
+
+    bool search(uint64_t k)
+      { return(set.find(k, Key_node_less()) != set.end()); }
+
+    uint64_t iterate()
+      {
+        uint64_t sum = 0;
+
+        for (auto &v : set)
+          sum += v.key;
+
+        return(sum);
+      }
+
+    void remove(uint64_t k) { set.erase(k, Key_node_less()); }
+
+  private:
+
+    struct Node : public Hook
+      {
+        uint64_t key;
+
+        bool operator < (const Node &n) const { return(key < n.key); }
+      };
+
+    struct Key_node_less
+      {
+        bool operator () (uint64_t k, const Node &n) const
+          { return(k < n.key); }
+        bool operator () (const Node &n, uint64_t k) const
+          { return(n.key < k); }
+      };
+
+    std::vector<Node> node;
+    Set_tmpl<Node, bi::link_mode<bi::normal_link> > set;
+  };
+
+typedef
+  Boost_set_driver<
+    bi::set_base_hook<bi::link_mode<bi::normal_link> >, bi::set>
+  Boost_set_driver_rb;
+
+typedef
+  Boost_set_driver<
+    bi::avl_set_base_hook<bi::link_mode<bi::normal_link> >, bi::avl_set>
+  Boost_set_driver_avl;
+
+#endif
+
+template <class Driver>
+void ordered_bench(const char *name, Pattern p, const Keys &k)
+  {
+    size_t n = k.size();
+    Best best;
+
+    for (unsigned r = 0; r < reps; ++r)
+      {
+        Driver d(n);
+        uint64_t s = 0;
+
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            d.insert(i, k[i]);
+          best.add(O_insert, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.search(k[n - 1 - i]);
+          best.add(O_search, t.per_op(n));
+        }
+        {
+          Timer t;
+          s += d.iterate();
+          best.add(O_iter, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            d.remove(k[i]);
+          best.add(O_remove, t.per_op(n));
+        }
+
+        sink += s;
+      }
+
+    best.print(name, Ordered_op_name, Pattern_name[p], n);
+  }
+
+//------------------------------------------------------------------------
+// Hash tables.  The number of buckets is the element count rounded up
+// to a power of 2, for all tables.
+
+enum Hash_op { H_insert, H_search, H_remove, Num_hash_ops };
+
+const char * const Hash_op_name[Num_hash_ops] =
+  { "insert", "search", "remove" };
+
+size_t num_buckets(size_t n)
+  {
+    size_t b = 1;
+
+    while (b < n)
+      b <<= 1;
+
+    return(b);
+  }
+
+struct Hash_node
+  {
+    uint64_t key;
+    Hash_node *link;
+  };
+
+// The bucket array is allocated at run time, so the compile-time
+// num_hash_values is only an upper limit.  purge() and iter (which
+// visit num_hash_values buckets) are not used by this benchmark.
+class Hash_abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Hash_node *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->link); }
+        static void link(handle h, handle link_h) { h->link = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef size_t index;
+    typedef uint64_t key;
+
+    static const index num_hash_values = index(1) << 30;
+
+    index hash_key(key k) { return(mix64(k) & mask); }
+
+    index hash_elem(Hash_node *h) { return(hash_key(h->key)); }
+
+    bool is_key(key k, Hash_node *h) { return(h->key == k); }
+
+    void prefetch(Hash_node *h) { __builtin_prefetch(h); }
+
+    list & bucket(index hv) { return(table[hv]); }
+
+    // nb must be a power of 2.
+    void init_table(size_t nb)
+      {
+        table = std::vector<list>(nb);
+        mask = nb - 1;
+      }
+
+  private:
+
+    std::vector<list> table;
+    index mask;
+  };
+
+class Hash_driver
+  {
+  public:
+
+    explicit Hash_driver(size_t n) : node(n) { ht.init(num_buckets(n)); }
+
+    // With nb (a power of 2) buckets.
+    Hash_driver(size_t n, size_t nb) : node(n) { ht.init(nb); }
+
+    bool insert(size_t i, uint64_t k)
+      {
+        if (ht.search(k) != nullptr)
+          return(false);
+        node[i].key = k;
+        ht.insert(&node[i]);
+        return(true);
+      }
+
+    bool search(uint64_t k) { return(ht.search(k) != nullptr); }
+
+    // Returns the number of keys found.
+    size_t search_many(const uint64_t *k, size_t n)
+      {
+        Hash_node *out[Batch_size];
+        size_t found = 0;
+
+        ht.search_many(k, n, out);
+
+        for (size_t i = 0; i < n; ++i)
+          found += out[i] != nullptr;
+
+        return(found);
+      }
+
+    void remove(uint64_t k) { ht.remove_key(k); }
+
+  private:
+
+    std::vector<Hash_node> node;
+
+    struct Ht : public abstract_container::base_hash_table<Hash_abs>
+      {
+        void init(size_t nb) { init_table(nb); }
+      };
+
+    Ht ht;
+  };
+
+// Linear hash table, starting with 1024 buckets and growing as elements
+// are inserted.
+class Linear_hash_abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Hash_node *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->link); }
+        static void link(handle h, handle link_h) { h->link = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef size_t index;
+    typedef uint64_t key;
+
+    static const index num_hash_values = index(1) << 27;
+    static const index min_buckets = 1024;
+    static const index load_factor = 1;
+
+    index hash_key(key k) { return(mix64(k)); }
+
+    index hash_elem(Hash_node *h) { return(hash_key(h->key)); }
+
+    bool is_key(key k, Hash_node *h) { return(h->key == k); }
+  };
+
+class Linear_hash_driver
+  {
+  public:
+
+    explicit Linear_hash_driver(size_t n)
+      : node(n), ht(new abstract_container::linear_hash_table<Linear_hash_abs>)
+      { }
+
+    bool insert(size_t i, uint64_t k)
+      {
+        if (ht->search(k) != nullptr)
+          return(false);
+        node[i].key = k;
+        ht->insert(&node[i]);
+        return(true);
+      }
+
+    bool search(uint64_t k) { return(ht->search(k) != nullptr); }
+
+    void remove(uint64_t k) { ht->remove_key(k); }
+
+  private:
+
+    std::vector<Hash_node> node;
+
+    // Bucket segment directory is too big to go on the stack.
+    std::unique_ptr<abstract_container::linear_hash_table<Linear_hash_abs> >
+      ht;
+  };
+
+// Open addressing hash table.  The groups are allocated at run time,
+// aligned to cache lines.
+class Open_hash_abs
+  {
+  protected:
+
+    typedef Hash_node *handle;
+    typedef size_t index;
+    typedef uint64_t key;
+
+    typedef abstract_container::open_hash_group<handle> group_;
+
+    static handle null() { return(nullptr); }
+
+    index hash_key(key k) { return(mix64(k)); }
+
+    index hash_elem(Hash_node *h) { return(hash_key(h->key)); }
+
+    bool is_key(key k, Hash_node *h) { return(h->key == k); }
+
+    index num_groups() { return(ng); }
+
+    group_ & group(index i) { return(groups[i]); }
+
+    // ng must be a power of 2.
+    void init_table(size_t ng_)
+      {
+        ng = ng_;
+        mem.reset(new char[(ng + 1) * sizeof(group_)]);
+
+        void *p = mem.get();
+        size_t space = (ng + 1) * sizeof(group_);
+
+        groups =
+          static_cast<group_ *>(
+            std::align(alignof(group_), ng * sizeof(group_), p, space));
+
+        for (size_t i = 0; i < ng; ++i)
+          new (groups + i) group_;
+      }
+
+  private:
+
+    std::unique_ptr<char[]> mem;
+    group_ *groups;
+    index ng;
+  };
+
+class Open_hash_driver
+  {
+  public:
+
+    // Enough groups to keep the load factor under 6 / 7.
+    explicit Open_hash_driver(size_t n) : node(n)
+      { ht.init(num_buckets((n + 5) / 6)); }
+
+    // With ng (a power of 2) groups.
+    Open_hash_driver(size_t n, size_t ng) : node(n) { ht.init(ng); }
+
+    bool insert(size_t i, uint64_t k)
+      {
+        if (ht.search(k) != nullptr)
+          return(false);
+        node[i].key = k;
+        return(ht.insert(&node[i]));
+      }
+
+    bool search(uint64_t k) { return(ht.search(k) != nullptr); }
+
+    void remove(uint64_t k) { ht.remove_key(k); }
+
+  private:
+
+    std::vector<Hash_node> node;
+
+    struct Ht : public abstract_container::base_open_hash_table<Open_hash_abs>
+      {
+        void init(size_t ng) { init_table(ng); }
+      };
+
+    Ht ht;
+  };
+
+class Std_unordered_map_driver
+  {
+  public:
+
+    explicit Std_unordered_map_driver(size_t n) { m.reserve(n); }
+
+    bool insert(size_t i, uint64_t k)
+      { return(m.insert(std::make_pair(k, i)).second); }
+
+    bool search(uint64_t k) { return(m.find(k) != m.end()); }
+
+    void remove(uint64_t k) { m.erase(k); }
+
+  private:
+
+    struct Hash
+      {
+        size_t operator () (uint64_t k) const { return(size_t(mix64(k))); }
+      };
+
+    std::unordered_map<uint64_t, size_t, Hash> m;
+  };
+
+#if BENCH_BOOST
+
+class Boost_unordered_set_driver
+  {
+  private:
+
+    struct Node : public bi::unordered_set_base_hook<
+                           bi::link_mode<bi::normal_link> >
+      {
+        uint64_t key;
+
+        bool operator == (const Node &n) const { return(key == n.key); }
+      };
+
+    struct Hash
+      {
+        size_t operator () (const Node &n) const
+          { return(size_t(mix64(n.key))); }
+        size_t operator () (uint64_t k) const { return(size_t(mix64(k))); }
+      };
+
+    struct Key_eq
+      {
+        bool operator () (uint64_t k, const Node &n) const
+          { return(k == n.key); }
+      };
+
+    typedef
+      bi::unordered_set<
+        Node, bi::hash<Hash>, bi::power_2_buckets<true>,
+        bi::link_mode<bi::normal_link> >
+      Set;
+
+    std::vector<Set::bucket_type> buckets;
+    std::vector<Node> node;
+    Set set;
+
+  public:
+
+    explicit Boost_unordered_set_driver(size_t n)
+      : buckets(num_buckets(n)), node(n),
+        set(Set::bucket_traits(buckets.data(), buckets.size()))
+      { }
+
+    ~Boost_unordered_set_driver() { set.clear(); }
+
+    bool insert(size_t i, uint64_t k)
+      {
+        node[i].key = k;
+        return(set.insert(node[i]).second);
+      }
+
+    bool search(uint64_t k)
+      { return(set.find(k, Hash(), Key_eq()) != set.end()); }
+
+    void remove(uint64_t k) { set.erase(k, Hash(), Key_eq()); }
+  };
+
+#endif
+
+template <class Driver>
+void hash_bench(const char *name, Pattern p, const Keys &k)
+  {
+    size_t n = k.size();
+    Best best;
+
+    for (unsigned r = 0; r < reps; ++r)
+      {
+        Driver d(n);
+        uint64_t s = 0;
+
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.insert(i, k[i]);
+          best.add(H_insert, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.search(k[n - 1 - i]);
+          best.add(H_search, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            d.remove(k[i]);
+          best.add(H_remove, t.per_op(n));
+        }
+
+        sink += s;
+      }
+
+    best.print(name, Hash_op_name, Pattern_name[p], n);
+  }
+
+// Searches one at a time, compared to search_many() with Batch_size keys
+// in each call, for containers that have it.  The drivers must have set
+// semantics (each key inserted once).
+
+enum Batch_op { B_search, B_search_many, Num_batch_ops };
+
+const char * const Batch_op_name[Num_batch_ops] = { "search", "search64" };
+
+template <class Driver>
+void batch_bench(const char *name, Pattern p, const Keys &k)
+  {
+    size_t n = k.size();
+    Best best;
+    Driver d(n);
+
+    for (size_t i = 0; i < n; ++i)
+      d.insert(i, k[i]);
+
+    Keys sk(k.rbegin(), k.rend());
+
+    for (unsigned r = 0; r < reps; ++r)
+      {
+        uint64_t s = 0;
+
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.search(sk[i]);
+          best.add(B_search, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; i += Batch_size)
+            s += d.search_many(&sk[i], std::min(Batch_size, n - i));
+          best.add(B_search_many, t.per_op(n));
+        }
+
+        sink += s;
+      }
+
+    best.print(name, Batch_op_name, Pattern_name[p], n);
+  }
+
+// Chained and open addressing tables at a fixed size, with increasing
+// load factors.  The open table has num_groups groups.  The chained
+// table has 8 buckets per group, a few more than the number of slots
+// in the open table, so its load factor is a little lower.
+
+enum Load_op { LF_insert, LF_search, LF_miss, LF_remove, Num_load_ops };
+
+const char * const Load_op_name[Num_load_ops] =
+  { "insert", "search", "miss", "remove" };
+
+template <class Driver>
+void load_bench(
+  const char *name, const char *lf_name, size_t n, size_t size)
+  {
+    Best best;
+    Keys k = make_keys(Rand, 2 * n);
+
+    for (unsigned r = 0; r < reps; ++r)
+      {
+        Driver d(n, size);
+        uint64_t s = 0;
+
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.insert(i, k[i]);
+          best.add(LF_insert, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.search(k[n - 1 - i]);
+          best.add(LF_search, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = n; i < (2 * n); ++i)
+            s += d.search(k[i]);
+          best.add(LF_miss, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            d.remove(k[i]);
+          best.add(LF_remove, t.per_op(n));
+        }
+
+        sink += s;
+      }
+
+    best.print(name, Load_op_name, lf_name, n);
+  }
+
+void load_factor_bench(size_t max_elems)
+  {
+    typedef abstract_container::open_hash_group<Hash_node *> Group;
+
+    static const unsigned Num_lf = 5;
+    static const unsigned Lf_percent[Num_lf] = { 50, 75, 85, 90, 95 };
+    static const char * const Lf_name[Num_lf] =
+      { "lf.50", "lf.75", "lf.85", "lf.90", "lf.95" };
+
+    size_t ng = num_buckets(max_elems / Group::size);
+
+    for (unsigned i = 0; i < Num_lf; ++i)
+      {
+        size_t n = ng * Group::size * Lf_percent[i] / 100;
+
+        load_bench<Hash_driver>("hash_table", Lf_name[i], n, 8 * ng);
+        load_bench<Open_hash_driver>("open_hash_table", Lf_name[i], n, ng);
+      }
+  }
+
+//------------------------------------------------------------------------
+// Lists.  push and pop are at the front.  remove removes every element,
+// by handle (or iterator), in the order given by the key pattern (used
+// as element indexes).  The zipf pattern is not used for lists, since
+// each element can only be removed once.
+
+enum List_op { L_push, L_pop, L_remove, Num_list_ops };
+
+const char * const List_op_name[Num_list_ops] = { "push", "pop", "remove" };
+
+// Removal from a singly-linked list is linear, so it's only timed for
+// lists no longer than this.
+const size_t Max_linear_remove = 10000;
+
+template <bool store_tail>
+class P_list_driver
+  {
+  public:
+
+    static const bool linear_remove = true;
+
+    explicit P_list_driver(size_t n) : node(n) { }
+
+    void push(size_t i) { lst.push(&node[i]); }
+
+    uint64_t pop() { return(lst.pop() != nullptr); }
+
+    void remove(size_t i) { lst.remove(&node[i]); }
+
+  private:
+
+    typedef abstract_container::p_list<store_tail> List;
+
+    std::vector<typename List::elem> node;
+    List lst;
+  };
+
+class P_bidir_list_driver
+  {
+  public:
+
+    static const bool linear_remove = false;
+
+    explicit P_bidir_list_driver(size_t n) : node(n) { }
+
+    void push(size_t i) { lst.push(&node[i]); }
+
+    uint64_t pop() { return(lst.pop() != nullptr); }
+
+    void remove(size_t i) { lst.remove(&node[i]); }
+
+  private:
+
+    typedef abstract_container::p_bidir_list List;
+
+    std::vector<List::elem> node;
+    List lst;
+  };
+
+class Std_list_driver
+  {
+  public:
+
+    static const bool linear_remove = false;
+
+    explicit Std_list_driver(size_t n) : pos(n) { }
+
+    void push(size_t i) { lst.push_front(i); pos[i] = lst.begin(); }
+
+    uint64_t pop()
+      {
+        uint64_t v = lst.front();
+        lst.pop_front();
+        return(v);
+      }
+
+    void remove(size_t i) { lst.erase(pos[i]); }
+
+  private:
+
+    std::list<size_t> lst;
+    std::vector<std::list<size_t>::iterator> pos;
+  };
+
+#if BENCH_BOOST
+
+template <class Hook, class List_tmpl, bool linear_remove_>
+class Boost_list_driver
+  {
+  public:
+
+    static const bool linear_remove = linear_remove_;
+
+    explicit Boost_list_driver(size_t n) : node(n) { }
+
+    ~Boost_list_driver() { lst.clear(); }
+
+    void push(size_t i) { lst.push_front(node[i]); }
+
+    uint64_t pop()
+      {
+        uint64_t v = &lst.front() != nullptr;
+        lst.pop_front();
+        return(v);
+      }
+
+    void remove(size_t i) { lst.erase(lst.iterator_to(node[i])); }
+
+  private:
+
+    struct Node : public Hook { };
+
+    typedef typename List_tmpl::template apply<Node>::type List;
+
+    std::vector<Node> node;
+    List lst;
+  };
+
+struct Bi_list_tmpl
+  {
+    template <class N>
+    struct apply
+      {
+        typedef bi::list<N, bi::link_mode<bi::normal_link> > type;
+      };
+  };
+
+struct Bi_slist_tmpl
+  {
+    template <class N>
+    struct apply
+      {
+        typedef
+          bi::slist<
+            N, bi::cache_last<true>, bi::link_mode<bi::normal_link> >
+          type;
+      };
+  };
+
+typedef
+  Boost_list_driver<
+    bi::list_base_hook<bi::link_mode<bi::normal_link> >, Bi_list_tmpl,
+    false>
+  Boost_list_driver_bidir;
+
+// boost::intrusive::slist::erase(iterator) is linear, like list::remove.
+typedef
+  Boost_list_driver<
+    bi::slist_base_hook<bi::link_mode<bi::normal_link> >, Bi_slist_tmpl,
+    true>
+  Boost_list_driver_single;
+
+#endif
+
+template <class Driver>
+void list_bench(const char *name, Pattern p, const Keys &k)
+  {
+    size_t n = k.size();
+    Best best;
+
+    for (unsigned r = 0; r < reps; ++r)
+      {
+        Driver d(n);
+        uint64_t s = 0;
+
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            d.push(i);
+          best.add(L_push, t.per_op(n));
+        }
+        {
+          Timer t;
+          for (size_t i = 0; i < n; ++i)
+            s += d.pop();
+          best.add(L_pop, t.per_op(n));
+        }
+
+        if (!Driver::linear_remove or (n <= Max_linear_remove))
+          {
+            for (size_t i = 0; i < n; ++i)
+              d.push(i);
+
+            Timer t;
+            for (size_t i = 0; i < n; ++i)
+              d.remove(k[i]);
+            best.add(L_remove, t.per_op(n));
+          }
+
+        sink += s;
+      }
+
+    best.print(name, List_op_name, Pattern_name[p], n);
+  }
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+  {
+    size_t max_elems = 1000000;
+
+    if (argc > 1)
+      max_elems = std::strtoul(argv[1], nullptr, 10);
+
+    if (argc > 2)
+      reps = unsigned(std::strtoul(argv[2], nullptr, 10));
+
+    if ((max_elems < 1000) or (reps == 0))
+      {
+        std::fprintf(stderr, "usage: %s [max_elems [reps]]\n", argv[0]);
+        return(1);
+      }
+
+    std::printf(
+      "%-22s %-9s %-5s %10s %10s\n", "container", "op", "keys", "n", "ns/op");
+
+    for (size_t n = 1000; n <= max_elems; n *= 10)
+      for (unsigned pi = 0; pi < Num_patterns; ++pi)
+        {
+          Pattern p = Pattern(pi);
+          Keys k = make_keys(p, n);
+
+          ordered_bench<Avl_driver<Avl_abs<Avl_node> > >("avl_tree", p, k);
+          ordered_bench<Avl_driver<Avl_par_abs> >("avl_tree+parent", p, k);
+          ordered_bench<Avl_index_driver>("avl_tree+index32", p, k);
+          ordered_bench<Bplus_driver>("bplus_tree", p, k);
+          ordered_bench<Std_map_driver>("std::map", p, k);
+          #if BENCH_BOOST
+          ordered_bench<Boost_set_driver_rb>("bi::set", p, k);
+          ordered_bench<Boost_set_driver_avl>("bi::avl_set", p, k);
+          #endif
+
+          hash_bench<Hash_driver>("hash_table", p, k);
+          hash_bench<Linear_hash_driver>("linear_hash_table", p, k);
+          hash_bench<Open_hash_driver>("open_hash_table", p, k);
+          hash_bench<Std_unordered_map_driver>("std::unordered_map", p, k);
+          #if BENCH_BOOST
+          hash_bench<Boost_unordered_set_driver>("bi::unordered_set", p, k);
+          #endif
+
+          if (p != Zipfian)
+            {
+              batch_bench<Avl_driver<Avl_abs<Avl_node> > >("avl_tree", p, k);
+              batch_bench<Hash_driver>("hash_table", p, k);
+            }
+
+          if (p != Zipfian)
+            {
+              list_bench<P_list_driver<true> >("p_list", p, k);
+              list_bench<P_bidir_list_driver>("p_bidir_list", p, k);
+              list_bench<Std_list_driver>("std::list", p, k);
+              #if BENCH_BOOST
+              list_bench<Boost_list_driver_single>("bi::slist", p, k);
+              list_bench<Boost_list_driver_bidir>("bi::list", p, k);
+              #endif
+            }
+
+          std::fflush(stdout);
+        }
+
+    load_factor_bench(max_elems);
+
+    return(0);
+  }
@@ -64,6 +64,11 @@ class bidir_list : protected abstractor
 
     typedef typename abstractor::handle handle;
 
+    // Each member function with an is_forward parameter has a version
+    // with the direction as a template parameter instead (for example,
+    // push<reverse>(h) or start<forward>()), whose code has no tests of
+    // the direction, and indexes head with a constant.
+
     static handle null() { return(abstractor::null()); }
 
     bidir_list() : head{ null(), null() } { }
@@ -75,6 +80,9 @@ class bidir_list : protected abstractor
     handle link(handle h, bool is_forward = true)
      { return(abstractor::link(h, is_forward)); }
 
+    template <bool is_forward>
+    handle link(handle h) { return(abstractor::link(h, is_forward)); }
+
     // Put the specied element (which must not be part of any list) into
     // a state that it can only be in when not in any list.
     //
@@ -85,19 +93,43 @@ class bidir_list : protected abstractor
     //
     bool is_detached(handle h) { return(link(h, forward) == h); }
 
-    // FUTURE
-    // bidir_list(
-    //   bidir_list &to_split, handle first_in_list, handle last_in_list)
+    // Removes the elements from first_in_list to last_in_list (in the
+    // forward direction) from the list to_split, and constructs a list
+    // containing them.  first_in_list may be the same as last_in_list.
+    //
+    bidir_list(
+      bidir_list &to_split, handle first_in_list, handle last_in_list)
+      {
+        to_split.remove(first_in_list, last_in_list);
+
+        link(first_in_list, null(), reverse);
+        link(last_in_list, null(), forward);
+
+        head[forward] = first_in_list;
+        head[reverse] = last_in_list;
+      }
 
     // Returns the handle of first element in the list in the given direction.
     // Returns the null value if the list is empty.
     //
     handle start(bool is_forward = true) { return(head[is_forward]); }
 
+    template <bool is_forward>
+    handle start() { return(head[is_forward]); }
+
     // For the element in_list (already in the list), inserts the element
     // to_insert after it in the given direction.
     //
     void insert(handle in_list, handle to_insert, bool is_forward = true)
+      {
+        if (is_forward)
+          insert<forward>(in_list, to_insert);
+        else
+          insert<reverse>(in_list, to_insert);
+      }
+
+    template <bool is_forward>
+    void insert(handle in_list, handle to_insert)
       {
         handle ilf = link(in_list, is_forward);
         link(to_insert, ilf, is_forward);
@@ -110,15 +142,40 @@ class bidir_list : protected abstractor
         link(in_list, to_insert, is_forward);
       }
 
-    #if 0
-    // FUTURE
+    // For the element in_list (already in the list), inserts all the
+    // elements of the list to_insert after it in the given direction.  The
+    // inserted elements are in the same order (in the given direction) as
+    // they were in to_insert, and to_insert is left empty.
+    //
     void insert(handle in_list, bidir_list &to_insert, bool is_forward = true)
       {
-        if (to_insert.head[forward] == null())
+        if (is_forward)
+          insert<forward>(in_list, to_insert);
+        else
+          insert<reverse>(in_list, to_insert);
+      }
+
+    template <bool is_forward>
+    void insert(handle in_list, bidir_list &to_insert)
+      {
+        if (to_insert.empty())
           return;
-        ...
+
+        handle first = to_insert.head[is_forward];
+        handle last = to_insert.head[!is_forward];
+        handle ilf = link(in_list, is_forward);
+
+        link(last, ilf, is_forward);
+        if (ilf == null())
+          // New head in reverse direction.
+          head[!is_forward] = last;
+        else
+          link(ilf, last, !is_forward);
+        link(first, in_list, !is_forward);
+        link(in_list, first, is_forward);
+
+        to_insert.purge();
       }
-    #endif
 
     // Remorves the specified element (initially in the list) from the list.
     //
@@ -140,13 +197,39 @@ class bidir_list : protected abstractor
           link(r, f, forward);
       }
 
-    // FUTURE
-    // void remove(handle first_in_list, handle last_in_list))
+    // Removes the elements from first_in_list to last_in_list (in the
+    // forward direction, and initially in the list) from the list.  The
+    // links between the removed elements are not changed.
+    //
+    void remove(handle first_in_list, handle last_in_list)
+      {
+        handle f = link(last_in_list, forward);
+        handle r = link(first_in_list, reverse);
+
+        if (r == null())
+          head[forward] = f;
+        else
+          link(r, f, forward);
+
+        if (f == null())
+          head[reverse] = r;
+        else
+          link(f, r, reverse);
+      }
 
     // Make the specified element (not initially in the list) the new first
     // element in the list, in the specified direction.
     //
     void push(handle to_push, bool is_forward = true)
+      {
+        if (is_forward)
+          push<forward>(to_push);
+        else
+          push<reverse>(to_push);
+      }
+
+    template <bool is_forward>
+    void push(handle to_push)
       {
         link(to_push, null(), !is_forward);
         link(to_push, head[is_forward], is_forward);
@@ -159,13 +242,48 @@ class bidir_list : protected abstractor
         head[is_forward] = to_push;
       }
 
-    // FUTURE
-    // void push(bidir_list &to_push, bool is_forward = true)
+    // Make all the elements of the list to_push the new first elements in
+    // the list, in the specified direction.  The pushed elements are in
+    // the same order (in the given direction) as they were in to_push, and
+    // to_push is left empty.
+    //
+    void push(bidir_list &to_push, bool is_forward = true)
+      {
+        if (is_forward)
+          push<forward>(to_push);
+        else
+          push<reverse>(to_push);
+      }
+
+    template <bool is_forward>
+    void push(bidir_list &to_push)
+      {
+        if (to_push.empty())
+          return;
+
+        handle last = to_push.head[!is_forward];
+
+        if (head[is_forward] == null())
+          head[!is_forward] = last;
+        else
+          {
+            link(last, head[is_forward], is_forward);
+            link(head[is_forward], last, !is_forward);
+          }
+
+        head[is_forward] = to_push.head[is_forward];
+
+        to_push.purge();
+      }
 
     // Removes and returns the first element (in the given direction) in the
     // list.
     //
     handle pop(bool is_forward = true)
+      { return(is_forward ? pop<forward>() : pop<reverse>()); }
+
+    template <bool is_forward>
+    handle pop()
       {
         handle p = head[is_forward];
 
@@ -235,6 +353,12 @@ class p_bidir_list : public bidir_list<impl::p_bidir_list_abs>
   public:
 
     typedef impl::p_bidir_list_elem elem;
+
+    p_bidir_list() = default;
+
+    p_bidir_list(
+      p_bidir_list &to_split, handle first_in_list, handle last_in_list)
+      : bidir_list(to_split, first_in_list, last_in_list) { }
   };
 
 } // end namespace abstract_container
@@ -0,0 +1,1107 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_BPLUS_TREE_H_
+#define ABSTRACT_CONTAINER_BPLUS_TREE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace abstract_container
+{
+
+#ifndef ABSTRACT_CONTAINER_SEARCH_TYPE_
+#define ABSTRACT_CONTAINER_SEARCH_TYPE_
+
+enum search_type
+  {
+    EQUAL = 1,
+    equal = 1,
+    LESS = 2,
+    less = 2,
+    GREATER = 4,
+    greater = 4,
+    LESS_EQUAL = equal | less,
+    less_equal = equal | less,
+    GREATER_EQUAL = equal | greater,
+    greater_equal = equal | greater
+  };
+
+#endif
+
+// B+-tree of handles, ordered by key.  The search types have the same
+// meaning as for avl_tree.  Each leaf node holds many handles, with a
+// copy of the key of each, and each inner node holds many child node
+// pointers.  So a search reads about log base 16 (for 8-byte keys and
+// handles with 256-byte nodes) of the number of elements nodes, rather
+// than log base 2 for a binary tree.  The elements themselves need no
+// links, and are only accessed to get their keys when they are inserted.
+//
+// If key is an arithmetic type, the keys in a node are counted with a
+// loop that has no data-dependent branches, so there are no branch
+// mispredictions, and the compiler can vectorize it.  Otherwise, the keys
+// in a node are binary searched.
+//
+// abstractor parameter class must have these public members, or
+// equivalents:
+//
+// Types:
+//
+// handle -- must be trivially copyable.
+// key -- must be copyable and default constructible.  Keys are compared
+//   with the < operator, which must be a strict weak order.  Each element
+//   in the tree must have a unique key.
+// size -- an unsigned integral type.
+//
+// Member functions:
+//
+// handle null() -- returns a handle value that is never associated with
+//   an element.
+// key get_key(handle h) -- returns the key of the element h.  The key of
+//   an element must not change while it is in the tree.
+// void * allocate_node() -- returns node_bytes bytes of memory for a
+//   node, aligned as for new.  Nodes are accessed fastest if aligned to
+//   a multiple of 64 (a cache line).  Returns nullptr if no memory is
+//   available.
+// void free_node(void *p) -- frees memory returned by allocate_node().
+//
+// Static constant:
+//
+// static const unsigned node_bytes -- the size of a node.  Should be a
+//   multiple of 64.
+//
+// The tree owns its nodes, so purge() and the destructor free them.
+//
+template <class abstractor>
+class base_bplus_tree : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::key key;
+    typedef typename abstractor::handle handle;
+    typedef typename abstractor::size size;
+
+    static const unsigned node_bytes = abstractor::node_bytes;
+
+  protected:
+
+    // Bytes for the count and links in a leaf node, and for the count
+    // and the extra child pointer in an inner node, with padding.
+    static const unsigned leaf_header_bytes = 3 * sizeof(void *);
+    static const unsigned inner_header_bytes = 2 * sizeof(void *);
+
+  public:
+
+    // Maximum number of elements in a leaf node.
+    static const unsigned leaf_cap =
+      (node_bytes - leaf_header_bytes) / (sizeof(key) + sizeof(handle));
+
+    // Maximum number of keys in an inner node (which has one more child
+    // than keys).
+    static const unsigned inner_cap =
+      (node_bytes - inner_header_bytes) / (sizeof(key) + sizeof(void *));
+
+    base_bplus_tree() : root(nullptr), height(0), count_(0) { }
+
+    base_bplus_tree(const base_bplus_tree &) = delete;
+
+    base_bplus_tree & operator = (const base_bplus_tree &) = delete;
+
+    ~base_bplus_tree() { purge(); }
+
+    static handle null() { return(abstractor::null()); }
+
+    // Inserts the element h.  Returns h, or the handle of the element
+    // already in the tree with the same key (in which case h is not
+    // inserted).  Returns null() if a node could not be allocated (in
+    // which case the tree is unchanged).
+    inline handle insert(handle h);
+
+    inline handle search(key k, search_type st = EQUAL);
+
+    inline handle search_least();
+
+    inline handle search_greatest();
+
+    // Removes the element with the key k.  Returns its handle, or null()
+    // if there is no element with the key.
+    inline handle remove(key k);
+
+    // Removes all elements, and frees all nodes.
+    void purge()
+      {
+        if (root)
+          free_sub(root, height);
+
+        root = nullptr;
+        height = 0;
+        count_ = 0;
+      }
+
+    bool is_empty() { return(root == nullptr); }
+
+    // Returns the number of elements in the tree.
+    size count() { return(count_); }
+
+    // Replaces the contents of the tree with the num_elems elements whose
+    // handles are in the sequence starting at p, which must be in
+    // ascending key order.  Takes time proportional to num_elems.  The
+    // nodes are filled evenly (as full as possible).  Returns false if a
+    // node could not be allocated, leaving the tree empty.
+    template <typename fwd_iter>
+    bool build(fwd_iter p, size num_elems);
+
+  protected:
+
+    struct leaf
+      {
+        unsigned n;
+
+        leaf *prev, *next;
+
+        key k[leaf_cap];
+
+        handle h[leaf_cap];
+      };
+
+    struct inner
+      {
+        unsigned n;
+
+        key k[inner_cap];
+
+        // Keys in the subtree child[i] are not less than k[i - 1], and
+        // are less than k[i].
+        void *child[inner_cap + 1];
+      };
+
+    static_assert(
+      (leaf_cap >= 2) and (inner_cap >= 3) and (sizeof(leaf) <= node_bytes) and
+      (sizeof(inner) <= node_bytes),
+      "node_bytes too small for base_bplus_tree");
+
+    // Minimum number of elements or keys in a node other than the root.
+    static const unsigned leaf_min = leaf_cap / 2;
+    static const unsigned inner_min = (inner_cap - 1) / 2;
+
+    // Enough for more than 2 ** 30 leaves.
+    static const unsigned max_height = 32;
+
+    // Root node.  A leaf if height is 1.
+    void *root;
+
+    // Number of levels of nodes.  0 if the tree is empty.
+    unsigned height;
+
+    size count_;
+
+    // Returns the number of keys in the array k of n keys that are less
+    // than x.  The array is in ascending order.
+    static unsigned count_less(const key *k, unsigned n, const key &x)
+      {
+        return(
+          count_less(
+            k, n, x,
+            std::integral_constant<bool, std::is_arithmetic<key>::value>()));
+      }
+
+    static unsigned count_less(
+      const key *k, unsigned n, const key &x, std::true_type)
+      {
+        unsigned c = 0;
+
+        for (unsigned i = 0; i < n; ++i)
+          c += k[i] < x;
+
+        return(c);
+      }
+
+    static unsigned count_less(
+      const key *k, unsigned n, const key &x, std::false_type)
+      {
+        unsigned lo = 0, hi = n;
+
+        while (lo < hi)
+          {
+            unsigned mid = (lo + hi) / 2;
+
+            if (k[mid] < x)
+              lo = mid + 1;
+            else
+              hi = mid;
+          }
+
+        return(lo);
+      }
+
+    // Index of the child of in whose subtree would contain x.
+    static unsigned child_index(inner *in, const key &x)
+      {
+        unsigned i = count_less(in->k, in->n, x);
+
+        // Keys equal to a separator are in the subtree to its right.
+        if ((i < in->n) and !(x < in->k[i]))
+          ++i;
+
+        return(i);
+      }
+
+    // Returns the leaf whose key range includes x.  The tree must not be
+    // empty.
+    leaf * find_leaf(const key &x)
+      {
+        void *p = root;
+
+        for (unsigned lv = height; lv > 1; --lv)
+          {
+            inner *in = static_cast<inner *>(p);
+
+            p = in->child[child_index(in, x)];
+          }
+
+        return(static_cast<leaf *>(p));
+      }
+
+    leaf * least_leaf()
+      {
+        void *p = root;
+
+        for (unsigned lv = height; lv > 1; --lv)
+          p = static_cast<inner *>(p)->child[0];
+
+        return(static_cast<leaf *>(p));
+      }
+
+    leaf * greatest_leaf()
+      {
+        void *p = root;
+
+        for (unsigned lv = height; lv > 1; --lv)
+          {
+            inner *in = static_cast<inner *>(p);
+
+            p = in->child[in->n];
+          }
+
+        return(static_cast<leaf *>(p));
+      }
+
+    // Finds the position of the element to return from a search for x
+    // with search type st.  Returns false if there is no such element.
+    // Otherwise, the element is at position pos in leaf l.
+    bool find(const key &x, search_type st, leaf *&l, unsigned &pos)
+      {
+        if (!root)
+          return(false);
+
+        l = find_leaf(x);
+        pos = count_less(l->k, l->n, x);
+
+        bool found = (pos < l->n) and !(x < l->k[pos]);
+
+        if (found and (st & EQUAL))
+          return(true);
+
+        if (st & LESS)
+          {
+            if (pos == 0)
+              {
+                l = l->prev;
+
+                if (!l)
+                  return(false);
+
+                pos = l->n;
+              }
+
+            --pos;
+
+            return(true);
+          }
+
+        if (st & GREATER)
+          {
+            if (found)
+              ++pos;
+
+            if (pos == l->n)
+              {
+                l = l->next;
+                pos = 0;
+              }
+
+            return(l != nullptr);
+          }
+
+        return(false);
+      }
+
+    leaf * new_leaf(void *mem) { return(new (mem) leaf); }
+
+    inner * new_inner(void *mem) { return(new (mem) inner); }
+
+    void free_leaf(leaf *l)
+      {
+        l->~leaf();
+        abstractor::free_node(l);
+      }
+
+    void free_inner(inner *in)
+      {
+        in->~inner();
+        abstractor::free_node(in);
+      }
+
+    // Free all the nodes in the subtree p, whose height is lv.
+    void free_sub(void *p, unsigned lv)
+      {
+        if (lv == 1)
+          {
+            free_leaf(static_cast<leaf *>(p));
+            return;
+          }
+
+        inner *in = static_cast<inner *>(p);
+
+        for (unsigned i = 0; i <= in->n; ++i)
+          free_sub(in->child[i], lv - 1);
+
+        free_inner(in);
+      }
+
+    // Insert key x and handle h in leaf l (which is not full) at
+    // position pos.
+    static void leaf_insert(leaf *l, unsigned pos, const key &x, handle h)
+      {
+        for (unsigned i = l->n; i > pos; --i)
+          {
+            l->k[i] = l->k[i - 1];
+            l->h[i] = l->h[i - 1];
+          }
+
+        l->k[pos] = x;
+        l->h[pos] = h;
+        ++l->n;
+      }
+
+    static void leaf_erase(leaf *l, unsigned pos)
+      {
+        --l->n;
+
+        for (unsigned i = pos; i < l->n; ++i)
+          {
+            l->k[i] = l->k[i + 1];
+            l->h[i] = l->h[i + 1];
+          }
+      }
+
+    // Insert separator key x at position pos in inner node in (which is
+    // not full), with the child c to its right.
+    static void inner_insert(inner *in, unsigned pos, const key &x, void *c)
+      {
+        for (unsigned i = in->n; i > pos; --i)
+          {
+            in->k[i] = in->k[i - 1];
+            in->child[i + 1] = in->child[i];
+          }
+
+        in->k[pos] = x;
+        in->child[pos + 1] = c;
+        ++in->n;
+      }
+
+    // Removes the separator key at position pos in inner node in, and the
+    // child to its right.
+    static void inner_erase(inner *in, unsigned pos)
+      {
+        --in->n;
+
+        for (unsigned i = pos; i < in->n; ++i)
+          {
+            in->k[i] = in->k[i + 1];
+            in->child[i + 1] = in->child[i + 2];
+          }
+      }
+
+    // Fix the leaf l (child i of p), which has one less element than the
+    // minimum, by moving an element from a sibling, or merging with a
+    // sibling.  Returns true if a separator was removed from p.
+    bool fix_leaf(inner *p, unsigned i, leaf *l)
+      {
+        if (i > 0)
+          {
+            leaf *ls = static_cast<leaf *>(p->child[i - 1]);
+
+            if (ls->n > leaf_min)
+              {
+                --ls->n;
+                leaf_insert(l, 0, ls->k[ls->n], ls->h[ls->n]);
+                p->k[i - 1] = l->k[0];
+                return(false);
+              }
+          }
+
+        if (i < p->n)
+          {
+            leaf *rs = static_cast<leaf *>(p->child[i + 1]);
+
+            if (rs->n > leaf_min)
+              {
+                leaf_insert(l, l->n, rs->k[0], rs->h[0]);
+                leaf_erase(rs, 0);
+                p->k[i] = rs->k[0];
+                return(false);
+              }
+          }
+
+        // Merge the right node of a pair of siblings into the left one.
+
+        if (i == 0)
+          ++i;
+
+        leaf *left = static_cast<leaf *>(p->child[i - 1]);
+        leaf *right = static_cast<leaf *>(p->child[i]);
+
+        for (unsigned j = 0; j < right->n; ++j)
+          {
+            left->k[left->n + j] = right->k[j];
+            left->h[left->n + j] = right->h[j];
+          }
+
+        left->n += right->n;
+        left->next = right->next;
+        if (left->next)
+          left->next->prev = left;
+
+        inner_erase(p, i - 1);
+        free_leaf(right);
+
+        return(true);
+      }
+
+    // Same as fix_leaf(), for an inner node in.
+    bool fix_inner(inner *p, unsigned i, inner *in)
+      {
+        if (i > 0)
+          {
+            inner *ls = static_cast<inner *>(p->child[i - 1]);
+
+            if (ls->n > inner_min)
+              {
+                in->child[in->n + 1] = in->child[in->n];
+                for (unsigned j = in->n; j > 0; --j)
+                  {
+                    in->k[j] = in->k[j - 1];
+                    in->child[j] = in->child[j - 1];
+                  }
+                in->k[0] = p->k[i - 1];
+                in->child[0] = ls->child[ls->n];
+                ++in->n;
+
+                --ls->n;
+                p->k[i - 1] = ls->k[ls->n];
+
+                return(false);
+              }
+          }
+
+        if (i < p->n)
+          {
+            inner *rs = static_cast<inner *>(p->child[i + 1]);
+
+            if (rs->n > inner_min)
+              {
+                in->k[in->n] = p->k[i];
+                in->child[in->n + 1] = rs->child[0];
+                ++in->n;
+
+                p->k[i] = rs->k[0];
+
+                rs->child[0] = rs->child[1];
+                inner_erase(rs, 0);
+
+                return(false);
+              }
+          }
+
+        if (i == 0)
+          ++i;
+
+        inner *left = static_cast<inner *>(p->child[i - 1]);
+        inner *right = static_cast<inner *>(p->child[i]);
+
+        left->k[left->n] = p->k[i - 1];
+
+        for (unsigned j = 0; j < right->n; ++j)
+          left->k[left->n + 1 + j] = right->k[j];
+
+        for (unsigned j = 0; j <= right->n; ++j)
+          left->child[left->n + 1 + j] = right->child[j];
+
+        left->n += right->n + 1;
+
+        inner_erase(p, i - 1);
+        free_inner(right);
+
+        return(true);
+      }
+
+    // Returns the subtree at the given level (0 for leaves) whose visit
+    // order in its level is j, with its least key in least_key.  p, last
+    // and level_count are as in build().  Returns nullptr if a node could
+    // not be allocated.
+    template <typename fwd_iter>
+    void * build_sub(
+      const size *level_count, unsigned level, size j, size num_elems,
+      fwd_iter &p, leaf *&last, key &least_key);
+
+  public:
+
+    // Iterator.  Has the same member functions as avl_tree's iter.
+    //
+    class iter
+      {
+      public:
+
+        iter() : l(nullptr), pos(0) { }
+
+        void start_iter(base_bplus_tree &tree, key k, search_type st = EQUAL)
+          {
+            if (!tree.find(k, st, l, pos))
+              l = nullptr;
+          }
+
+        void start_iter_least(base_bplus_tree &tree)
+          {
+            l = tree.root ? tree.least_leaf() : nullptr;
+            pos = 0;
+          }
+
+        void start_iter_greatest(base_bplus_tree &tree)
+          {
+            l = tree.root ? tree.greatest_leaf() : nullptr;
+            pos = l ? l->n - 1 : 0;
+          }
+
+        // Returns the handle of the current element, or null() if the
+        // iterator is invalid.
+        handle operator * ()
+          { return(l ? l->h[pos] : base_bplus_tree::null()); }
+
+        void operator ++ ()
+          {
+            if (l and (++pos == l->n))
+              {
+                l = l->next;
+                pos = 0;
+              }
+          }
+
+        void operator -- ()
+          {
+            if (l)
+              {
+                if (pos == 0)
+                  {
+                    l = l->prev;
+                    pos = l ? l->n : 1;
+                  }
+
+                --pos;
+              }
+          }
+
+        void operator ++ (int) { ++(*this); }
+
+        void operator -- (int) { --(*this); }
+
+      protected:
+
+        // Current leaf, or null if the iterator is invalid.
+        leaf *l;
+
+        // Position of current element in l.
+        unsigned pos;
+      };
+
+    friend class iter;
+  };
+
+template <class abstractor>
+inline auto base_bplus_tree<abstractor>::insert(handle h) -> handle
+  {
+    key x = abstractor::get_key(h);
+
+    if (!root)
+      {
+        void *mem = abstractor::allocate_node();
+
+        if (!mem)
+          return(null());
+
+        leaf *l = new_leaf(mem);
+
+        l->n = 0;
+        l->prev = nullptr;
+        l->next = nullptr;
+        leaf_insert(l, 0, x, h);
+
+        root = l;
+        height = 1;
+        count_ = 1;
+
+        return(h);
+      }
+
+    // Inner nodes on the path from the root to the leaf, and the index of
+    // the child taken in each.
+    inner *path[max_height];
+    unsigned path_i[max_height];
+
+    void *p = root;
+
+    for (unsigned d = 0; d < (height - 1); ++d)
+      {
+        inner *in = static_cast<inner *>(p);
+
+        path[d] = in;
+        path_i[d] = child_index(in, x);
+        p = in->child[path_i[d]];
+      }
+
+    leaf *l = static_cast<leaf *>(p);
+    unsigned pos = count_less(l->k, l->n, x);
+
+    if ((pos < l->n) and !(x < l->k[pos]))
+      return(l->h[pos]);
+
+    ++count_;
+
+    if (l->n < leaf_cap)
+      {
+        leaf_insert(l, pos, x, h);
+
+        return(h);
+      }
+
+    // Allocate all the nodes needed for splits first, so that the tree
+    // is unchanged if an allocation fails.
+
+    unsigned num_new = 1;
+    unsigned d = height - 1;
+
+    while ((d > 0) and (path[d - 1]->n == inner_cap))
+      {
+        ++num_new;
+        --d;
+      }
+
+    if (d == 0)
+      // Root will split.
+      ++num_new;
+
+    void *mem[max_height + 1];
+
+    for (unsigned i = 0; i < num_new; ++i)
+      {
+        mem[i] = abstractor::allocate_node();
+
+        if (!mem[i])
+          {
+            while (i)
+              abstractor::free_node(mem[--i]);
+
+            --count_;
+
+            return(null());
+          }
+      }
+
+    // Split the leaf.  The left node gets split of the cap + 1 elements.
+
+    leaf *r = new_leaf(mem[--num_new]);
+    const unsigned split = (leaf_cap + 1) / 2;
+    const unsigned from = pos < split ? split - 1 : split;
+
+    r->n = leaf_cap - from;
+    for (unsigned i = 0; i < r->n; ++i)
+      {
+        r->k[i] = l->k[from + i];
+        r->h[i] = l->h[from + i];
+      }
+    l->n = from;
+
+    if (pos < split)
+      leaf_insert(l, pos, x, h);
+    else
+      leaf_insert(r, pos - split, x, h);
+
+    r->next = l->next;
+    if (r->next)
+      r->next->prev = r;
+    r->prev = l;
+    l->next = r;
+
+    // Separator and new node to insert into the parent.
+    key sep = r->k[0];
+    void *new_node = r;
+
+    for (d = height - 1; d > 0; --d)
+      {
+        inner *in = path[d - 1];
+        unsigned i = path_i[d - 1];
+
+        if (in->n < inner_cap)
+          {
+            inner_insert(in, i, sep, new_node);
+
+            return(h);
+          }
+
+        // Split the inner node.  Of the cap + 1 keys, the left node keeps
+        // the first cap / 2, the next goes up to the parent, and the
+        // right node gets the rest.
+
+        key tk[inner_cap + 1];
+        void *tc[inner_cap + 2];
+
+        for (unsigned j = 0, s = 0; j <= inner_cap; ++j)
+          {
+            if (j == i)
+              tk[j] = sep;
+            else
+              tk[j] = in->k[s++];
+          }
+
+        tc[0] = in->child[0];
+        for (unsigned j = 1, s = 1; j <= (inner_cap + 1); ++j)
+          {
+            if (j == (i + 1))
+              tc[j] = new_node;
+            else
+              tc[j] = in->child[s++];
+          }
+
+        const unsigned m = inner_cap / 2;
+        inner *rin = new_inner(mem[--num_new]);
+
+        in->n = m;
+        for (unsigned j = 0; j < m; ++j)
+          in->k[j] = tk[j];
+        for (unsigned j = 0; j <= m; ++j)
+          in->child[j] = tc[j];
+
+        rin->n = inner_cap - m;
+        for (unsigned j = 0; j < rin->n; ++j)
+          rin->k[j] = tk[m + 1 + j];
+        for (unsigned j = 0; j <= rin->n; ++j)
+          rin->child[j] = tc[m + 1 + j];
+
+        sep = tk[m];
+        new_node = rin;
+      }
+
+    // The root split.
+
+    inner *nr = new_inner(mem[--num_new]);
+
+    nr->n = 1;
+    nr->k[0] = sep;
+    nr->child[0] = root;
+    nr->child[1] = new_node;
+
+    root = nr;
+    ++height;
+
+    return(h);
+  }
+
+template <class abstractor>
+inline auto base_bplus_tree<abstractor>::search(key k, search_type st)
+  -> handle
+  {
+    leaf *l;
+    unsigned pos;
+
+    if (!find(k, st, l, pos))
+      return(null());
+
+    return(l->h[pos]);
+  }
+
+template <class abstractor>
+inline auto base_bplus_tree<abstractor>::search_least() -> handle
+  {
+    if (!root)
+      return(null());
+
+    return(least_leaf()->h[0]);
+  }
+
+template <class abstractor>
+inline auto base_bplus_tree<abstractor>::search_greatest() -> handle
+  {
+    if (!root)
+      return(null());
+
+    leaf *l = greatest_leaf();
+
+    return(l->h[l->n - 1]);
+  }
+
+template <class abstractor>
+inline auto base_bplus_tree<abstractor>::remove(key k) -> handle
+  {
+    if (!root)
+      return(null());
+
+    inner *path[max_height];
+    unsigned path_i[max_height];
+
+    void *p = root;
+
+    for (unsigned d = 0; d < (height - 1); ++d)
+      {
+        inner *in = static_cast<inner *>(p);
+
+        path[d] = in;
+        path_i[d] = child_index(in, k);
+        p = in->child[path_i[d]];
+      }
+
+    leaf *l = static_cast<leaf *>(p);
+    unsigned pos = count_less(l->k, l->n, k);
+
+    if ((pos == l->n) or (k < l->k[pos]))
+      return(null());
+
+    handle h = l->h[pos];
+
+    leaf_erase(l, pos);
+    --count_;
+
+    if (height == 1)
+      {
+        if (l->n == 0)
+          {
+            free_leaf(l);
+            root = nullptr;
+            height = 0;
+          }
+
+        return(h);
+      }
+
+    if (l->n >= leaf_min)
+      return(h);
+
+    unsigned d = height - 1;
+
+    if (!fix_leaf(path[d - 1], path_i[d - 1], l))
+      return(h);
+
+    // A separator was removed from path[d - 1].
+
+    for (--d; d > 0; --d)
+      {
+        inner *in = path[d];
+
+        if (in->n >= inner_min)
+          return(h);
+
+        if (!fix_inner(path[d - 1], path_i[d - 1], in))
+          return(h);
+      }
+
+    inner *r = static_cast<inner *>(root);
+
+    if (r->n == 0)
+      {
+        root = r->child[0];
+        --height;
+        free_inner(r);
+      }
+
+    return(h);
+  }
+
+template <class abstractor>
+template <typename fwd_iter>
+bool base_bplus_tree<abstractor>::build(fwd_iter p, size num_elems)
+  {
+    purge();
+
+    if (num_elems == 0)
+      return(true);
+
+    // Number of nodes at each level, from the leaves up.
+    size level_count[max_height];
+    unsigned levels = 1;
+
+    level_count[0] = (num_elems + leaf_cap - 1) / leaf_cap;
+
+    while (level_count[levels - 1] > 1)
+      {
+        level_count[levels] =
+          (level_count[levels - 1] + inner_cap) / (inner_cap + 1);
+        ++levels;
+      }
+
+    leaf *last = nullptr;
+    key least_key;
+
+    void *r =
+      build_sub(level_count, levels - 1, 0, num_elems, p, last, least_key);
+
+    if (!r)
+      return(false);
+
+    root = r;
+    height = levels;
+    count_ = num_elems;
+
+    return(true);
+  }
+
+template <class abstractor>
+template <typename fwd_iter>
+void * base_bplus_tree<abstractor>::build_sub(
+    const size *level_count, unsigned level, size j, size num_elems,
+    fwd_iter &p, leaf *&last, key &least_key)
+  {
+    void *mem = abstractor::allocate_node();
+
+    if (!mem)
+      return(nullptr);
+
+    if (level == 0)
+      {
+        // The elements are spread evenly over the leaves.
+        leaf *l = new_leaf(mem);
+        size nl = level_count[0];
+
+        l->n = unsigned((num_elems / nl) + (j < (num_elems % nl)));
+
+        for (unsigned i = 0; i < l->n; ++i, ++p)
+          {
+            l->h[i] = *p;
+            l->k[i] = abstractor::get_key(l->h[i]);
+          }
+
+        least_key = l->k[0];
+
+        l->prev = last;
+        l->next = nullptr;
+        if (last)
+          last->next = l;
+        last = l;
+
+        return(l);
+      }
+
+    // The nodes at the level below are spread evenly over the nodes at
+    // this level.
+    inner *in = new_inner(mem);
+    size nc = level_count[level - 1], nn = level_count[level];
+    size q = nc / nn, extra = nc % nn;
+    size first = (j * q) + (j < extra ? j : extra);
+    unsigned num_child = unsigned(q + (j < extra));
+
+    in->n = 0;
+
+    for (unsigned i = 0; i < num_child; ++i)
+      {
+        key lk;
+        void *c =
+          build_sub(level_count, level - 1, first + i, num_elems, p, last, lk);
+
+        if (!c)
+          {
+            // Free this node and the completed children.
+            if (i > 0)
+              {
+                in->n = i - 1;
+                free_sub(in, level + 1);
+              }
+            else
+              free_inner(in);
+
+            return(nullptr);
+          }
+
+        in->child[i] = c;
+
+        if (i == 0)
+          least_key = lk;
+        else
+          in->k[in->n++] = lk;
+      }
+
+    return(in);
+  }
+
+namespace impl
+{
+
+// Abstractor for base_bplus_tree that allocates nodes with new.
+//
+template <class abstractor>
+class bplus_tree_abs : protected abstractor
+  {
+  protected:
+
+    void * allocate_node()
+      {
+        // Room to align, and to save the pointer to free.
+        std::size_t space = abstractor::node_bytes + 64 + sizeof(void *);
+        void *raw = ::operator new(space, std::nothrow);
+
+        if (!raw)
+          return(nullptr);
+
+        void *p = static_cast<char *>(raw) + sizeof(void *);
+
+        space -= sizeof(void *);
+        std::align(64, abstractor::node_bytes, p, space);
+
+        static_cast<void **>(p)[-1] = raw;
+
+        return(p);
+      }
+
+    void free_node(void *p) { ::operator delete(static_cast<void **>(p)[-1]); }
+  };
+
+} // end namespace impl
+
+// Abstractor parameter has the same requirements as for the
+// base_bplus_tree template, except that it does not have the
+// allocate_node() and free_node() member functions.  Nodes are allocated
+// with new.
+//
+template <class abstractor>
+using bplus_tree = base_bplus_tree<impl::bplus_tree_abs<abstractor> >;
+
+} // end namespace abstract_container
+
+#endif /* Include once */
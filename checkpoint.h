@@ -0,0 +1,707 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_CHECKPOINT_H_
+#define ABSTRACT_CONTAINER_CHECKPOINT_H_
+
+// Streaming checkpoints of AVL trees and hash tables (POSIX only).  A
+// container is saved by writing its elements, one after another, to a
+// sink, and reloaded by reading them back from a source, with no
+// searching.  An AVL tree is saved in ascending key order, and reloaded
+// with build(), so reloading it takes linear time and compares no nodes.
+// A hash table is saved bucket by bucket, with the hash value of each
+// bucket, and the elements are reloaded into the same buckets, with no
+// calls to hash_elem().
+//
+// The containers do not know what is in the elements, so the caller
+// gives a function (or function object) to save an element, and one to
+// load an element:
+//
+// bool save_elem(sink &s, handle h) -- writes the element h to s (for
+//   example, with checkpoint_write()).  Returns false on failure.
+// bool load_elem(source &s, handle &h) -- allocates an element, reads
+//   it from s, and puts its handle in h.  Returns false on failure.
+//
+// A sink class must have the member function:
+//
+// bool write(const void *p, std::size_t n) -- writes n bytes starting at
+//   p.  Returns false on failure.
+//
+// A source class must have the member function:
+//
+// bool read(void *p, std::size_t n) -- reads n bytes into memory starting
+//   at p.  Returns false on failure, or if there are fewer than n bytes
+//   left.
+//
+// fd_sink and fd_source are buffered sinks and sources for a file
+// descriptor.  async_fd_sink is a sink that writes to a file descriptor
+// with a thread of its own, so that the elements can be saved into one
+// buffer while the previous buffer is being written.  Several containers
+// can be saved one after another to the same sink, and loaded in the same
+// order from a source.  The save functions do not flush the sink.
+//
+// For example:
+//
+//   bool save_elem(async_fd_sink &s, node *h)
+//     {
+//       return(checkpoint_write(s, h->key) and checkpoint_write(s, h->val));
+//     }
+//
+//   bool load_elem(fd_source &s, node * &h)
+//     {
+//       h = new node;
+//
+//       return(checkpoint_read(s, h->key) and checkpoint_read(s, h->val));
+//     }
+//
+//   async_fd_sink s(fd);
+//
+//   save_avl_tree(tree, s, save_elem);
+//   s.flush();
+//
+//   fd_source src(fd2);
+//
+//   load_avl_tree(tree2, src, load_elem);
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include <unistd.h>
+
+namespace abstract_container
+{
+
+// Header at the start of each saved container.  The fields are in the
+// byte order of the CPU that wrote the checkpoint.
+//
+struct checkpoint_header
+  {
+    static const std::uint64_t magic_value = 0x31504b4354524241ULL;
+
+    // Values of kind.
+    static const std::uint64_t avl_tree_kind = 1;
+    static const std::uint64_t hash_table_kind = 2;
+
+    // Always magic_value.
+    std::uint64_t magic;
+
+    std::uint64_t kind;
+
+    // For an AVL tree, the number of elements.  For a hash table, the
+    // number of buckets in use.
+    std::uint64_t count;
+  };
+
+// Writes the bytes of the trivially copyable value v to the sink s.
+//
+template <class sink, typename T>
+inline bool checkpoint_write(sink &s, const T &v)
+  {
+    static_assert(
+      std::is_trivially_copyable<T>::value,
+      "checkpoint_write() value must be trivially copyable");
+
+    return(s.write(&v, sizeof(v)));
+  }
+
+// Reads the bytes of the trivially copyable value v from the source s.
+//
+template <class source, typename T>
+inline bool checkpoint_read(source &s, T &v)
+  {
+    static_assert(
+      std::is_trivially_copyable<T>::value,
+      "checkpoint_read() value must be trivially copyable");
+
+    return(s.read(&v, sizeof(v)));
+  }
+
+namespace impl
+{
+
+// Writes all n bytes starting at p to the file descriptor fd.
+//
+inline bool checkpoint_write_all(int fd, const char *p, std::size_t n)
+  {
+    while (n)
+      {
+        ssize_t w = ::write(fd, p, n);
+
+        if (w < 0)
+          {
+            if (errno == EINTR)
+              continue;
+
+            return(false);
+          }
+
+        p += w;
+        n -= std::size_t(w);
+      }
+
+    return(true);
+  }
+
+// Returns the number of elements in the AVL tree t.
+//
+template <class avl_tree_t>
+inline typename avl_tree_t::size checkpoint_count(
+  avl_tree_t &t, std::true_type)
+  { return(t.count()); }
+
+template <class avl_tree_t>
+inline typename avl_tree_t::size checkpoint_count(
+  avl_tree_t &t, std::false_type)
+  {
+    if (t.is_empty())
+      return(0);
+
+    typename avl_tree_t::size n = 1;
+    typename avl_tree_t::iter it, last;
+
+    // Count up to the greatest node, so the null handle is not needed.
+    last.start_iter_greatest(t);
+
+    for (it.start_iter_least(t); *it != *last; ++it)
+      ++n;
+
+    return(n);
+  }
+
+} // end namespace impl
+
+// Buffered sink that writes to a file descriptor (which it does not
+// close).  flush() must be called to write the last of the data.
+//
+class fd_sink
+  {
+  public:
+
+    explicit fd_sink(int fd_, std::size_t buf_bytes = 1 << 16)
+      : fd(fd_), buf(new char[buf_bytes]), buf_size(buf_bytes), fill(0),
+        error(false)
+      { }
+
+    fd_sink(const fd_sink &) = delete;
+
+    fd_sink & operator = (const fd_sink &) = delete;
+
+    bool write(const void *p, std::size_t n)
+      {
+        const char *c = static_cast<const char *>(p);
+
+        while (!error and ((fill + n) > buf_size))
+          {
+            std::size_t part = buf_size - fill;
+
+            std::memcpy(buf.get() + fill, c, part);
+            fill = buf_size;
+            c += part;
+            n -= part;
+            flush();
+          }
+
+        if (error)
+          return(false);
+
+        std::memcpy(buf.get() + fill, c, n);
+        fill += n;
+
+        return(true);
+      }
+
+    // Writes the buffered data to the file.  Returns false if any write
+    // has failed.
+    bool flush()
+      {
+        if (!error and fill)
+          error = !impl::checkpoint_write_all(fd, buf.get(), fill);
+
+        fill = 0;
+
+        return(!error);
+      }
+
+  private:
+
+    int fd;
+    std::unique_ptr<char[]> buf;
+    std::size_t buf_size, fill;
+    bool error;
+  };
+
+// Sink that writes to a file descriptor (which it does not close) with
+// a writer thread.  Data is put into one of two buffers.  When it is
+// full, it is passed to the writer thread, and the other buffer is
+// filled while it is being written.  So saving of elements and writing
+// to the file overlap.  flush() must be called to write the last of the
+// data (the destructor also calls it).
+//
+class async_fd_sink
+  {
+  public:
+
+    explicit async_fd_sink(int fd_, std::size_t buf_bytes = 1 << 20)
+      : fd(fd_), buf_size(buf_bytes), curr(0), fill(0), pending_len(0),
+        pending(false), done(false), error(false),
+        writer(&async_fd_sink::write_buffers, this)
+      {
+        buf[0].reset(new char[buf_bytes]);
+        buf[1].reset(new char[buf_bytes]);
+      }
+
+    async_fd_sink(const async_fd_sink &) = delete;
+
+    async_fd_sink & operator = (const async_fd_sink &) = delete;
+
+    ~async_fd_sink()
+      {
+        flush();
+
+        {
+          std::lock_guard<std::mutex> lk(mtx);
+
+          done = true;
+        }
+
+        cv.notify_all();
+        writer.join();
+      }
+
+    bool write(const void *p, std::size_t n)
+      {
+        const char *c = static_cast<const char *>(p);
+
+        while ((fill + n) > buf_size)
+          {
+            std::size_t part = buf_size - fill;
+
+            std::memcpy(buf[curr].get() + fill, c, part);
+            fill = buf_size;
+            c += part;
+            n -= part;
+            if (!hand_off())
+              return(false);
+          }
+
+        std::memcpy(buf[curr].get() + fill, c, n);
+        fill += n;
+
+        return(true);
+      }
+
+    // Waits until all the data is written to the file.  Returns false if
+    // any write has failed.
+    bool flush()
+      {
+        hand_off();
+
+        std::unique_lock<std::mutex> lk(mtx);
+
+        while (pending)
+          cv.wait(lk);
+
+        return(!error);
+      }
+
+  private:
+
+    int fd;
+    std::size_t buf_size;
+
+    // Buffer being filled, and number of bytes in it.
+    unsigned curr;
+    std::size_t fill;
+
+    std::unique_ptr<char[]> buf[2];
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // These are protected by mtx.  If pending is true, the buffer that
+    // is not being filled has pending_len bytes for the writer thread to
+    // write.
+    std::size_t pending_len;
+    bool pending, done, error;
+
+    std::thread writer;
+
+    // Waits until the writer thread is done with the other buffer, then
+    // passes the buffer being filled to it.  Returns false if any write
+    // has failed.
+    bool hand_off()
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+
+        while (pending)
+          cv.wait(lk);
+
+        if (error)
+          {
+            fill = 0;
+            return(false);
+          }
+
+        if (fill)
+          {
+            pending = true;
+            pending_len = fill;
+            curr ^= 1;
+            fill = 0;
+            cv.notify_all();
+          }
+
+        return(true);
+      }
+
+    // Body of the writer thread.
+    void write_buffers()
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+
+        for ( ; ; )
+          {
+            while (!pending and !done)
+              cv.wait(lk);
+
+            if (!pending)
+              break;
+
+            const char *p = buf[curr ^ 1].get();
+            std::size_t n = pending_len;
+
+            lk.unlock();
+
+            bool ok = impl::checkpoint_write_all(fd, p, n);
+
+            lk.lock();
+
+            if (!ok)
+              error = true;
+            pending = false;
+            cv.notify_all();
+          }
+      }
+  };
+
+// Buffered source that reads from a file descriptor (which it does not
+// close).
+//
+class fd_source
+  {
+  public:
+
+    explicit fd_source(int fd_, std::size_t buf_bytes = 1 << 16)
+      : fd(fd_), buf(new char[buf_bytes]), buf_size(buf_bytes), pos(0),
+        fill(0)
+      { }
+
+    fd_source(const fd_source &) = delete;
+
+    fd_source & operator = (const fd_source &) = delete;
+
+    bool read(void *p, std::size_t n)
+      {
+        char *c = static_cast<char *>(p);
+
+        while (n > (fill - pos))
+          {
+            std::size_t part = fill - pos;
+
+            std::memcpy(c, buf.get() + pos, part);
+            c += part;
+            n -= part;
+
+            ssize_t r;
+
+            do
+              r = ::read(fd, buf.get(), buf_size);
+            while ((r < 0) and (errno == EINTR));
+
+            pos = 0;
+            fill = r > 0 ? std::size_t(r) : 0;
+
+            if (fill == 0)
+              return(false);
+          }
+
+        std::memcpy(c, buf.get() + pos, n);
+        pos += n;
+
+        return(true);
+      }
+
+  private:
+
+    int fd;
+    std::unique_ptr<char[]> buf;
+    std::size_t buf_size, pos, fill;
+  };
+
+// Saves the elements of the AVL tree t (an instantiation of
+// base_avl_tree, or a class derived from one) to the sink s, in ascending
+// key order, calling save_elem for each one.  The number of elements is
+// written first, so if the abstractor does not have subtree sizes, the
+// elements are counted (by iterating over them) before any are saved.
+// Returns false on failure.
+//
+template <class avl_tree_t, class sink, class save_fn>
+bool save_avl_tree(avl_tree_t &t, sink &s, save_fn save_elem)
+  {
+    typename avl_tree_t::size n =
+      impl::checkpoint_count(
+        t,
+        std::integral_constant<bool, avl_tree_t::subtree_sizes>());
+    typename avl_tree_t::iter it;
+    checkpoint_header hdr;
+
+    hdr.magic = checkpoint_header::magic_value;
+    hdr.kind = checkpoint_header::avl_tree_kind;
+    hdr.count = n;
+
+    if (!checkpoint_write(s, hdr))
+      return(false);
+
+    it.start_iter_least(t);
+
+    for ( ; n; --n, ++it)
+      if (!save_elem(s, *it))
+        return(false);
+
+    return(true);
+  }
+
+namespace impl
+{
+
+// Input sequence of elements being loaded, for build().  Each increment
+// loads the next element, until num_left elements are loaded, or one
+// fails to load.  The iterator's failed() then makes build() stop.
+//
+template <class source, class load_fn, typename handle_t>
+class checkpoint_load_seq
+  {
+  public:
+
+    typedef handle_t handle;
+
+    checkpoint_load_seq(source &s_, load_fn &load_elem_, std::uint64_t n)
+      : s(s_), load_elem(load_elem_), num_left(n), ok(true)
+      { next(); }
+
+    void next()
+      {
+        if (ok and num_left)
+          {
+            --num_left;
+            ok = load_elem(s, curr);
+          }
+      }
+
+    source &s;
+    load_fn &load_elem;
+    std::uint64_t num_left;
+    handle curr;
+    bool ok;
+  };
+
+template <class seq>
+class checkpoint_load_iter
+  {
+  public:
+
+    explicit checkpoint_load_iter(seq &sq_) : sq(&sq_) { }
+
+    typename seq::handle operator * () const { return(sq->curr); }
+
+    checkpoint_load_iter & operator ++ () { sq->next(); return(*this); }
+
+    // True if an element failed to load, so build() stops.
+    bool failed() const { return(!sq->ok); }
+
+    checkpoint_load_iter operator ++ (int)
+      {
+        checkpoint_load_iter i(*this);
+
+        sq->next();
+
+        return(i);
+      }
+
+  private:
+
+    seq *sq;
+  };
+
+} // end namespace impl
+
+// Loads an AVL tree saved by save_avl_tree() from the source s into the
+// tree t (whose abstractor must order the elements the same way as the
+// saved tree's), calling load_elem for each element.  The tree is built
+// with build() as the elements are read, so the time is linear, and no
+// elements are compared.  Any elements in t before the call are removed
+// from it (as by purge()).  Returns false on failure, leaving t empty
+// (and the elements already loaded in no container, with links in an
+// undefined state).
+//
+template <class avl_tree_t, class source, class load_fn>
+bool load_avl_tree(avl_tree_t &t, source &s, load_fn load_elem)
+  {
+    typedef typename avl_tree_t::size size;
+    typedef typename avl_tree_t::handle handle;
+
+    checkpoint_header hdr;
+
+    t.purge();
+
+    if (!checkpoint_read(s, hdr) or
+        (hdr.magic != checkpoint_header::magic_value) or
+        (hdr.kind != checkpoint_header::avl_tree_kind) or
+        (hdr.count != std::uint64_t(size(hdr.count))))
+      return(false);
+
+    if (hdr.count == 0)
+      return(true);
+
+    typedef impl::checkpoint_load_seq<source, load_fn, handle> seq_t;
+
+    seq_t sq(s, load_elem, hdr.count);
+
+    if (!sq.ok)
+      return(false);
+
+    return(t.build(impl::checkpoint_load_iter<seq_t>(sq), size(hdr.count)));
+  }
+
+// Record before the elements of each bucket saved by save_hash_table().
+// The buckets are ended by a record with num_elems equal to zero.
+//
+struct checkpoint_bucket_header
+  {
+    std::uint64_t hash_value;
+    std::uint64_t num_elems;
+  };
+
+// Saves the elements of the hash table t (an instantiation of
+// base_hash_table, or a class derived from one) to the sink s, calling
+// save_elem for each one.  The elements of each bucket that is not
+// empty are saved after its hash value.  Returns false on failure.
+//
+template <class hash_table_t, class sink, class save_fn>
+bool save_hash_table(hash_table_t &t, sink &s, save_fn save_elem)
+  {
+    checkpoint_header hdr;
+
+    hdr.magic = checkpoint_header::magic_value;
+    hdr.kind = checkpoint_header::hash_table_kind;
+    hdr.count = t.num_buckets();
+
+    if (!checkpoint_write(s, hdr))
+      return(false);
+
+    typename hash_table_t::iter it(t);
+    checkpoint_bucket_header bh;
+
+    while (it)
+      {
+        typename hash_table_t::iter e(it);
+
+        bh.hash_value = it.hash_value();
+        bh.num_elems = 0;
+
+        for ( ; e and (e.hash_value() == it.hash_value()); ++e)
+          ++bh.num_elems;
+
+        if (!checkpoint_write(s, bh))
+          return(false);
+
+        for ( ; bh.num_elems; --bh.num_elems, ++it)
+          if (!save_elem(s, *it))
+            return(false);
+      }
+
+    bh.hash_value = 0;
+
+    return(checkpoint_write(s, bh));
+  }
+
+// Loads a hash table saved by save_hash_table() from the source s into
+// the hash table t, calling load_elem for each element.  If t has the
+// same number of buckets in use as the saved table, each element is
+// inserted (with insert(h, hash_value)) into the bucket with the hash
+// value it was saved with, with no call to hash_elem().  Otherwise (for
+// example, for a linear hash table that has grown to a different number
+// of buckets by then), insert(h) is used.  The abstractor for t must
+// give the same hash values as the one for the saved table.  The order
+// of the elements in a bucket may not be the same as it was in the saved
+// table.  As for load_avl_tree(), any elements in t before the call are
+// removed from it (as by purge()).  Returns false on failure, leaving
+// the elements already loaded in t.
+//
+template <class hash_table_t, class source, class load_fn>
+bool load_hash_table(hash_table_t &t, source &s, load_fn load_elem)
+  {
+    typename hash_table_t::handle h;
+    checkpoint_header hdr;
+    checkpoint_bucket_header bh;
+
+    t.purge();
+
+    if (!checkpoint_read(s, hdr) or
+        (hdr.magic != checkpoint_header::magic_value) or
+        (hdr.kind != checkpoint_header::hash_table_kind))
+      return(false);
+
+    for ( ; ; )
+      {
+        if (!checkpoint_read(s, bh))
+          return(false);
+
+        if (bh.num_elems == 0)
+          break;
+
+        if (bh.hash_value >= hdr.count)
+          return(false);
+
+        for ( ; bh.num_elems; --bh.num_elems)
+          {
+            if (!load_elem(s, h))
+              return(false);
+
+            if (std::uint64_t(t.num_buckets()) == hdr.count)
+              t.insert(h, bh.hash_value);
+            else
+              t.insert(h);
+          }
+      }
+
+    return(true);
+  }
+
+} // end namespace abstract_container
+
+#endif /* Include once */
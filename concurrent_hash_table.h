@@ -0,0 +1,351 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_CONCURRENT_HASH_TABLE_H_
+#define ABSTRACT_CONTAINER_CONCURRENT_HASH_TABLE_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace abstract_container
+{
+
+// Hash table that can be shared by multiple threads.  search() and iter
+// take no locks.  insert(), remove_key(), remove() and purge() lock a
+// mutex, with one mutex for each stripe of buckets.
+//
+// abstractor parameter class must have these public members, or
+// equivalents:
+//
+// Types:
+//
+// handle -- must be trivially copyable.
+// index, key -- as for base_hash_table.
+//
+// Member functions:
+//
+// handle null() -- as for list.  Must be a static member.
+// std::atomic<handle> & link(handle) -- returns a reference to the
+//   atomic link stored in the element associated with the handle.
+// hash_key(), hash_elem(), is_key() -- as for base_hash_table.  May
+//   be called by multiple threads concurrently.  hash_elem() and is_key()
+//   may be called for an element that is being removed by another
+//   thread, but not with any element that has been reclaimed.
+//
+// Static constants:
+//
+// static const index num_hash_values -- as for base_hash_table.
+// static const unsigned num_locks -- the number of mutexes.  The bucket
+//   for a hash value hv is protected by mutex hv % num_locks.
+// static const unsigned max_readers -- the number of reader slots (see
+//   read_guard below).
+//
+// Reclamation:
+//
+// A thread must be in a read-side critical section (have a live
+// read_guard) while it is calling search(), or using an iter.  Each
+// thread that reads concurrently needs its own reader slot (in the range
+// 0 to max_readers - 1).  A reader slot may only be used by one thread
+// at a time.  Read-side critical sections cannot be nested.
+//
+// An element that has been removed from the table may still be in use
+// by readers.  It must not be reclaimed (reused, inserted again, or
+// have its key changed) until after a grace period has elapsed.  A
+// grace period has elapsed when every read-side critical section that
+// began before the element was removed has ended.  synchronize() waits
+// for a grace period.  So, after a call to synchronize() returns,
+// all of the elements that were removed before the call began
+// can be reclaimed.  Removals can be batched, with one call to
+// synchronize() for the batch.  synchronize() must not be called in a
+// read-side critical section.
+//
+template <class abstractor>
+class concurrent_hash_table : protected abstractor
+  {
+  protected:
+
+    typedef typename abstractor::index index;
+
+  public:
+
+    typedef typename abstractor::key key;
+    typedef typename abstractor::handle handle;
+
+    static const index num_hash_values = abstractor::num_hash_values;
+    static const unsigned num_locks = abstractor::num_locks;
+    static const unsigned max_readers = abstractor::max_readers;
+
+    concurrent_hash_table()
+      {
+        for (index i = 0; i < num_hash_values; ++i)
+          head[i].store(null(), std::memory_order_relaxed);
+
+        for (unsigned i = 0; i < max_readers; ++i)
+          reader[i].state.store(0, std::memory_order_relaxed);
+      }
+
+    concurrent_hash_table(const concurrent_hash_table &) = delete;
+
+    concurrent_hash_table & operator = (const concurrent_hash_table &) =
+      delete;
+
+    index hash_key(key k) { return(abstractor::hash_key(k)); }
+
+    index hash_elem(handle h) { return(abstractor::hash_elem(h)); }
+
+    static handle null() { return(abstractor::null()); }
+
+    // Read-side critical section, for the lifetime of the object.
+    //
+    class read_guard
+      {
+      public:
+
+        read_guard(concurrent_hash_table &ht, unsigned reader_slot)
+          : st(ht.reader[reader_slot].state)
+          {
+            // Odd while in a critical section.
+            unsigned long s = st.load(std::memory_order_relaxed) + 1;
+
+            st.store(s, std::memory_order_relaxed);
+
+            // The store to the slot must be visible to synchronize()
+            // before any bucket links are loaded.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+          }
+
+        ~read_guard()
+          {
+            st.fetch_add(1, std::memory_order_release);
+          }
+
+        read_guard(const read_guard &) = delete;
+
+        read_guard & operator = (const read_guard &) = delete;
+
+      private:
+
+        std::atomic<unsigned long> &st;
+      };
+
+    void insert(handle h, index hash_value)
+      {
+        std::lock_guard<std::mutex> lg(lock(hash_value));
+
+        link(h).store(
+          head[hash_value].load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+
+        // Release so that readers that see the new element see its
+        // link and its key.
+        head[hash_value].store(h, std::memory_order_release);
+      }
+
+    void insert(handle h) { insert(h, hash_elem(h)); }
+
+    // Returns null() if no element has key k.  Must be called in a
+    // read-side critical section.  The returned element cannot be
+    // reclaimed until the critical section ends.
+    //
+    handle search(key k, index hash_value)
+      {
+        handle h = head[hash_value].load(std::memory_order_acquire);
+
+        while ((h != null()) and !abstractor::is_key(k, h))
+          h = link(h).load(std::memory_order_acquire);
+
+        return(h);
+      }
+
+    handle search(key k) { return(search(k, hash_key(k))); }
+
+    // Returns the handle of the removed element, or null() is no element
+    // has key k.  Must not be called in a read-side critical section.
+    //
+    handle remove_key(key k)
+      {
+        index hv = hash_key(k);
+        std::lock_guard<std::mutex> lg(lock(hv));
+
+        std::atomic<handle> *prev = &head[hv];
+        handle h = prev->load(std::memory_order_relaxed);
+
+        while ((h != null()) and !abstractor::is_key(k, h))
+          {
+            prev = &link(h);
+            h = prev->load(std::memory_order_relaxed);
+          }
+
+        if (h != null())
+          // Removed element's link is left unchanged, so readers
+          // currently at it can continue.
+          prev->store(
+            link(h).load(std::memory_order_relaxed),
+            std::memory_order_release);
+
+        return(h);
+      }
+
+    // Removes the specified element (which must be in the table).
+    // Linear in the length of its bucket.
+    //
+    void remove(handle to_remove)
+      {
+        index hv = hash_elem(to_remove);
+        std::lock_guard<std::mutex> lg(lock(hv));
+
+        std::atomic<handle> *prev = &head[hv];
+        handle h = prev->load(std::memory_order_relaxed);
+
+        while (h != to_remove)
+          {
+            prev = &link(h);
+            h = prev->load(std::memory_order_relaxed);
+          }
+
+        prev->store(
+          link(h).load(std::memory_order_relaxed),
+          std::memory_order_release);
+      }
+
+    // Make the hash table empty.  All elements that were in the table
+    // are removed, with the same restrictions on reclamation as for
+    // remove().
+    //
+    void purge()
+      {
+        for (index i = 0; i < num_hash_values; ++i)
+          {
+            std::lock_guard<std::mutex> lg(lock(i));
+
+            head[i].store(null(), std::memory_order_release);
+          }
+      }
+
+    // Waits for a grace period (see above).
+    //
+    void synchronize()
+      {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        for (unsigned i = 0; i < max_readers; ++i)
+          {
+            unsigned long s =
+              reader[i].state.load(std::memory_order_acquire);
+
+            if (s & 1)
+              // Reader is in a critical section.  Wait for it to end.
+              // A critical section that starts later cannot see removed
+              // elements.
+              while (reader[i].state.load(std::memory_order_acquire) == s)
+                std::this_thread::yield();
+          }
+      }
+
+    // Iterator over all elements, for use in a read-side critical
+    // section.  Every element that is in the table for the whole life
+    // of the iterator is visited.  Elements inserted or removed
+    // concurrently may or may not be visited.  No element is visited
+    // twice.
+    //
+    class iter
+      {
+      public:
+
+        void start_iter(concurrent_hash_table &ht_)
+          {
+            ht = &ht_;
+
+            hv = index(0) - 1;
+            curr_h = concurrent_hash_table::null();
+
+            advance();
+          }
+
+        iter(concurrent_hash_table &ht_) { start_iter(ht_); }
+
+        // Returns handle of element currently referenced by iterator, or
+        // null() if the iterator is past the last element (if any).
+        //
+        handle operator * () { return(curr_h); }
+
+        operator bool () { return(curr_h != concurrent_hash_table::null()); }
+
+        concurrent_hash_table & table() { return(*ht); }
+
+        void operator ++ () { advance(); }
+
+        void operator ++ (int) { ++(*this); }
+
+      protected:
+
+        // Hash table being iterated over.
+        concurrent_hash_table *ht;
+
+        // Hash value, current bucket.
+        index hv;
+
+        // Handle of current element.
+        handle curr_h;
+
+        void advance()
+          {
+            if (curr_h != concurrent_hash_table::null())
+              curr_h = ht->link(curr_h).load(std::memory_order_acquire);
+
+            while (curr_h == concurrent_hash_table::null())
+              {
+                if (++hv >= num_hash_values)
+                  break;
+
+                curr_h = ht->head[hv].load(std::memory_order_acquire);
+              }
+          }
+      };
+
+  private:
+
+    // Pad to avoid false sharing.
+    struct alignas(64) lock_
+      {
+        std::mutex m;
+      };
+
+    struct alignas(64) reader_
+      {
+        std::atomic<unsigned long> state;
+      };
+
+    std::atomic<handle> head[num_hash_values];
+
+    lock_ locks[num_locks];
+
+    reader_ reader[max_readers];
+
+    std::atomic<handle> & link(handle h) { return(abstractor::link(h)); }
+
+    std::mutex & lock(index hash_value)
+      { return(locks[hash_value % num_locks].m); }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
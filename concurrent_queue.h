@@ -0,0 +1,370 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_CONCURRENT_QUEUE_H_
+#define ABSTRACT_CONTAINER_CONCURRENT_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "list.h"
+
+namespace abstract_container
+{
+
+// Lock-free intrusive FIFO queues, for passing elements between threads.
+//
+// abstractor parameter class must have these public members, or
+// equivalents:
+//
+// handle -- must be trivially copyable.
+//
+// handle null() -- as for list.  Must be a static member.
+//
+// std::atomic<handle> & link(handle) -- returns a reference to the
+//   atomic link stored in the element associated with the handle (as for
+//   concurrent_hash_table).
+//
+// An element must only be in one queue or list at a time.  Elements with
+// these links can also be put in a (locking) list, using the
+// abstractor atomic_link_list_abs<abstractor> (see below).
+//
+// The memory of an element that has been popped must not be freed while
+// other threads may be using the queue, because a thread popping
+// concurrently may still read its link.  (Elements from a node_pool,
+// see node_pool.h, satisfy this.)
+
+// Abstractor for list, for elements with atomic links (as required by
+// the queues).  The links are loaded and stored with relaxed memory
+// order, so the list must be used by only one thread at a time.
+//
+template <class abstractor>
+class atomic_link_list_abs : protected abstractor
+  {
+  protected:
+
+    typedef typename abstractor::handle handle;
+
+    static const bool store_tail = true;
+
+    static handle null() { return(abstractor::null()); }
+
+    handle link(handle h)
+      { return(abstractor::link(h).load(std::memory_order_relaxed)); }
+
+    void link(handle h, handle link_h)
+      { abstractor::link(h).store(link_h, std::memory_order_relaxed); }
+  };
+
+// Queue with any number of producer threads, and a single consumer
+// thread.  push() is wait-free, pop() and pop_all() are lock-free.
+//
+template <class abstractor>
+class mpsc_queue : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::handle handle;
+
+    typedef list<atomic_link_list_abs<abstractor> > list_type;
+
+    static handle null() { return(abstractor::null()); }
+
+    mpsc_queue() : head(null()), tail(null()) { }
+
+    mpsc_queue(const mpsc_queue &) = delete;
+
+    mpsc_queue & operator = (const mpsc_queue &) = delete;
+
+    // Adds an element at the end of the queue.  May be called by any
+    // thread.
+    //
+    void push(handle h)
+      {
+        link(h).store(null(), std::memory_order_relaxed);
+
+        handle prev = tail.exchange(h, std::memory_order_acq_rel);
+
+        // Until this store, the consumer cannot get to h.
+        if (prev == null())
+          head.store(h, std::memory_order_release);
+        else
+          link(prev).store(h, std::memory_order_release);
+      }
+
+    // Removes and returns the element at the start of the queue.  Returns
+    // the null value if the queue is empty.  It may also return the null
+    // value if the queue is not empty, but every element in it is being
+    // pushed by another thread.  Only called by the consumer thread.
+    //
+    handle pop()
+      {
+        handle h = head.load(std::memory_order_acquire);
+
+        if (h == null())
+          return(null());
+
+        handle next = link(h).load(std::memory_order_acquire);
+
+        if (next != null())
+          {
+            head.store(next, std::memory_order_relaxed);
+            return(h);
+          }
+
+        if (tail.load(std::memory_order_acquire) != h)
+          // A push is in progress, that will link h to the next element.
+          return(null());
+
+        // h is the only element.  The head must be null before the tail is
+        // (so that a push after the tail is null sets the head after this
+        // store).
+        head.store(null(), std::memory_order_relaxed);
+
+        handle t = h;
+
+        if (tail.compare_exchange_strong(
+              t, null(), std::memory_order_acq_rel,
+              std::memory_order_acquire))
+          return(h);
+
+        // An element was pushed after h, but is not linked to it yet.  Only
+        // the consumer stores the head while the tail is not null.
+        head.store(h, std::memory_order_relaxed);
+
+        return(null());
+      }
+
+    // Removes all the elements in the queue, and pushes them (in order)
+    // at the end (the reverse direction) of to.  Linear, and may wait for
+    // pushes (by other threads) that are in progress to finish.  Only
+    // called by the consumer thread.
+    //
+    void pop_all(list_type &to)
+      {
+        handle h = head.load(std::memory_order_acquire);
+
+        if (h == null())
+          return;
+
+        head.store(null(), std::memory_order_relaxed);
+
+        handle t = tail.exchange(null(), std::memory_order_acq_rel);
+
+        for ( ; ; )
+          {
+            handle next = null();
+
+            if (h != t)
+              // Wait for the push of the next element to link it.
+              while ((next = link(h).load(std::memory_order_acquire)) ==
+                     null())
+                ;
+
+            to.template push<reverse>(h);
+
+            if (h == t)
+              break;
+
+            h = next;
+          }
+      }
+
+    // Returns true if the queue was empty at some point during the call.
+    //
+    bool empty() { return(tail.load(std::memory_order_acquire) == null()); }
+
+  private:
+
+    // Only stored by the consumer, or by a push to an empty queue.
+    std::atomic<handle> head;
+
+    std::atomic<handle> tail;
+
+    std::atomic<handle> & link(handle h) { return(abstractor::link(h)); }
+  };
+
+// Queue with any number of producer and consumer threads.  The handles
+// must be of an unsigned integral type of no more than 32 bits (such as
+// indexes into an array of elements), so that a handle and a 32-bit tag
+// can be changed together by a single atomic operation.  The tag is
+// incremented by each pop, and prevents ABA errors (unless a pop is
+// delayed for exactly 2 ** 32 pops by other threads).
+//
+// The queue needs one extra element (the stub), which it holds while it
+// is empty.  The stub must not be used for anything else during the
+// lifetime of the queue.  The abstractor must be ready to use when the
+// queue is constructed.  push() is wait-free, pop() is lock-free.
+//
+template <class abstractor>
+class mpmc_queue : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::handle handle;
+
+    static_assert(
+      std::is_integral<handle>::value and std::is_unsigned<handle>::value and
+        (sizeof(handle) <= 4),
+      "mpmc_queue handles must be unsigned integers of 32 bits or less");
+
+    static handle null() { return(abstractor::null()); }
+
+    explicit mpmc_queue(handle stub_) : stub(stub_), stub_queued(true)
+      {
+        link(stub).store(null(), std::memory_order_relaxed);
+        head.store(stub, std::memory_order_relaxed);
+        tail.store(stub, std::memory_order_release);
+      }
+
+    mpmc_queue(const mpmc_queue &) = delete;
+
+    mpmc_queue & operator = (const mpmc_queue &) = delete;
+
+    // Adds an element at the end of the queue.
+    //
+    void push(handle h)
+      {
+        link(h).store(null(), std::memory_order_relaxed);
+
+        handle prev = tail.exchange(h, std::memory_order_acq_rel);
+
+        link(prev).store(h, std::memory_order_release);
+      }
+
+    // Removes and returns the element at the start of the queue.  Returns
+    // the null value if the queue is empty.  It may also return the null
+    // value if the queue is not empty, but the first element is being
+    // pushed by another thread.
+    //
+    handle pop()
+      {
+        for ( ; ; )
+          {
+            std::uint64_t hd = head.load(std::memory_order_acquire);
+            handle h = handle(hd);
+            handle next = link(h).load(std::memory_order_acquire);
+
+            // next might have been read from an element that is no longer
+            // at the head.
+            if (head.load(std::memory_order_acquire) != hd)
+              continue;
+
+            if (next != null())
+              {
+                if (!head.compare_exchange_weak(
+                       hd, (hd & tag_mask) + tag_one + next,
+                       std::memory_order_acq_rel, std::memory_order_relaxed))
+                  continue;
+
+                if (h != stub)
+                  return(h);
+
+                stub_queued.store(false, std::memory_order_release);
+
+                continue;
+              }
+
+            if (h == stub)
+              return(null());
+
+            if (tail.load(std::memory_order_acquire) != h)
+              // A push is in progress, that will link h to the next
+              // element.
+              return(null());
+
+            // h is the only element.  Push the stub after it, so it can
+            // be popped.  If the stub is already queued, it is being
+            // popped by another thread.
+            if (!stub_queued.exchange(true, std::memory_order_acq_rel))
+              push(stub);
+          }
+      }
+
+    // Returns true if the queue was empty at some point during the call.
+    //
+    bool empty()
+      {
+        handle h = handle(head.load(std::memory_order_acquire));
+
+        return(
+          (h == stub) and
+          (link(h).load(std::memory_order_acquire) == null()));
+      }
+
+  private:
+
+    static const std::uint64_t tag_one = std::uint64_t(1) << 32;
+    static const std::uint64_t tag_mask = ~(tag_one - 1);
+
+    const handle stub;
+
+    // Handle in the low 32 bits, tag in the high 32 bits.
+    std::atomic<std::uint64_t> head;
+
+    std::atomic<handle> tail;
+
+    // True if the stub is in the queue, or being pushed.
+    std::atomic<bool> stub_queued;
+
+    std::atomic<handle> & link(handle h) { return(abstractor::link(h)); }
+  };
+
+namespace impl
+{
+
+struct p_queue_abs;
+
+class p_queue_elem
+  {
+  public:
+
+    const p_queue_elem * link() const
+      { return(link_.load(std::memory_order_relaxed)); }
+
+  private:
+
+    std::atomic<p_queue_elem *> link_;
+
+    friend struct impl::p_queue_abs;
+  };
+
+struct p_queue_abs
+  {
+    typedef p_queue_elem *handle;
+
+    static handle null() { return(nullptr); }
+
+    static std::atomic<handle> & link(handle h) { return(h->link_); }
+  };
+
+} // end namespace impl
+
+class p_mpsc_queue : public mpsc_queue<impl::p_queue_abs>
+  {
+  public:
+
+    typedef impl::p_queue_elem elem;
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
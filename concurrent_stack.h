@@ -0,0 +1,299 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_CONCURRENT_STACK_H_
+#define ABSTRACT_CONTAINER_CONCURRENT_STACK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "concurrent_queue.h"
+
+namespace abstract_container
+{
+
+// Lock-free intrusive LIFO containers, for task scheduling.  The
+// abstractor parameter class has the same requirements as for the queues
+// in concurrent_queue.h .  As for the queues, the handles of treiber_stack
+// must be unsigned integers of no more than 32 bits, and the memory of a
+// popped element must not be freed while other threads may be using the
+// container.
+//
+// Both containers have make_detached() and is_detached(), as list and
+// bidir_list do.  They use the element's link, so with index handles the
+// link values must be able to hold every handle.
+
+// Stack (Treiber's algorithm) that can be used by any number of threads.
+// The top of the stack is a handle and a 32-bit tag, changed together by
+// a single atomic operation.  The tag is incremented by every change,
+// and prevents ABA errors (unless a pop is delayed for exactly 2 ** 32
+// changes by other threads).
+//
+template <class abstractor>
+class treiber_stack : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::handle handle;
+
+    static_assert(
+      std::is_integral<handle>::value and std::is_unsigned<handle>::value and
+        (sizeof(handle) <= 4),
+      "treiber_stack handles must be unsigned integers of 32 bits or less");
+
+    typedef list<atomic_link_list_abs<abstractor> > list_type;
+
+    static handle null() { return(abstractor::null()); }
+
+    treiber_stack() : top(null()) { }
+
+    treiber_stack(const treiber_stack &) = delete;
+
+    treiber_stack & operator = (const treiber_stack &) = delete;
+
+    // Put the specied element (which must not be part of any container)
+    // into a state that it can only be in when not in any container.
+    //
+    void make_detached(handle h)
+      { link(h).store(h, std::memory_order_relaxed); }
+
+    // Returns true if make_detach() was called for the specified element,
+    // and it has not since been put in any container.
+    //
+    bool is_detached(handle h)
+      { return(link(h).load(std::memory_order_relaxed) == h); }
+
+    void push(handle h)
+      {
+        std::uint64_t t = top.load(std::memory_order_relaxed);
+
+        do
+          link(h).store(handle(t), std::memory_order_relaxed);
+        while (!top.compare_exchange_weak(
+                  t, (t & tag_mask) + tag_one + h, std::memory_order_release,
+                  std::memory_order_relaxed));
+      }
+
+    // Removes and returns the top element.  Returns the null value if the
+    // stack is empty.
+    //
+    handle pop()
+      {
+        std::uint64_t t = top.load(std::memory_order_acquire);
+
+        for ( ; ; )
+          {
+            handle h = handle(t);
+
+            if (h == null())
+              return(null());
+
+            // If h is no longer the top, the value is not used, because the
+            // tag has changed.
+            handle next = link(h).load(std::memory_order_relaxed);
+
+            if (top.compare_exchange_weak(
+                  t, (t & tag_mask) + tag_one + next,
+                  std::memory_order_acquire, std::memory_order_acquire))
+              return(h);
+          }
+      }
+
+    // Removes all the elements, and pushes them at the end (the reverse
+    // direction) of to, from the top of the stack down.  Linear.
+    //
+    void pop_all(list_type &to)
+      {
+        std::uint64_t t = top.load(std::memory_order_relaxed);
+
+        while (!top.compare_exchange_weak(
+                  t, (t & tag_mask) + tag_one + null(),
+                  std::memory_order_acquire, std::memory_order_relaxed))
+          ;
+
+        for (handle h = handle(t); h != null(); )
+          {
+            handle next = link(h).load(std::memory_order_relaxed);
+
+            to.template push<reverse>(h);
+            h = next;
+          }
+      }
+
+    // Returns true if the stack was empty at some point during the call.
+    //
+    bool empty()
+      { return(handle(top.load(std::memory_order_acquire)) == null()); }
+
+  private:
+
+    static const std::uint64_t tag_one = std::uint64_t(1) << 32;
+    static const std::uint64_t tag_mask = ~(tag_one - 1);
+
+    // Handle in the low 32 bits, tag in the high 32 bits.
+    std::atomic<std::uint64_t> top;
+
+    std::atomic<handle> & link(handle h) { return(abstractor::link(h)); }
+  };
+
+// Work-stealing deque (the Chase-Lev algorithm, with the memory orders
+// of Le, Pop, Cohen and Zappa Nardelli).  One thread, the owner, pushes
+// and pops elements at the bottom (LIFO).  Any other thread can steal
+// elements from the top (FIFO).  The handles of the elements in the deque
+// are kept in an array (a member) of 2 ** log2_capacity entries, so the
+// deque does no allocation.
+//
+template <class abstractor, unsigned log2_capacity = 10>
+class work_stealing_deque : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::handle handle;
+
+    static const std::size_t capacity = std::size_t(1) << log2_capacity;
+
+    static handle null() { return(abstractor::null()); }
+
+    work_stealing_deque() : top(0), bottom(0) { }
+
+    work_stealing_deque(const work_stealing_deque &) = delete;
+
+    work_stealing_deque & operator = (const work_stealing_deque &) = delete;
+
+    // Same as for treiber_stack.  The link of an element is set to the
+    // null value when it is pushed (otherwise the deque does not use it).
+    //
+    void make_detached(handle h)
+      { abstractor::link(h).store(h, std::memory_order_relaxed); }
+
+    bool is_detached(handle h)
+      { return(abstractor::link(h).load(std::memory_order_relaxed) == h); }
+
+    // Pushes an element at the bottom.  Returns false (and does not push
+    // it) if the deque is full.  Only called by the owner.
+    //
+    bool push(handle h)
+      {
+        std::ptrdiff_t b = bottom.load(std::memory_order_relaxed);
+        std::ptrdiff_t t = top.load(std::memory_order_acquire);
+
+        if ((b - t) >= std::ptrdiff_t(capacity))
+          return(false);
+
+        abstractor::link(h).store(null(), std::memory_order_relaxed);
+
+        slot(b).store(h, std::memory_order_relaxed);
+
+        bottom.store(b + 1, std::memory_order_release);
+
+        return(true);
+      }
+
+    // Removes and returns the bottom element.  Returns the null value if
+    // the deque is empty.  Only called by the owner.
+    //
+    handle pop()
+      {
+        std::ptrdiff_t b = bottom.load(std::memory_order_relaxed) - 1;
+
+        bottom.store(b, std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::ptrdiff_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+          {
+            // Empty.
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return(null());
+          }
+
+        handle h = slot(b).load(std::memory_order_relaxed);
+
+        if (t == b)
+          {
+            // The last element.  Race with thieves for it.
+            if (!top.compare_exchange_strong(
+                   t, t + 1, std::memory_order_seq_cst,
+                   std::memory_order_relaxed))
+              h = null();
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+          }
+
+        return(h);
+      }
+
+    // Removes and returns the top element.  Returns the null value if the
+    // deque is empty, or if another thread removed the top element first.
+    // Called by any thread other than the owner.
+    //
+    handle steal()
+      {
+        std::ptrdiff_t t = top.load(std::memory_order_acquire);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::ptrdiff_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+          return(null());
+
+        handle h = slot(t).load(std::memory_order_relaxed);
+
+        if (!top.compare_exchange_strong(
+               t, t + 1, std::memory_order_seq_cst,
+               std::memory_order_relaxed))
+          return(null());
+
+        return(h);
+      }
+
+    // Returns the number of elements at some point during the call.
+    //
+    std::size_t size()
+      {
+        std::ptrdiff_t b = bottom.load(std::memory_order_acquire);
+        std::ptrdiff_t t = top.load(std::memory_order_acquire);
+
+        return(b > t ? std::size_t(b - t) : 0);
+      }
+
+    bool empty() { return(size() == 0); }
+
+  private:
+
+    // Stolen from, so in its own cache line.
+    alignas(64) std::atomic<std::ptrdiff_t> top;
+
+    alignas(64) std::atomic<std::ptrdiff_t> bottom;
+
+    std::atomic<handle> buf[capacity];
+
+    std::atomic<handle> & slot(std::ptrdiff_t i)
+      { return(buf[std::size_t(i) & (capacity - 1)]); }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
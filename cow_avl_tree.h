@@ -0,0 +1,549 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_COW_AVL_TREE_H_
+#define ABSTRACT_CONTAINER_COW_AVL_TREE_H_
+
+#include <atomic>
+#include <type_traits>
+
+#include "avl_tree.h"
+
+namespace abstract_container
+{
+
+// AVL tree that one writer thread changes while other threads read it,
+// with no locks.  Nodes that are in the tree are never changed.  Instead,
+// insert() and remove() copy the nodes on the path from the root to the
+// node inserted or removed (and the few other nodes that are rotated),
+// change the copies, and then publish the new root atomically.  Each
+// change makes a new version of the tree, with a new epoch number.  A
+// reader takes a snapshot of one version, which it can search and
+// iterate through for as long as it likes, no matter how many changes
+// the writer makes meanwhile.
+//
+// abstractor parameter class must have these public members, or
+// equivalents:
+//
+// Types, and member functions for the links, balance factor and keys of
+// the nodes -- as for base_avl_tree (see avl_tree.h).  handle must be
+// trivially copyable.  The abstractor may have subtree sizes, or
+// update(), as for base_avl_tree, but not parent links.  It must have a
+// has_read_error static data member that is false.  The abstractor is
+// copied into each snapshot.
+//
+// handle copy_node(handle h) -- returns a new node (for example, from a
+//   node_pool, see node_pool.h), with the same key and other contents as
+//   the node h.  Its links, balance factor and subtree size (if any) are
+//   set by the tree.
+// void retire(handle h, unsigned long epoch) -- the node h is not in
+//   versions of the tree with epoch number epoch or later.  It can be
+//   reclaimed (reused, or returned to its pool) when oldest_epoch() is
+//   not less than epoch.
+// static const unsigned max_readers -- the number of reader slots (see
+//   read_guard below).
+//
+// insert(), remove() and purge() must be called by one thread at a time.
+// The abstractor member functions (other than copy_node() and retire())
+// may be called by readers and the writer concurrently.  Each thread
+// that reads concurrently needs its own reader slot (in the range 0 to
+// max_readers - 1).  A reader slot may only be used by one thread at a
+// time.
+//
+template <class abstractor, unsigned max_depth = 32>
+class cow_avl_tree : protected abstractor
+  {
+  public:
+
+    typedef typename abstractor::key key;
+    typedef typename abstractor::handle handle;
+
+    // The type of a snapshot of the tree.
+    typedef avl_tree<abstractor, max_depth> tree_type;
+
+    static const unsigned max_readers = abstractor::max_readers;
+
+    static_assert(
+      !impl::avl_has_parent<abstractor>::value,
+      "nodes shared by versions of the tree cannot have parent links");
+
+    static_assert(
+      !impl::avl_may_read_error<abstractor>::value,
+      "has_read_error must be false");
+
+    cow_avl_tree() : root_(null()), epoch_(1)
+      {
+        for (unsigned i = 0; i < max_readers; ++i)
+          reader[i].epoch.store(0, std::memory_order_relaxed);
+      }
+
+    cow_avl_tree(const cow_avl_tree &) = delete;
+
+    cow_avl_tree & operator = (const cow_avl_tree &) = delete;
+
+    static handle null() { return(abstractor::null()); }
+
+    // Takes a snapshot of the current version of the tree, for the
+    // lifetime of the object.  The nodes of the version cannot be
+    // reclaimed while the object exists.
+    //
+    class read_guard
+      {
+      public:
+
+        read_guard(cow_avl_tree &t, unsigned reader_slot)
+          : st(t.reader[reader_slot].epoch)
+          {
+            st.store(
+              t.epoch_.load(std::memory_order_acquire),
+              std::memory_order_relaxed);
+
+            // The store to the slot must be visible to oldest_epoch()
+            // before the root is loaded.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            root_ = t.root_.load(std::memory_order_acquire);
+            snap.attach(t, root_);
+          }
+
+        ~read_guard() { st.store(0, std::memory_order_release); }
+
+        read_guard(const read_guard &) = delete;
+
+        read_guard & operator = (const read_guard &) = delete;
+
+        // The snapshot.  Only its member functions that do not change
+        // the tree (such as search(), and its iterators) may be used.
+        tree_type & tree() { return(snap); }
+
+        // The root of the snapshot, for searches that descend the tree
+        // directly.
+        handle root() { return(root_); }
+
+      private:
+
+        class snapshot : public tree_type
+          {
+          public:
+
+            void attach(const abstractor &a, handle root)
+              {
+                static_cast<abstractor &>(this->abs) = a;
+                this->abs.root = root;
+              }
+          };
+
+        std::atomic<unsigned long> &st;
+
+        handle root_;
+
+        snapshot snap;
+      };
+
+    // Inserts the node h, and returns h.  If a node with the same key is
+    // already in the tree, h is not inserted, and that node is returned.
+    //
+    handle insert(handle h)
+      {
+        handle found = null();
+        bool grew;
+
+        next_epoch = epoch_.load(std::memory_order_relaxed) + 1;
+
+        handle r =
+          insert_sub(root_.load(std::memory_order_relaxed), h, found, grew);
+
+        if (found != null())
+          return(found);
+
+        publish(r);
+
+        return(h);
+      }
+
+    // Removes the node with key k, and returns its handle (or null if
+    // there is no such node).  The removed node is retired (it cannot be
+    // reclaimed until readers that may be using it are done).
+    //
+    handle remove(key k)
+      {
+        handle found = null();
+        bool shrank;
+
+        next_epoch = epoch_.load(std::memory_order_relaxed) + 1;
+
+        handle r =
+          remove_sub(root_.load(std::memory_order_relaxed), k, found, shrank);
+
+        if (found != null())
+          publish(r);
+
+        return(found);
+      }
+
+    // Makes the tree empty.  The nodes in it are not retired.  They can be
+    // reclaimed when the value returned by oldest_epoch() is not less than
+    // the value returned by epoch() after purge() returns.
+    //
+    void purge()
+      {
+        next_epoch = epoch_.load(std::memory_order_relaxed) + 1;
+
+        publish(null());
+      }
+
+    bool is_empty()
+      { return(root_.load(std::memory_order_acquire) == null()); }
+
+    // The epoch number of the current version.
+    unsigned long epoch() { return(epoch_.load(std::memory_order_acquire)); }
+
+    // Returns the oldest epoch number of any version that a read_guard
+    // may be using.  Must not be called by a thread that has a live
+    // read_guard.
+    //
+    unsigned long oldest_epoch()
+      {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        unsigned long oldest = epoch_.load(std::memory_order_relaxed);
+
+        for (unsigned i = 0; i < max_readers; ++i)
+          {
+            unsigned long e = reader[i].epoch.load(std::memory_order_acquire);
+
+            if ((e != 0) and (e < oldest))
+              oldest = e;
+          }
+
+        return(oldest);
+      }
+
+  private:
+
+    // Pad to avoid false sharing.  epoch is 0 if the slot is not in use,
+    // otherwise the epoch number of the version it may be using (or an
+    // older one).
+    struct alignas(64) reader_
+      {
+        std::atomic<unsigned long> epoch;
+      };
+
+    std::atomic<handle> root_;
+
+    std::atomic<unsigned long> epoch_;
+
+    reader_ reader[max_readers];
+
+    // Epoch number of the version being made by the writer.
+    unsigned long next_epoch;
+
+    typedef std::integral_constant<
+      bool, impl::avl_has_size<abstractor>::value> subtree_sizes_t;
+
+    typedef std::integral_constant<
+      bool, impl::avl_has_update<abstractor>::value> augmented_t;
+
+    handle child(handle h, bool greater)
+      {
+        return(
+          greater ? abstractor::get_greater(h, true) :
+                    abstractor::get_less(h, true));
+      }
+
+    void set_child(handle h, bool greater, handle c)
+      {
+        if (greater)
+          abstractor::set_greater(h, c);
+        else
+          abstractor::set_less(h, c);
+      }
+
+    int get_bf(handle h) { return(abstractor::get_balance_factor(h)); }
+    void set_bf(handle h, int bf) { abstractor::set_balance_factor(h, bf); }
+
+    // Recalculate the subtree size (if any) of h, and then call update()
+    // (if the abstractor has it) for h.
+    void fix(handle h)
+      {
+        fix(h, subtree_sizes_t());
+        update(h, augmented_t());
+      }
+    void fix(handle, std::false_type) { }
+    void fix(handle h, std::true_type)
+      {
+        handle l = child(h, false), g = child(h, true);
+
+        abstractor::set_size(
+          h,
+          1 + (l == null() ? 0 : abstractor::get_size(l)) +
+            (g == null() ? 0 : abstractor::get_size(g)));
+      }
+    void update(handle, std::false_type) { }
+    void update(handle h, std::true_type) { abstractor::update(h); }
+
+    // Returns a copy of h (with the same children and balance factor),
+    // and retires h.
+    handle copy(handle h)
+      {
+        handle c = abstractor::copy_node(h);
+
+        set_child(c, false, child(h, false));
+        set_child(c, true, child(h, true));
+        set_bf(c, get_bf(h));
+        abstractor::retire(h, next_epoch);
+
+        return(c);
+      }
+
+    // Makes the subtree with root r the new version.
+    void publish(handle r)
+      {
+        // Release so that readers that see the new root see the new
+        // nodes.
+        root_.store(r, std::memory_order_release);
+        epoch_.store(next_epoch, std::memory_order_release);
+      }
+
+    // Rebalances the subtree with root t (a copy, whose balance factor is
+    // 2 or -2), and returns its new root.  If deep_is_copy is false, the
+    // child of t on the deeper side, and the grandchild that is rotated
+    // up (if any), are in the current version, so they are copied
+    // before they are changed.
+    handle rotate(handle t, bool deep_is_copy)
+      {
+        bool gt = get_bf(t) > 0;
+        int s = gt ? 1 : -1;
+        handle d = child(t, gt);
+
+        if (!deep_is_copy)
+          d = copy(d);
+
+        if (get_bf(d) == -s)
+          {
+            // Double rotation.
+            handle g = child(d, !gt);
+
+            if (!deep_is_copy)
+              g = copy(g);
+
+            set_child(t, gt, child(g, !gt));
+            set_child(d, !gt, child(g, gt));
+            set_child(g, !gt, t);
+            set_child(g, gt, d);
+
+            int g_bf = get_bf(g);
+
+            set_bf(t, g_bf == s ? -s : 0);
+            set_bf(d, g_bf == -s ? s : 0);
+            set_bf(g, 0);
+            fix(t);
+            fix(d);
+            fix(g);
+
+            return(g);
+          }
+
+        // Single rotation.
+        set_child(t, gt, child(d, !gt));
+        set_child(d, !gt, t);
+        if (get_bf(d) == 0)
+          {
+            set_bf(t, s);
+            set_bf(d, -s);
+          }
+        else
+          {
+            set_bf(t, 0);
+            set_bf(d, 0);
+          }
+        fix(t);
+        fix(d);
+
+        return(d);
+      }
+
+    // Inserts h into the subtree with root t, and returns the root of the
+    // new subtree.  Sets grew to true if the new subtree is deeper.  If a
+    // node with the same key as h is in the subtree, sets found to it,
+    // and nothing is copied.
+    handle insert_sub(handle t, handle h, handle &found, bool &grew)
+      {
+        if (t == null())
+          {
+            set_child(h, false, null());
+            set_child(h, true, null());
+            set_bf(h, 0);
+            fix(h);
+            grew = true;
+            return(h);
+          }
+
+        int cmp = abstractor::compare_node_node(h, t);
+
+        if (cmp == 0)
+          {
+            found = t;
+            return(t);
+          }
+
+        bool gt = cmp > 0;
+        handle c = insert_sub(child(t, gt), h, found, grew);
+
+        if (found != null())
+          return(t);
+
+        t = copy(t);
+        set_child(t, gt, c);
+
+        if (grew)
+          {
+            int bf = get_bf(t) + (gt ? 1 : -1);
+
+            set_bf(t, bf);
+            if (bf == 0)
+              grew = false;
+            else if ((bf == 2) or (bf == -2))
+              {
+                // The deeper child, and its child in the path, are
+                // copies.
+                grew = false;
+                return(rotate(t, true));
+              }
+          }
+
+        fix(t);
+
+        return(t);
+      }
+
+    // t is a copy whose subtree on the side given by gt is one less deep
+    // than before.  Fixes the balance factor of t (rebalancing if needed),
+    // and returns the root of the subtree.  Sets shrank to true if the
+    // subtree is less deep than before.
+    handle shrunk(handle t, bool gt, bool &shrank)
+      {
+        int bf = get_bf(t) + (gt ? -1 : 1);
+
+        if ((bf == 2) or (bf == -2))
+          {
+            set_bf(t, bf);
+
+            // The single rotation does not make the subtree less deep if
+            // the deeper child is balanced.
+            shrank = get_bf(child(t, !gt)) != 0;
+
+            return(rotate(t, false));
+          }
+
+        set_bf(t, bf);
+        shrank = bf == 0;
+        fix(t);
+
+        return(t);
+      }
+
+    // Removes the least node from the (non-empty) subtree t, and puts its
+    // handle in least.  Returns the root of the new subtree.
+    handle remove_least(handle t, handle &least, bool &shrank)
+      {
+        handle l = child(t, false);
+
+        if (l == null())
+          {
+            least = t;
+            shrank = true;
+            return(child(t, true));
+          }
+
+        l = remove_least(l, least, shrank);
+        t = copy(t);
+        set_child(t, false, l);
+
+        if (shrank)
+          return(shrunk(t, false, shrank));
+
+        fix(t);
+
+        return(t);
+      }
+
+    // Removes the node with key k (if any) from the subtree t, and
+    // returns the root of the new subtree.  Sets found to the removed
+    // node.  If there is no node with key k, nothing is copied.
+    handle remove_sub(handle t, key k, handle &found, bool &shrank)
+      {
+        if (t == null())
+          return(t);
+
+        int cmp = abstractor::compare_key_node(k, t);
+
+        if (cmp == 0)
+          {
+            found = t;
+            abstractor::retire(t, next_epoch);
+
+            handle l = child(t, false), g = child(t, true);
+
+            shrank = true;
+            if (l == null())
+              return(g);
+            if (g == null())
+              return(l);
+
+            // Replace t with a copy of the least node in its greater
+            // subtree.
+            handle least;
+
+            g = remove_least(g, least, shrank);
+            handle m = copy(least);
+            set_child(m, false, l);
+            set_child(m, true, g);
+            set_bf(m, get_bf(t));
+
+            if (shrank)
+              return(shrunk(m, true, shrank));
+
+            fix(m);
+
+            return(m);
+          }
+
+        bool gt = cmp > 0;
+        handle c = remove_sub(child(t, gt), k, found, shrank);
+
+        if (found == null())
+          return(t);
+
+        t = copy(t);
+        set_child(t, gt, c);
+
+        if (shrank)
+          return(shrunk(t, gt, shrank));
+
+        fix(t);
+
+        return(t);
+      }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
@@ -0,0 +1,284 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_HASH_FUNCTIONS_H_
+#define ABSTRACT_CONTAINER_HASH_FUNCTIONS_H_
+
+// Hash functions for use in the hash_key() and hash_elem() members of
+// hash table abstractors.  For example:
+//
+//   index hash_key(key k)
+//     { return(reduce_range64(mix64(k), num_hash_values)); }
+//
+// or, for a struct key:
+//
+//   index hash_key(const key &k)
+//     { return(reduce_range32(crc32c_hash<key>()(k), num_hash_values)); }
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// CRC32C uses the SSE4.2 crc32 instruction (if compiling with -msse4.2 or
+// an -march that has it), or the ARMv8 CRC32 instructions (if compiling
+// with +crc), unless ABSTRACT_CONTAINER_NO_HW_CRC is defined.  Otherwise,
+// it uses slice-by-8 table lookup.
+
+#if !defined(ABSTRACT_CONTAINER_NO_HW_CRC) and defined(__SSE4_2__)
+
+#include <nmmintrin.h>
+#define ABSTRACT_CONTAINER_CRC32C_SSE42_ 1
+
+#elif !defined(ABSTRACT_CONTAINER_NO_HW_CRC) and \
+      defined(__ARM_FEATURE_CRC32)
+
+#include <arm_acle.h>
+#define ABSTRACT_CONTAINER_CRC32C_ARM_ 1
+
+#endif
+
+namespace abstract_container
+{
+
+namespace impl
+{
+
+// Lookup tables for slice-by-8 CRC32C.  Entry t[0][b] is the CRC of the
+// byte b.  t[k][b] is the CRC of the byte b followed by k zero bytes.
+//
+class crc32c_tables
+  {
+  public:
+
+    // Reversed Castagnoli polynomial.
+    static const std::uint32_t poly = 0x82f63b78;
+
+    std::uint32_t t[8][256];
+
+    crc32c_tables()
+      {
+        for (unsigned b = 0; b < 256; ++b)
+          {
+            std::uint32_t c = b;
+
+            for (unsigned i = 0; i < 8; ++i)
+              c = (c >> 1) ^ ((c & 1) ? poly : 0);
+
+            t[0][b] = c;
+          }
+
+        for (unsigned k = 1; k < 8; ++k)
+          for (unsigned b = 0; b < 256; ++b)
+            t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+      }
+  };
+
+inline const crc32c_tables & crc32c_table()
+  {
+    static const crc32c_tables tbl;
+
+    return(tbl);
+  }
+
+// Software CRC32C.  state is the CRC register (not inverted).  Does not
+// depend on the byte order of the CPU.
+//
+inline std::uint32_t crc32c_sw(
+  std::uint32_t state, const unsigned char *p, std::size_t len)
+  {
+    const std::uint32_t (&t)[8][256] = crc32c_table().t;
+
+    while (len >= 8)
+      {
+        state ^=
+          std::uint32_t(p[0]) | (std::uint32_t(p[1]) << 8) |
+          (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[3]) << 24);
+
+        state =
+          t[7][state & 0xff] ^ t[6][(state >> 8) & 0xff] ^
+          t[5][(state >> 16) & 0xff] ^ t[4][state >> 24] ^
+          t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+
+        p += 8;
+        len -= 8;
+      }
+
+    for ( ; len; --len)
+      state = (state >> 8) ^ t[0][(state ^ *p++) & 0xff];
+
+    return(state);
+  }
+
+#if defined(ABSTRACT_CONTAINER_CRC32C_SSE42_) or \
+    defined(ABSTRACT_CONTAINER_CRC32C_ARM_)
+
+// Hardware CRC32C.  Same parameters as crc32c_sw().
+//
+inline std::uint32_t crc32c_hw(
+  std::uint32_t state, const unsigned char *p, std::size_t len)
+  {
+    #if defined(ABSTRACT_CONTAINER_CRC32C_SSE42_) and defined(__x86_64__)
+
+    for ( ; len >= 8; p += 8, len -= 8)
+      {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        state = std::uint32_t(_mm_crc32_u64(state, v));
+      }
+
+    #elif defined(ABSTRACT_CONTAINER_CRC32C_SSE42_)
+
+    for ( ; len >= 4; p += 4, len -= 4)
+      {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        state = _mm_crc32_u32(state, v);
+      }
+
+    #else
+
+    for ( ; len >= 8; p += 8, len -= 8)
+      {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        state = __crc32cd(state, v);
+      }
+
+    #endif
+
+    for ( ; len; --len)
+      {
+        #if defined(ABSTRACT_CONTAINER_CRC32C_SSE42_)
+        state = _mm_crc32_u8(state, *p++);
+        #else
+        state = __crc32cb(state, *p++);
+        #endif
+      }
+
+    return(state);
+  }
+
+#endif
+
+// Returns the high 64 bits of the 128-bit product a * b, from 32-bit
+// partial products.
+//
+inline std::uint64_t mul_high64(std::uint64_t a, std::uint64_t b)
+  {
+    const std::uint64_t lo_mask = 0xffffffff;
+
+    std::uint64_t a_lo = a & lo_mask, a_hi = a >> 32;
+    std::uint64_t b_lo = b & lo_mask, b_hi = b >> 32;
+
+    std::uint64_t mid1 = a_hi * b_lo;
+    std::uint64_t mid2 = a_lo * b_hi;
+    std::uint64_t carry =
+      (((a_lo * b_lo) >> 32) + (mid1 & lo_mask) + (mid2 & lo_mask)) >> 32;
+
+    return((a_hi * b_hi) + (mid1 >> 32) + (mid2 >> 32) + carry);
+  }
+
+} // end namespace impl
+
+// Returns the CRC32C (Castagnoli CRC, as used by iSCSI and SSE4.2) of the
+// len bytes at data.  To calculate the CRC of data in pieces, pass the
+// return value for the previous pieces as crc.
+//
+inline std::uint32_t crc32c(
+  const void *data, std::size_t len, std::uint32_t crc = 0)
+  {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+
+    #if defined(ABSTRACT_CONTAINER_CRC32C_SSE42_) or \
+        defined(ABSTRACT_CONTAINER_CRC32C_ARM_)
+    return(~impl::crc32c_hw(~crc, p, len));
+    #else
+    return(~impl::crc32c_sw(~crc, p, len));
+    #endif
+  }
+
+// Mixes the bits of a 64-bit integer, so that each bit of the result
+// depends on every bit of the input.  It is a bijection, so distinct keys
+// never collide before the hash is reduced to a range.  (This is the
+// 64-bit finalizer from MurmurHash3.)
+//
+inline std::uint64_t mix64(std::uint64_t k)
+  {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return(k);
+  }
+
+// Reduces a hash value h to the range 0 to n - 1 without a division, by
+// taking the high half of the product h * n.  Unlike h % n, the result
+// depends mostly on the high bits of h, so h should have well-mixed high
+// bits (as the results of mix64() and crc32c() do).
+//
+inline std::uint32_t reduce_range32(std::uint32_t h, std::uint32_t n)
+  {
+    return(std::uint32_t((std::uint64_t(h) * n) >> 32));
+  }
+
+inline std::uint64_t reduce_range64(std::uint64_t h, std::uint64_t n)
+  {
+    #if defined(__SIZEOF_INT128__)
+
+    __extension__ typedef unsigned __int128 uint128;
+
+    return(std::uint64_t((uint128(h) * n) >> 64));
+
+    #else
+
+    return(impl::mul_high64(h, n));
+
+    #endif
+  }
+
+// Hash functor for integral keys (of up to 64 bits).
+//
+class mix64_hash
+  {
+  public:
+
+    template <typename key>
+    std::uint64_t operator () (key k) const
+      { return(mix64(std::uint64_t(k))); }
+  };
+
+// Hash functor giving the CRC32C of the bytes of a key.  The key type
+// must be trivially copyable, and have no padding bytes (or have them
+// always set to the same value).
+//
+template <typename key>
+class crc32c_hash
+  {
+  public:
+
+    std::uint32_t operator () (const key &k) const
+      { return(crc32c(&k, sizeof(key))); }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
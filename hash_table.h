@@ -21,19 +21,188 @@ SOFTWARE.
 #ifndef ABSTRACT_CONTAINER_HASH_TABLE_H_
 #define ABSTRACT_CONTAINER_HASH_TABLE_H_
 
+#include "bidir_list.h"
 #include "list.h"
 
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 namespace abstract_container
 {
 
+namespace impl
+{
+
+// hash_has_num_buckets<abstractor>::value is true if the abstractor has
+// a public num_buckets() member function.
+//
+template <class abstractor>
+class hash_has_num_buckets
+  {
+  private:
+
+    template <class A>
+    static char test(decltype(std::declval<A &>().num_buckets()) *);
+
+    template <class A>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<abstractor>(nullptr)) == 1;
+  };
+
+// hash_list_has_remove_forward<list>::value is true if the list class
+// has a remove_forward() member function (as list does, but bidir_list
+// does not).
+//
+template <class list>
+class hash_list_has_remove_forward
+  {
+  private:
+
+    template <class L>
+    static char test(
+      decltype(std::declval<L &>().remove_forward(
+        std::declval<typename L::handle>())) *);
+
+    template <class L>
+    static long test(...);
+
+  public:
+
+    static const bool value = sizeof(test<list>(nullptr)) == 1;
+  };
+
+// Removes the element h from the bucket b.  prev must be the element
+// before h in b, or null if h is the first element.  Uses remove_forward()
+// if the list has it, otherwise remove() (which is constant time for
+// bidir_list).
+//
+template <class list>
+inline void hash_list_unlink(
+  list &b, typename list::handle prev, typename list::handle h,
+  std::true_type)
+  {
+    if (prev == list::null())
+      b.pop();
+    else
+      b.remove_forward(prev);
+
+    (void) h;
+  }
+
+template <class list>
+inline void hash_list_unlink(
+  list &b, typename list::handle, typename list::handle h, std::false_type)
+  { b.remove(h); }
+
+template <class list>
+inline void hash_list_unlink(
+  list &b, typename list::handle prev, typename list::handle h)
+  {
+    hash_list_unlink(
+      b, prev, h,
+      std::integral_constant<
+        bool, hash_list_has_remove_forward<list>::value>());
+  }
+
+// Hint that the memory at the given address will be read soon.
+inline void prefetch_address(const void *p)
+  {
+    #if defined(__GNUC__)
+    __builtin_prefetch(p);
+    #else
+    (void) p;
+    #endif
+  }
+
+} // end namespace impl
+
+// Statistics about a hash table, returned by base_hash_table::stats().
+//
+struct hash_table_stats
+  {
+    // Size of chain_hist.
+    static const unsigned hist_size = 16;
+
+    // Calls to search() plus keys passed to search_many(), and the
+    // is_key() calls they made, since construction or reset_stats().
+    // Always zero unless the stats policy counts them.
+    unsigned long long searches, is_key_calls;
+
+    // Mean is_key() calls per search (zero if no searches).
+    double mean_is_key_calls;
+
+    // From walking the buckets in use.
+    std::size_t num_buckets, num_elems, empty_buckets, max_chain;
+
+    // Mean length of non-empty chains (zero if all are empty).
+    double mean_chain;
+
+    // chain_hist[i] is the number of buckets with a chain of length
+    // i, except the last entry counts all the chains with at least
+    // hist_size - 1 elements.
+    std::size_t chain_hist[hist_size];
+  };
+
+// Stats policy for base_hash_table, that counts nothing.  Adds no code
+// or data to the hash table.
+//
+class hash_no_stats
+  {
+  protected:
+
+    void count_search() { }
+
+    void count_is_key() { }
+
+  public:
+
+    unsigned long long searches() const { return(0); }
+
+    unsigned long long is_key_calls() const { return(0); }
+
+    void reset_stats() { }
+  };
+
+// Stats policy for base_hash_table, that counts searches and the is_key()
+// calls they make.  The counters are not atomic, so concurrent searches
+// of the same table are not safe with this policy.
+//
+class hash_count_stats
+  {
+  protected:
+
+    void count_search() { ++searches_; }
+
+    void count_is_key() { ++is_key_calls_; }
+
+  public:
+
+    unsigned long long searches() const { return(searches_); }
+
+    unsigned long long is_key_calls() const { return(is_key_calls_); }
+
+    void reset_stats() { searches_ = 0; is_key_calls_ = 0; }
+
+  private:
+
+    unsigned long long searches_ = 0, is_key_calls_ = 0;
+  };
+
 // Base abstract hash table template.
 //
 // abstractor parameter class must have these public members, or equivalents:
 //
 // Types:
 //
-// list -- normally an instantiation of the abstract_container::list type.
-//   Must have the members handle, start, push, remove, link, null, purge.
+// list -- normally an instantiation of the abstract_container::list or
+//   abstract_container::bidir_list type.  Must have the members handle,
+//   start, push, remove, link, null, purge.  If it has remove_forward
+//   (as list does), it must also have pop.
 // index -- an integral type.
 // key -- some copyable type.
 //
@@ -56,8 +225,23 @@ namespace abstract_container
 // static const index num_hash_values -- the maximum number of hash values
 //   of keys (with zero being the minimum).
 //
-template <class abstractor>
-class base_hash_table : protected abstractor
+// Optional public member function:
+//
+// index num_buckets() -- if present, only the buckets for hash values
+//   less than the returned value are in use.  purge() and iter only visit
+//   those buckets.
+//
+// Optional member function (public or protected):
+//
+// void prefetch(handle) -- if present, a hint that the element associated
+//   with the (non-null) handle will be accessed soon.  Only called by
+//   search_many().
+//
+// The stats_policy parameter class is hash_no_stats (the default) or
+// hash_count_stats, or a class with the same members.
+//
+template <class abstractor, class stats_policy = hash_no_stats>
+class base_hash_table : protected abstractor, public stats_policy
   {
   protected:
 
@@ -96,7 +280,9 @@ class base_hash_table : protected abstractor
         list &b = bucket(hash_value);
         handle h = b.start();
 
-        while ((h != null()) and !is_key(k, h))
+        stats_policy::count_search();
+
+        while ((h != null()) and !counted_is_key(k, h))
           h = b.link(h);
 
         return(h);
@@ -104,6 +290,65 @@ class base_hash_table : protected abstractor
 
     handle search(key k) { return(search(k, hash_key(k))); }
 
+    // For each i from 0 to n - 1, sets out[i] to search(k[i]).  The
+    // searches are done in lock-step, in groups.  All the hash values in
+    // a group are calculated first, and the bucket heads prefetched, so
+    // that the memory accesses for different keys overlap.
+    void search_many(const key *k, std::size_t n, handle *out)
+      {
+        index hv[search_lanes];
+        handle h[search_lanes];
+
+        // Indexes of searches not yet finished.
+        unsigned live[search_lanes];
+
+        while (n != 0)
+          {
+            const unsigned num =
+              n < search_lanes ? unsigned(n) : search_lanes;
+            unsigned num_live = num;
+
+            for (unsigned i = 0; i < num; ++i)
+              {
+                hv[i] = hash_key(k[i]);
+                impl::prefetch_address(&bucket(hv[i]));
+              }
+
+            for (unsigned i = 0; i < num; ++i)
+              {
+                h[i] = bucket(hv[i]).start();
+                prefetch_elem(h[i]);
+                live[i] = i;
+                stats_policy::count_search();
+              }
+
+            while (num_live != 0)
+              {
+                unsigned j = 0;
+
+                for (unsigned l = 0; l < num_live; ++l)
+                  {
+                    unsigned i = live[l];
+
+                    if ((h[i] == null()) or counted_is_key(k[i], h[i]))
+                      out[i] = h[i];
+                    else
+                      {
+                        h[i] = bucket(hv[i]).link(h[i]);
+                        prefetch_elem(h[i]);
+                        live[j++] = i;
+                      }
+                  }
+
+                num_live = j;
+              }
+
+            k += num;
+            out += num;
+            n -= num;
+          }
+      }
+
     // Returns the handle of the removed element, or null() is no element
     // has key k.
     handle remove_key(key k)
@@ -119,27 +364,80 @@ class base_hash_table : protected abstractor
           }
 
         if (h != null())
-          {
-            if (h_last == null())
-              b.pop();
-            else
-              b.remove_forward(h_last);
-          }
+          impl::hash_list_unlink(b, h_last, h);
 
         return(h);
       }
 
+    // Linear in the length of the chain if the list is a list (to find
+    // the element before h), constant time if it is a bidir_list.
     void remove(handle h) { bucket(hash_elem(h)).remove(h); }
 
     // Make the hash table empty.
     void purge()
       {
-        for (index i = 0; i < num_hash_values; ++i)
+        index nb = num_buckets();
+
+        for (index i = 0; i < nb; ++i)
           bucket(i).purge();
       }
 
+    // Returns the number of buckets in use.
+    index num_buckets()
+      {
+        return(
+          num_buckets(
+            std::integral_constant<
+              bool, impl::hash_has_num_buckets<abstractor>::value>()));
+      }
+
     static handle null() { return(list::null()); }
 
+    // Walks all the buckets in use to get the chain lengths.  Linear in
+    // the number of buckets plus the number of elements.
+    hash_table_stats stats()
+      {
+        hash_table_stats st;
+
+        st.searches = stats_policy::searches();
+        st.is_key_calls = stats_policy::is_key_calls();
+        st.mean_is_key_calls =
+          st.searches ? double(st.is_key_calls) / double(st.searches) : 0;
+
+        st.num_buckets = num_buckets();
+        st.num_elems = 0;
+        st.max_chain = 0;
+
+        for (unsigned i = 0; i < hash_table_stats::hist_size; ++i)
+          st.chain_hist[i] = 0;
+
+        for (index i = 0; i < index(st.num_buckets); ++i)
+          {
+            list &b = bucket(i);
+            std::size_t len = 0;
+
+            for (handle h = b.start(); h != null(); h = b.link(h))
+              ++len;
+
+            st.num_elems += len;
+
+            if (len > st.max_chain)
+              st.max_chain = len;
+
+            ++st.chain_hist[
+              len < hash_table_stats::hist_size ?
+                len : hash_table_stats::hist_size - 1];
+          }
+
+        st.empty_buckets = st.chain_hist[0];
+
+        std::size_t used = st.num_buckets - st.empty_buckets;
+
+        st.mean_chain = used ? double(st.num_elems) / double(used) : 0;
+
+        return(st);
+      }
+
     // Note:  removing an element invalidates iterators referencing it,
     // but no others.
     //
@@ -168,6 +466,10 @@ class base_hash_table : protected abstractor
 
 	base_hash_table & table() { return(*ht); }
 
+	// Hash value of the bucket of the current element.  Elements in
+	// the same bucket are visited one after another.
+	index hash_value() { return(hv); }
+
 	void operator ++ () { advance(); }
 
 	void operator ++ (int) { ++(*this); }
@@ -190,7 +492,7 @@ class base_hash_table : protected abstractor
 
             while (curr_h == base_hash_table::null())
               {
-                if (++hv >= base_hash_table::num_hash_values)
+                if (++hv >= ht->num_buckets())
                   break;
 
                 curr_h = ht->bucket(hv).start();
@@ -205,6 +507,48 @@ class base_hash_table : protected abstractor
     list & bucket(index hash_value) { return(abstractor::bucket(hash_value)); }
 
     bool is_key(key k, handle h) { return(abstractor::is_key(k, h)); }
+
+  private:
+
+    // Number of searches search_many() does in lock-step.
+    static const unsigned search_lanes = 16;
+
+    bool counted_is_key(key k, handle h)
+      {
+        stats_policy::count_is_key();
+
+        return(is_key(k, h));
+      }
+
+    index num_buckets(std::false_type) { return(num_hash_values); }
+
+    index num_buckets(std::true_type) { return(abstractor::num_buckets()); }
+
+    // The abstractor's prefetch() may be protected, so it's detected
+    // as a member of this class.
+
+    template <class B>
+    static char has_prefetch(
+      decltype(std::declval<B &>().prefetch(std::declval<handle>())) *);
+
+    template <class B>
+    static long has_prefetch(...);
+
+    void prefetch_elem(handle h)
+      {
+        prefetch_elem(
+          h,
+          std::integral_constant<
+            bool, sizeof(has_prefetch<base_hash_table>(nullptr)) == 1>());
+      }
+
+    void prefetch_elem(handle, std::false_type) { }
+
+    void prefetch_elem(handle h, std::true_type)
+      {
+        if (h != null())
+          abstractor::prefetch(h);
+      }
   };
 
 namespace impl
@@ -230,8 +574,298 @@ class hash_table_abs : protected abstractor
 // template, with the additional requirement that the list class must have
 // a parameterless constructor that initialized it to the empty state.
 //
+template <class abstractor, class stats_policy = hash_no_stats>
+using hash_table =
+  base_hash_table<impl::hash_table_abs<abstractor>, stats_policy>;
+
+namespace impl
+{
+
+// Abstractor for base_hash_table whose list type is a bidir_list, using
+// the two links of the elements given by the static member functions of
+// the abstractor parameter class.
+//
+template <class abstractor>
+class bidir_bucket_abs : protected abstractor
+  {
+  private:
+
+    struct list_abs
+      {
+        typedef typename abstractor::handle handle;
+
+        static handle null() { return(bidir_bucket_abs::null()); }
+
+        static handle link(handle h, bool is_forward)
+          { return(bidir_bucket_abs::link(h, is_forward)); }
+
+        static void link(handle h, handle link_h, bool is_forward)
+          { bidir_bucket_abs::link(h, link_h, is_forward); }
+      };
+
+  protected:
+
+    typedef bidir_list<list_abs> list;
+  };
+
+} // end namespace impl
+
+// Hash table whose buckets are bidir_lists, so remove(handle) takes
+// constant time.  The abstractor parameter has the same requirements as
+// for the hash_table template, except that instead of the list type, it
+// must have these members (public or protected):
+//
+// handle -- the handle type of the elements.
+// static handle null() -- returns the null handle value.
+// static handle link(handle h, bool is_forward),
+// static void link(handle h, handle link_h, bool is_forward) -- get and
+//   set the forward or reverse link of the element h, as for the
+//   abstractor of bidir_list.
+//
+template <class abstractor, class stats_policy = hash_no_stats>
+using bidir_hash_table =
+  hash_table<impl::bidir_bucket_abs<abstractor>, stats_policy>;
+
+namespace impl
+{
+
+// Abstractor for base_hash_table that maps hash values onto the buckets
+// in use by a linear hash table.  See base_linear_hash_table.
+//
+template <class abstractor>
+class linear_hash_abs : protected abstractor
+  {
+  protected:
+
+    typedef typename abstractor::list list;
+    typedef typename abstractor::index index;
+    typedef typename abstractor::key key;
+    typedef typename list::handle handle;
+
+    static const index num_hash_values = abstractor::num_hash_values;
+
+    static_assert(
+      (num_hash_values & (num_hash_values - 1)) == 0,
+      "num_hash_values must be a power of 2");
+
+    static_assert(
+      (abstractor::min_buckets & (abstractor::min_buckets - 1)) == 0,
+      "min_buckets must be a power of 2");
+
+    // Bucket index for a (full range) hash value.
+    index address(index hv)
+      {
+        index a = hv & (round_size - 1);
+
+        if (a < next_split)
+          // Bucket has already been split in this round.
+          a = hv & ((round_size << 1) - 1);
+
+        return(a);
+      }
+
+    index hash_key(key k) { return(address(abstractor::hash_key(k))); }
+
+    index hash_elem(handle h) { return(address(abstractor::hash_elem(h))); }
+
+    list & bucket(index i) { return(abstractor::bucket(i)); }
+
+    bool is_key(key k, handle h) { return(abstractor::is_key(k, h)); }
+
+    // Number of elements in the table.
+    index count_;
+
+    // Number of buckets at the start of the current round of splits.
+    index round_size;
+
+    // Next bucket to split, in the range [0, round_size).
+    index next_split;
+
+    void reset()
+      {
+        count_ = 0;
+        round_size = abstractor::min_buckets;
+        next_split = 0;
+      }
+
+    linear_hash_abs() { reset(); }
+
+    // Adds a new bucket at the end by splitting the next bucket.  The
+    // elements of the bucket being split whose hash values now map to
+    // the new bucket are moved to it.  Does nothing if the maximum
+    // number of buckets are in use.
+    void split()
+      {
+        if ((round_size + next_split) >= num_hash_values)
+          return;
+
+        const index new_b = round_size + next_split;
+        const index mask = (round_size << 1) - 1;
+        list &from = bucket(next_split);
+        list &to = bucket(new_b);
+        handle h = from.start();
+        handle prev = list::null();
+
+        while (h != list::null())
+          {
+            handle next = from.link(h);
+
+            if ((abstractor::hash_elem(h) & mask) == new_b)
+              {
+                hash_list_unlink(from, prev, h);
+
+                to.push(h);
+              }
+            else
+              prev = h;
+
+            h = next;
+          }
+
+        if (++next_split == round_size)
+          {
+            round_size <<= 1;
+            next_split = 0;
+          }
+      }
+
+  public:
+
+    index num_buckets() { return(round_size + next_split); }
+  };
+
+// Abstractor that allocates buckets in fixed-size segments, as they are
+// first used.
+//
 template <class abstractor>
-using hash_table = base_hash_table<impl::hash_table_abs<abstractor> >;
+class bucket_segments_abs : protected abstractor
+  {
+  private:
+
+    static const typename abstractor::index seg_size =
+      abstractor::min_buckets;
+
+    std::unique_ptr<typename abstractor::list[]>
+      seg[abstractor::num_hash_values / seg_size];
+
+  protected:
+
+    typename abstractor::list & bucket(typename abstractor::index hash_value)
+      {
+        std::unique_ptr<typename abstractor::list[]> &s =
+          seg[hash_value / seg_size];
+
+        if (!s)
+          s.reset(new typename abstractor::list[seg_size]);
+
+        return(s[hash_value % seg_size]);
+      }
+  };
+
+} // end namespace impl
+
+// Linear hash table.  The number of buckets starts out at a minimum,
+// and grows (up to a maximum), one bucket at a time, as elements are
+// inserted.  Each insert() splits at most one bucket.  So there is never
+// a rehash of the whole table, and the time for an insert() is bounded
+// by the time to move the elements of one bucket.
+//
+// abstractor parameter class has the same requirements as for the
+// base_hash_table template, with these differences:
+//
+// index hash_key(key), index hash_elem(handle) -- return the hash value
+//   over the full range of the index type.  The low bits of the hash
+//   value must be well distributed.  Each insert() may call hash_elem()
+//   for all the elements in one bucket.
+// list & bucket(index) -- will only be called with an index less than
+//   num_buckets().  When the number of buckets grows to include a bucket,
+//   the list for it must be in the empty (purged) state.
+// static const index num_hash_values -- the maximum number of buckets.
+//   Must be a power of 2.
+//
+// Additional static constants:
+//
+// static const index min_buckets -- the initial (and minimum) number
+//   of buckets.  Must be a power of 2.
+// static const index load_factor -- a bucket is split when an insert()
+//   makes the number of elements greater than load_factor times the
+//   number of buckets.
+//
+// Removing elements does not reduce the number of buckets.
+//
+// stats_policy is as for base_hash_table.
+//
+template <class abstractor, class stats_policy = hash_no_stats>
+class base_linear_hash_table
+  : public base_hash_table<impl::linear_hash_abs<abstractor>, stats_policy>
+  {
+  private:
+
+    typedef
+      base_hash_table<impl::linear_hash_abs<abstractor>, stats_policy> base;
+
+  public:
+
+    typedef typename base::index index;
+    typedef typename base::key key;
+    typedef typename base::handle handle;
+
+    // As for base_hash_table, the hash value passed to insert() and
+    // search() must be the value returned by hash_key() or hash_elem().
+    // Since the number of buckets changes, this value can only be
+    // assumed to be valid until the next insert() or purge().
+
+    void insert(handle h, index hash_value)
+      {
+        base::insert(h, hash_value);
+
+        if (++this->count_ > (abstractor::load_factor * this->num_buckets()))
+          this->split();
+      }
+
+    void insert(handle h) { insert(h, this->hash_elem(h)); }
+
+    handle remove_key(key k)
+      {
+        handle h = base::remove_key(k);
+
+        if (h != base::null())
+          --this->count_;
+
+        return(h);
+      }
+
+    void remove(handle h)
+      {
+        base::remove(h);
+
+        --this->count_;
+      }
+
+    // Make the hash table empty, and go back to the minimum number of
+    // buckets.
+    void purge()
+      {
+        base::purge();
+
+        this->reset();
+      }
+
+    // Returns the number of elements in the table.
+    index count() { return(this->count_); }
+  };
+
+// Abstractor parameter has same requirements as for the
+// base_linear_hash_table template, except that it does not have the
+// bucket() member function.  Buckets are allocated with new, in segments
+// of min_buckets buckets, as they come into use.  The list class must
+// have a parameterless constructor that initialized it to the empty
+// state.
+//
+template <class abstractor, class stats_policy = hash_no_stats>
+using linear_hash_table =
+  base_linear_hash_table<
+    impl::bucket_segments_abs<abstractor>, stats_policy>;
 
 } // end namespace abstract_container
 
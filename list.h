@@ -21,6 +21,8 @@ SOFTWARE.
 #ifndef ABSTRACT_CONTAINER_LIST_H_
 #define ABSTRACT_CONTAINER_LIST_H_
 
+#include <type_traits>
+
 namespace abstract_container
 {
 
@@ -69,6 +71,11 @@ class list : protected abstractor
 
     // Note:  all member functions have constant time complexity unless
     // noted as linear.
+    //
+    // Each member function with an is_forward parameter has a version
+    // with the direction as a template parameter instead (for example,
+    // push<reverse>(h) or start<forward>()), whose code has no tests of
+    // the direction.
 
     static handle null() { return(abstractor::null()); }
 
@@ -87,16 +94,10 @@ class list : protected abstractor
     // Linear if direction is reverse.
     //
     handle link(handle h, bool is_forward = true)
-      {
-        if (is_forward)
-          return(abstractor::link(h));
-
-        handle result = null();
-        for (handle h2 = head(); h2 != h; result = h2, h2 = link(h2))
-          ;
+      { return(is_forward ? link<forward>(h) : link<reverse>(h)); }
 
-        return(result);
-      }
+    template <bool is_forward>
+    handle link(handle h) { return(link(h, dir<is_forward>())); }
 
     // Put the specied element (which must not be part of any list) into
     // a state that it can only be in when not in any list.
@@ -108,28 +109,32 @@ class list : protected abstractor
     //
     bool is_detached(handle h) { return(link(h) == h); }
 
-    // FUTURE
-    // list(
-    //   list &to_split, handle first_in_list, handle last_in_list)
+    // Removes the elements from first_in_list to last_in_list (in the
+    // forward direction) from the list to_split, and constructs a list
+    // containing them.  first_in_list may be the same as last_in_list.
+    // Linear, unless first_in_list is the first element of to_split.
+    //
+    list(list &to_split, handle first_in_list, handle last_in_list)
+      {
+        to_split.remove(first_in_list, last_in_list);
+
+        link(last_in_list, null());
+
+        head() = first_in_list;
+
+        if (store_tail)
+          tail() = last_in_list;
+      }
 
     // Returns the handle of first element in the list in the given direction.
     // Returns the null value if the list is empty.  Linear if direction
     // is reverse and store_tail is false.
     //
     handle start(bool is_forward = true)
-      {
-        if (is_forward)
-          return(head());
+      { return(is_forward ? start<forward>() : start<reverse>()); }
 
-        if (store_tail)
-          return(tail());
-
-        handle result = null();
-        for (handle h = head(); h != null(); result = h, h = link(h))
-          ;
-
-        return(result);
-      }
+    template <bool is_forward>
+    handle start() { return(start(dir<is_forward>())); }
 
     // For the element in_list (already in the list), inserts the element
     // to_insert after it in the given direction.  Linear if direction is
@@ -137,7 +142,16 @@ class list : protected abstractor
     //
     void insert(handle in_list, handle to_insert, bool is_forward = true)
       {
-        handle ilf = link(in_list, is_forward);
+        if (is_forward)
+          insert<forward>(in_list, to_insert);
+        else
+          insert<reverse>(in_list, to_insert);
+      }
+
+    template <bool is_forward>
+    void insert(handle in_list, handle to_insert)
+      {
+        handle ilf = link<is_forward>(in_list);
 
         if (!is_forward)
           {
@@ -160,15 +174,49 @@ class list : protected abstractor
           tail() = to_insert;
       }
 
-    #if 0
-    // FUTURE
+    // For the element in_list (already in the list), inserts all the
+    // elements of the list to_insert after it in the given direction.  The
+    // inserted elements are in the same order (in the forward direction)
+    // as they were in to_insert, and to_insert is left empty.  Linear if
+    // direction is reverse, or if store_tail is false.
+    //
     void insert(handle in_list, list &to_insert, bool is_forward = true)
       {
-        if (to_insert.head[forward] == null())
+        if (is_forward)
+          insert<forward>(in_list, to_insert);
+        else
+          insert<reverse>(in_list, to_insert);
+      }
+
+    template <bool is_forward>
+    void insert(handle in_list, list &to_insert)
+      {
+        if (to_insert.empty())
           return;
-        ...
+
+        if (!is_forward)
+          {
+            in_list = link<reverse>(in_list);
+
+            if (in_list == null())
+              {
+                push(to_insert);
+                return;
+              }
+          }
+
+        handle last = to_insert.template start<reverse>();
+        handle ilf = link(in_list);
+
+        link(last, ilf);
+        link(in_list, to_insert.head());
+
+        if ((ilf == null()) and store_tail)
+          // New head in reverse direction.
+          tail() = last;
+
+        to_insert.purge();
       }
-    #endif
 
     // Remorves the next elemment forward from specified element from the list.
     //
@@ -188,8 +236,8 @@ class list : protected abstractor
     //
     void remove(handle in_list)
       {
-        handle f = link(in_list, forward);
-        handle r = link(in_list, reverse);
+        handle f = link(in_list);
+        handle r = link<reverse>(in_list);
 
         if (r == null())
           head() = f;
@@ -200,14 +248,52 @@ class list : protected abstractor
           tail() = r;
       }
 
-    // FUTURE
-    // void remove(handle first_in_list, handle last_in_list))
+    // Removes the elements after in_list in the forward direction, up to
+    // and including last_in_list, from the list.  The links between the
+    // removed elements are not changed.
+    //
+    void remove_forward(handle in_list, handle last_in_list)
+      {
+        handle f = link(last_in_list);
+
+        link(in_list, f);
+
+        if (store_tail and (f == null()))
+          tail() = in_list;
+      }
+
+    // Removes the elements from first_in_list to last_in_list (in the
+    // forward direction, and initially in the list) from the list.  The
+    // links between the removed elements are not changed.  Linear, unless
+    // first_in_list is the first element of the list.
+    //
+    void remove(handle first_in_list, handle last_in_list)
+      {
+        if (head() == first_in_list)
+          {
+            head() = link(last_in_list);
+
+            if (store_tail and (head() == null()))
+              tail() = null();
+          }
+        else
+          remove_forward(link<reverse>(first_in_list), last_in_list);
+      }
 
     // Make the specified element (not initially in the list) the new first
     // element in the list, in the specified direction.  Linear if direction
     // is reverse and tail is not stored.
     //
     void push(handle to_push, bool is_forward = true)
+      {
+        if (is_forward)
+          push<forward>(to_push);
+        else
+          push<reverse>(to_push);
+      }
+
+    template <bool is_forward>
+    void push(handle to_push)
       {
         if (head() == null())
           {
@@ -230,17 +316,60 @@ class list : protected abstractor
         else
           {
             link(to_push, null());
-            link(start(reverse), to_push);
+            link(start<reverse>(), to_push);
           }
       }
 
-    // FUTURE
-    // void push(list &to_push, bool is_forward = true)
+    // Make all the elements of the list to_push the new first elements in
+    // the list, in the specified direction.  The pushed elements are in
+    // the same order (in the forward direction) as they were in to_push,
+    // and to_push is left empty.  Linear if store_tail is false.
+    //
+    void push(list &to_push, bool is_forward = true)
+      {
+        if (is_forward)
+          push<forward>(to_push);
+        else
+          push<reverse>(to_push);
+      }
+
+    template <bool is_forward>
+    void push(list &to_push)
+      {
+        if (to_push.empty())
+          return;
+
+        handle last = to_push.template start<reverse>();
+
+        if (empty())
+          {
+            head() = to_push.head();
+            if (store_tail)
+              tail() = last;
+          }
+        else if (is_forward)
+          {
+            link(last, head());
+            head() = to_push.head();
+          }
+        else
+          {
+            link(start<reverse>(), to_push.head());
+            if (store_tail)
+              tail() = last;
+          }
+
+        to_push.purge();
+      }
 
     // Removes and returns the first element (in the given direction) in the
     // list.  Linear if direction is reverse.
     //
     handle pop(bool is_forward = true)
+      { return(is_forward ? pop<forward>() : pop<reverse>()); }
+
+    template <bool is_forward>
+    handle pop()
       {
         handle p = head();
         handle f = link(p);
@@ -295,6 +424,34 @@ class list : protected abstractor
 
     void link(handle h, handle link_h) { abstractor::link(h, link_h); }
 
+    template <bool is_forward>
+    using dir = std::integral_constant<bool, is_forward>;
+
+    handle link(handle h, dir<forward>) { return(abstractor::link(h)); }
+
+    handle link(handle h, dir<reverse>)
+      {
+        handle result = null();
+        for (handle h2 = head(); h2 != h; result = h2, h2 = link(h2))
+          ;
+
+        return(result);
+      }
+
+    handle start(dir<forward>) { return(head()); }
+
+    handle start(dir<reverse>)
+      {
+        if (store_tail)
+          return(tail());
+
+        handle result = null();
+        for (handle h = head(); h != null(); result = h, h = link(h))
+          ;
+
+        return(result);
+      }
+
   }; // end list
 
 namespace impl
@@ -340,6 +497,15 @@ class p_list : public list<impl::p_list_abs<store_tail> >
   public:
 
     typedef impl::p_list_elem<store_tail> elem;
+
+    typedef typename list<impl::p_list_abs<store_tail> >::handle handle;
+
+    p_list() = default;
+
+    p_list(p_list &to_split, handle first_in_list, handle last_in_list)
+      : list<impl::p_list_abs<store_tail> >(
+          to_split, first_in_list, last_in_list)
+      { }
   };
 
 } // end namespace abstract_container
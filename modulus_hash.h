@@ -37,8 +37,23 @@ modulus hash MH is given by the recusive formula:
 MH(n) = ((S(n) * ((2 ** (Sbits * n)) mod M)) + M(n - 1)) mod M
 
 with M(0) = S(0) mod M .  M is the modulus.
+
+If the sum of all the S(i) * ((2 ** (Sbits * i)) mod M) terms cannot
+overflow a 32 or 64 bit unsigned integer, the terms are summed, and the
+mod M is only applied to the sum (lazy reduction).  This is chosen at
+compile time.  Since M is a compile-time constant, the compiler
+implements the mod M by multiplying with a reciprocal.
+
+modulus_hash_n() hashes many keys per call.  There are no dependencies
+between the keys, so the compiler can vectorize the loop over the keys
+(with one key per vector lane).
 */
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
 namespace abstract_container
 {
 
@@ -179,6 +194,145 @@ class modulus_hash<traits, 0>
       }
   };
 
+// Checks whether the sum of the terms for all key segments always fits in
+// the unsigned integral type acc_t.
+//
+template <class traits, typename acc_t>
+class modulus_hash_sum_fits
+  {
+  private:
+
+    static const std::uint64_t acc_max = std::numeric_limits<acc_t>::max();
+
+    static const std::uint64_t max_segment =
+      traits::key_segment_bits >= 64 ? ~std::uint64_t(0) :
+      (std::uint64_t(1) << (traits::key_segment_bits % 64)) - 1;
+
+    // Largest coefficient.
+    static const std::uint64_t max_coeff =
+      traits::modulus > 1 ? std::uint64_t(traits::modulus) - 1 : 1;
+
+  public:
+
+    static const bool value =
+      max_segment <= ((acc_max / traits::num_key_segments) / max_coeff);
+  };
+
+// Chooses the type to sum key segment terms in for lazy reduction.
+// lazy is false if the sum could overflow 64 bits.
+//
+template <class traits>
+class modulus_hash_acc
+  {
+  private:
+
+    static const bool fits32 =
+      modulus_hash_sum_fits<traits, std::uint32_t>::value;
+
+  public:
+
+    static const bool lazy =
+      fits32 or modulus_hash_sum_fits<traits, std::uint64_t>::value;
+
+    typedef typename std::conditional<
+      fits32, std::uint32_t, std::uint64_t>::type type;
+  };
+
+// Helper template for calculating modulus hash with lazy reduction.
+// Same template parameters as modulus_hash.
+//
+template <class traits, unsigned reverse_key_segment>
+class modulus_hash_sum
+  {
+  public:
+
+    typedef typename modulus_hash_acc<traits>::type acc_t;
+
+    static const unsigned key_segment =
+      traits::num_key_segments - 1 - reverse_key_segment;
+
+    // Returns the sum of the terms for all segments.
+    //
+    static acc_t val(typename traits::key k)
+      {
+        return(
+          (acc_t(traits::template get_segment<key_segment>(k)) *
+           modulus_hash_coeff<traits, key_segment>::val) +
+          modulus_hash_sum<traits, reverse_key_segment - 1>::val(k));
+      }
+
+    // Returns the sum of the terms for the lowest-numbered key_seg_count
+    // segments.
+    //
+    static acc_t val(typename traits::key k, unsigned key_seg_count)
+      {
+        acc_t term =
+          acc_t(traits::template get_segment<key_segment>(k)) *
+          modulus_hash_coeff<traits, key_segment>::val;
+
+        if (key_seg_count == 1)
+          return(term);
+
+        return(
+          term +
+          modulus_hash_sum<traits, reverse_key_segment - 1>::val(
+            k, key_seg_count - 1));
+      }
+  };
+
+template <class traits>
+class modulus_hash_sum<traits, 0>
+  {
+  public:
+
+    typedef typename modulus_hash_acc<traits>::type acc_t;
+
+    static const unsigned key_segment = traits::num_key_segments - 1;
+
+    static acc_t val(typename traits::key k, unsigned = 0)
+      {
+        return(
+          acc_t(traits::template get_segment<key_segment>(k)) *
+          modulus_hash_coeff<traits, key_segment>::val);
+      }
+  };
+
+template<class traits>
+typename traits::modulus_t dispatch_modulus_hash(
+  typename traits::key k, std::true_type /* lazy */)
+  {
+    return(
+      modulus_hash_sum<traits, traits::num_key_segments - 1>::val(k) %
+      traits::modulus);
+  }
+
+template<class traits>
+typename traits::modulus_t dispatch_modulus_hash(
+  typename traits::key k, std::false_type /* lazy */)
+  {
+    return(modulus_hash<traits, traits::num_key_segments - 1>::val(k));
+  }
+
+template<class traits>
+typename traits::modulus_t dispatch_modulus_hash(
+  typename traits::key k, unsigned key_segments_count,
+  std::true_type /* lazy */)
+  {
+    return(
+      modulus_hash_sum<traits, traits::num_key_segments - 1>::val(
+        k, key_segments_count) % traits::modulus);
+  }
+
+template<class traits>
+typename traits::modulus_t dispatch_modulus_hash(
+  typename traits::key k, unsigned key_segments_count,
+  std::false_type /* lazy */)
+  {
+    return(
+      modulus_hash<traits, traits::num_key_segments - 1>::val(
+        k, key_segments_count));
+  }
+
 } // end namespace impl
 
 // Hash all key segments.  'traits' has the same requirements as for
@@ -187,7 +341,11 @@ class modulus_hash<traits, 0>
 template<class traits>
 typename traits::modulus_t modulus_hash(typename traits::key k)
   {
-    return(impl::modulus_hash<traits, traits::num_key_segments - 1>::val(k));
+    return(
+      impl::dispatch_modulus_hash<traits>(
+        k,
+        std::integral_constant<
+          bool, impl::modulus_hash_acc<traits>::lazy>()));
   }
 
 // Hash some of the key segments, starting with segment 0, with the number
@@ -199,8 +357,24 @@ typename traits::modulus_t modulus_hash(
   typename traits::key k, unsigned key_segments_count)
   {
     return(
-      impl::modulus_hash<traits, traits::num_key_segments - 1>::val(
-        k, key_segments_count));
+      impl::dispatch_modulus_hash<traits>(
+        k, key_segments_count,
+        std::integral_constant<
+          bool, impl::modulus_hash_acc<traits>::lazy>()));
+  }
+
+// Hash all key segments of each of the n keys in the array k, putting
+// the hash of k[i] into out[i].  The results are the same as calling
+// modulus_hash(k[i]) for each key.  'traits' has the same requirements as
+// for the impl::modulus_hash template.
+//
+template<class traits>
+void modulus_hash_n(
+  const typename traits::key *k, std::size_t n,
+  typename traits::modulus_t *out)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+      out[i] = modulus_hash<traits>(k[i]);
   }
 
 } // end namespace abstract_container
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_MULTI_INDEX_H_
+#define ABSTRACT_CONTAINER_MULTI_INDEX_H_
+
+#include <type_traits>
+
+namespace abstract_container
+{
+
+// A set of elements that are each in both a hash table and an AVL tree,
+// so they can be found by one key (for example, an ID) with the hash
+// table, and kept in order by another key (for example, an expiry time)
+// with the tree.  Each element must have the links for both containers.
+//
+// hash_table_t is an instantiation of base_hash_table (or a class derived
+// from one), and avl_tree_t is an instantiation of base_avl_tree (or a
+// class derived from one), with the same handle type.  The keys of the
+// elements must be unique in each of the two containers.
+//
+// The containers can be used directly for searching and iterating
+// (through hash_index() and tree_index()), but elements must only be
+// inserted and removed through the multi_index, so they are always in
+// both containers or neither.
+//
+template <class hash_table_t, class avl_tree_t>
+class multi_index
+  {
+  public:
+
+    typedef typename hash_table_t::handle handle;
+
+    static_assert(
+      std::is_same<handle, typename avl_tree_t::handle>::value,
+      "the hash table and the tree must have the same handle type");
+
+    typedef typename hash_table_t::key hash_key;
+    typedef typename avl_tree_t::key tree_key;
+
+    multi_index() = default;
+
+    multi_index(const multi_index &) = delete;
+
+    multi_index & operator = (const multi_index &) = delete;
+
+    static handle null() { return(hash_table_t::null()); }
+
+    hash_table_t & hash_index() { return(hash); }
+
+    avl_tree_t & tree_index() { return(tree); }
+
+    // Inserts the element h (which must not be in either container, and
+    // whose hash key must not be the key of any element in the hash
+    // table) into both containers.  If an element with the same tree key
+    // is already in the tree, h is not inserted, and the handle of the
+    // element in the tree is returned.  Otherwise, returns h.  (Returns
+    // null if there is a read error from the tree.)
+    //
+    handle insert(handle h)
+      {
+        handle th = tree.insert(h);
+
+        if (th == h)
+          hash.insert(h);
+
+        return(th);
+      }
+
+    // Removes the element h (which must be in both containers) from both.
+    // The element is found in the tree by following parent links (if the
+    // tree has them), or by comparing it with other elements, so it does
+    // not have to be searched for by key.
+    //
+    void remove(handle h)
+      {
+        hash.remove(h);
+        tree.remove_node(h);
+      }
+
+    // Removes the element with the given hash key (if any) from both
+    // containers, and returns its handle.  Returns null if there is no
+    // such element.
+    //
+    handle remove_hash_key(hash_key k)
+      {
+        handle h = hash.remove_key(k);
+
+        if (h != null())
+          tree.remove_node(h);
+
+        return(h);
+      }
+
+    // Removes the element with the given tree key (if any) from both
+    // containers, and returns its handle.  Returns null if there is no
+    // such element.
+    //
+    handle remove_tree_key(tree_key k)
+      {
+        handle h = tree.remove(k);
+
+        if (h != null())
+          hash.remove(h);
+
+        return(h);
+      }
+
+    // Makes both containers empty.
+    void purge()
+      {
+        hash.purge();
+        tree.purge();
+      }
+
+    bool is_empty() { return(tree.is_empty()); }
+
+  private:
+
+    hash_table_t hash;
+
+    avl_tree_t tree;
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
@@ -0,0 +1,372 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_NODE_POOL_H_
+#define ABSTRACT_CONTAINER_NODE_POOL_H_
+
+// Pool of elements (nodes) for intrusive containers, allocated from one
+// contiguous arena.  Elements allocated one after another are next to
+// each other in memory, so the links between them are more likely to be
+// in the cache than if each element were allocated with new.
+//
+// The handle of an element in the pool is its index in the arena, of
+// an unsigned integral type (32 bits by default).  So the arena can be
+// the node_array for an avl_array_abs (see avl_links.h), with handles
+// that are the same as the pool's:
+//
+//   struct node
+//     {
+//       std::uint32_t key;
+//       avl_index_links<std::uint32_t> links;
+//     };
+//
+//   node_pool<node> pool;
+//
+//   pool.init(1000000);
+//   tree.abs.node_array = pool.data();  // In a class derived from avl_tree.
+//
+//   std::uint32_t h = pool.alloc();
+//   pool[h].key = 5;
+//   tree.insert(h);
+//
+// The start of the arena is aligned to 64 bytes (cache line size), so if
+// the size of the element type is a multiple of 64 (for example, because
+// it is declared with alignas(64)), every element takes whole cache
+// lines.
+//
+// Freed elements are put in a free list (a list, see list.h) whose links
+// are kept in the memory of the free elements themselves, so the pool
+// has no overhead per element.  alloc() and free() of node_pool lock a
+// mutex, and can be called from any thread.  A thread that allocates and
+// frees often should use its own node_pool::cache instead, which takes
+// and returns elements from and to the pool in batches, so the mutex is
+// locked only once per batch.
+//
+// When the elements in the pool are no longer in any container (for
+// example, after purge() of each container they were in), reset() frees
+// all of them at once, in constant time.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "list.h"
+
+namespace abstract_container
+{
+
+namespace impl
+{
+
+// Abstractor for a list of free elements in a node_pool.  The link is
+// stored in the first bytes of the (unconstructed) element.
+//
+template <class elem, typename index_t>
+class node_pool_free_abs
+  {
+  protected:
+
+    typedef index_t handle;
+
+    static const bool store_tail = false;
+
+    static handle null() { return(index_t(~index_t(0)) >> 1); }
+
+    handle link(handle h) const
+      {
+        index_t l;
+
+        std::memcpy(&l, static_cast<const void *>(base + h), sizeof(l));
+
+        return(l);
+      }
+
+    void link(handle h, handle link_h)
+      { std::memcpy(static_cast<void *>(base + h), &link_h, sizeof(link_h)); }
+
+    elem *base = nullptr;
+  };
+
+template <class elem, typename index_t>
+class node_pool_free_list : public list<node_pool_free_abs<elem, index_t> >
+  {
+  public:
+
+    void set_base(elem *b) { this->base = b; }
+  };
+
+} // end namespace impl
+
+// elem is the type of the elements in the pool.  index_t is the handle
+// type, an unsigned integral type.
+//
+template <class elem, typename index_t = std::uint32_t>
+class node_pool
+  {
+  private:
+
+    typedef impl::node_pool_free_list<elem, index_t> free_list;
+
+  public:
+
+    static_assert(
+      std::is_integral<index_t>::value and std::is_unsigned<index_t>::value,
+      "index_t must be an unsigned integral type");
+
+    static_assert(
+      sizeof(elem) >= sizeof(index_t),
+      "element type for node_pool is smaller than the handle type");
+
+    typedef index_t handle;
+
+    // Never the handle of an element.  The same as avl_index_links<
+    // index_t>::null_index, so the largest capacity is null() .
+    static handle null() { return(index_t(~index_t(0)) >> 1); }
+
+    static const std::size_t alignment =
+      alignof(elem) > 64 ? alignof(elem) : 64;
+
+    node_pool() = default;
+
+    node_pool(const node_pool &) = delete;
+
+    node_pool & operator = (const node_pool &) = delete;
+
+    // The destructors of elements that are still allocated are not called.
+    ~node_pool() { release(); }
+
+    // Allocates an arena with room for capacity elements.  Returns false
+    // if the memory cannot be allocated, or capacity is greater than
+    // null() .  Any previous arena is released.
+    bool init(index_t capacity)
+      {
+        release();
+
+        if (capacity > null())
+          return(false);
+
+        std::size_t space = (std::size_t(capacity) * sizeof(elem)) + alignment;
+
+        if ((space / sizeof(elem)) < capacity)
+          return(false);
+
+        raw = ::operator new(space, std::nothrow);
+
+        if (!raw)
+          return(false);
+
+        void *p = raw;
+
+        std::align(alignment, space - alignment, p, space);
+
+        arena = static_cast<elem *>(p);
+        capacity_ = capacity;
+        free_.set_base(arena);
+
+        return(true);
+      }
+
+    // Frees the arena (the bulk free of all elements).  The destructors of
+    // elements that are still allocated are not called.
+    void release()
+      {
+        ::operator delete(raw);
+        raw = nullptr;
+        arena = nullptr;
+        capacity_ = 0;
+        unused = 0;
+        free_.purge();
+      }
+
+    // Makes every element in the arena free, in constant time.  The
+    // destructors of elements that are allocated are not called.  Must
+    // not be called while a cache for the pool holds free elements.
+    void reset()
+      {
+        std::lock_guard<std::mutex> lg(mtx);
+
+        unused = 0;
+        free_.purge();
+      }
+
+    // Allocates an element, constructed with its default constructor.
+    // Returns null() if all the elements in the arena are allocated.
+    handle alloc()
+      {
+        handle h;
+
+        {
+          std::lock_guard<std::mutex> lg(mtx);
+
+          h = take();
+        }
+
+        if (h != null())
+          ::new (static_cast<void *>(arena + h)) elem;
+
+        return(h);
+      }
+
+    // Destroys and frees an element allocated with alloc() (of the pool
+    // or of a cache for it).
+    void free(handle h)
+      {
+        arena[h].~elem();
+
+        std::lock_guard<std::mutex> lg(mtx);
+
+        free_.push(h);
+      }
+
+    elem & operator [] (handle h) { return(arena[h]); }
+    const elem & operator [] (handle h) const { return(arena[h]); }
+
+    // The first element of the arena (which stays at the same address
+    // until release() or init() is called).
+    elem * data() { return(arena); }
+    const elem * data() const { return(arena); }
+
+    // Handle of an element, given a pointer to it.
+    handle handle_of(const elem *e) const { return(handle(e - arena)); }
+
+    index_t capacity() const { return(capacity_); }
+
+    // Cache of free elements, for use by one thread.  The cache is filled
+    // with batch elements from the pool when it is empty, and returns
+    // batch of its elements to the pool when it has 2 * batch of them.
+    // Must be constructed after init() of the pool.
+    //
+    class cache
+      {
+      public:
+
+        explicit cache(node_pool &p, unsigned batch_ = 32)
+          : pool(p), count(0), batch(batch_ ? batch_ : 1)
+          { free_.set_base(pool.arena); }
+
+        cache(const cache &) = delete;
+
+        cache & operator = (const cache &) = delete;
+
+        // Returns all the free elements in the cache to the pool.
+        ~cache() { flush(); }
+
+        // Same as node_pool::alloc().
+        handle alloc()
+          {
+            if (!count)
+              {
+                std::lock_guard<std::mutex> lg(pool.mtx);
+
+                for ( ; count < batch; ++count)
+                  {
+                    handle h = pool.take();
+
+                    if (h == null())
+                      break;
+
+                    free_.push(h);
+                  }
+
+                if (!count)
+                  return(null());
+              }
+
+            --count;
+
+            handle h = free_.pop();
+
+            ::new (static_cast<void *>(pool.arena + h)) elem;
+
+            return(h);
+          }
+
+        // Same as node_pool::free().  The element may have been allocated
+        // by the pool, or by this or any other cache for the pool.
+        void free(handle h)
+          {
+            pool.arena[h].~elem();
+
+            free_.push(h);
+
+            if (++count == (2 * batch))
+              give(batch);
+          }
+
+        // Returns all the free elements in the cache to the pool.
+        void flush() { give(count); }
+
+      private:
+
+        node_pool &pool;
+
+        free_list free_;
+
+        unsigned count, batch;
+
+        void give(unsigned n)
+          {
+            if (!n)
+              return;
+
+            std::lock_guard<std::mutex> lg(pool.mtx);
+
+            for ( ; n; --n, --count)
+              pool.free_.push(free_.pop());
+          }
+      };
+
+  private:
+
+    void *raw = nullptr;
+
+    elem *arena = nullptr;
+
+    index_t capacity_ = 0;
+
+    // The elements from index unused to the end of the arena have never
+    // been allocated since init() or reset().
+    index_t unused = 0;
+
+    // Freed elements.
+    free_list free_;
+
+    std::mutex mtx;
+
+    // Must be called with mtx locked.
+    handle take()
+      {
+        if (!free_.empty())
+          return(free_.pop());
+
+        if (unused < capacity_)
+          return(unused++);
+
+        return(null());
+      }
+  };
+
+} // end namespace abstract_container
+
+#endif /* Include once */
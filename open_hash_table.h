@@ -0,0 +1,591 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Include once.
+#ifndef ABSTRACT_CONTAINER_OPEN_HASH_TABLE_H_
+#define ABSTRACT_CONTAINER_OPEN_HASH_TABLE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Tag matching uses SSE2 or (on 64-bit ARM) NEON if available, unless
+// ABSTRACT_CONTAINER_NO_SIMD is defined.  Otherwise, tags are matched 8
+// at a time as bytes in a 64-bit integer.
+
+#if !defined(ABSTRACT_CONTAINER_NO_SIMD) and defined(__SSE2__)
+
+#include <emmintrin.h>
+#define ABSTRACT_CONTAINER_OPEN_HASH_SSE2_ 1
+
+#elif !defined(ABSTRACT_CONTAINER_NO_SIMD) and defined(__ARM_NEON) and \
+      defined(__aarch64__)
+
+#include <arm_neon.h>
+#define ABSTRACT_CONTAINER_OPEN_HASH_NEON_ 1
+
+#endif
+
+namespace abstract_container
+{
+
+// A group of slots in an open addressing hash table, in one 64-byte
+// cache line.  Each slot holds a handle, and a one-byte tag.  The tag
+// of a slot holding a handle is the 7 high bits of the hash value of the
+// element's key.  The tag of a free slot has the high bit set.
+//
+template <typename handle>
+class alignas(64) open_hash_group
+  {
+  private:
+
+    static const unsigned slots_8 = (64 - 8) / sizeof(handle);
+
+  public:
+
+    // Number of bytes of tags, a multiple of 8.  The last byte is the
+    // overflow count rather than a tag.
+    static const unsigned tag_bytes = slots_8 <= 8 ? 8 : 16;
+
+    // Number of slots.
+    static const unsigned size =
+      (64 - tag_bytes) / sizeof(handle) < tag_bytes - 1 ?
+        (64 - tag_bytes) / sizeof(handle) : tag_bytes - 1;
+
+    static_assert(size > 0, "handle too big for open_hash_group");
+
+    static const std::uint8_t empty = 0x80;
+
+    // Overflow count saturates at this value.
+    static const std::uint8_t max_overflow = 0xff;
+
+    open_hash_group() { clear(); }
+
+    // Make all slots empty.
+    void clear()
+      {
+        for (unsigned i = 0; i < tag_bytes; ++i)
+          tag[i] = empty;
+
+        overflow() = 0;
+      }
+
+    // Returns a bit mask with bit i set if slot i has tag t.
+    unsigned match(std::uint8_t t) const
+      {
+        #if defined(ABSTRACT_CONTAINER_OPEN_HASH_SSE2_)
+
+        __m128i eq = _mm_cmpeq_epi8(load(), _mm_set1_epi8(char(t)));
+
+        return(unsigned(_mm_movemask_epi8(eq)) & all);
+
+        #elif defined(ABSTRACT_CONTAINER_OPEN_HASH_NEON_)
+
+        unsigned m = 0;
+
+        for (unsigned i = 0; i < tag_bytes; i += 8)
+          m |= bits(vceq_u8(vld1_u8(tag + i), vdup_n_u8(t))) << i;
+
+        return(m & all);
+
+        #else
+
+        unsigned m = 0;
+
+        for (unsigned i = 0; i < tag_bytes; i += 8)
+          {
+            std::uint64_t x = word(i) ^ (lsb * t);
+
+            // High bit set in each byte of x that is zero.
+            x = ~(((x & ~msb) + ~msb) | x | ~msb);
+
+            m |= bits(x) << i;
+          }
+
+        return(m & all);
+
+        #endif
+      }
+
+    // Returns a bit mask with bit i set if slot i does not hold a handle.
+    unsigned match_free() const
+      {
+        #if defined(ABSTRACT_CONTAINER_OPEN_HASH_SSE2_)
+
+        return(unsigned(_mm_movemask_epi8(load())) & all);
+
+        #elif defined(ABSTRACT_CONTAINER_OPEN_HASH_NEON_)
+
+        unsigned m = 0;
+
+        for (unsigned i = 0; i < tag_bytes; i += 8)
+          m |= bits(vcge_u8(vld1_u8(tag + i), vdup_n_u8(0x80))) << i;
+
+        return(m & all);
+
+        #else
+
+        unsigned m = 0;
+
+        for (unsigned i = 0; i < tag_bytes; i += 8)
+          m |= bits(word(i) & msb) << i;
+
+        return(m & all);
+
+        #endif
+      }
+
+    // The number of elements in the table whose probe sequence passed
+    // this group because it was full.  A search can stop at this group
+    // if the count is zero.  Once the count reaches max_overflow, it is
+    // no longer decremented.
+    std::uint8_t & overflow() { return(tag[tag_bytes - 1]); }
+
+    std::uint8_t tag[tag_bytes];
+
+    handle h[size];
+
+  private:
+
+    static const unsigned all = (1U << size) - 1;
+
+    #if defined(ABSTRACT_CONTAINER_OPEN_HASH_SSE2_)
+
+    // Loads all the tags (with zeros after them if there are only 8).
+    __m128i load() const
+      {
+        return(
+          tag_bytes == 16 ?
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(tag)) :
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(tag)));
+      }
+
+    #elif defined(ABSTRACT_CONTAINER_OPEN_HASH_NEON_)
+
+    // Converts a vector of 8 lanes that are each all ones or all zeros
+    // to a bit mask with a bit set for each lane of all ones.
+    static unsigned bits(uint8x8_t v)
+      {
+        return(vaddv_u8(vand_u8(v, vcreate_u8(0x8040201008040201ULL))));
+      }
+
+    #else
+
+    // Tags are compared 8 at a time, as bytes in a 64-bit word.
+
+    static const std::uint64_t lsb = 0x0101010101010101ULL;
+    static const std::uint64_t msb = 0x8080808080808080ULL;
+
+    std::uint64_t word(unsigned i) const
+      {
+        std::uint64_t w;
+
+        std::memcpy(&w, tag + i, 8);
+
+        return(w);
+      }
+
+    // Converts a word where only high bits of bytes are set to a bit mask
+    // with bit i set if the high bit of byte i was set.
+    static unsigned bits(std::uint64_t x)
+      {
+        #if defined(__BYTE_ORDER__) and (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        x = __builtin_bswap64(x);
+        #endif
+
+        return(unsigned(((x >> 7) * 0x0102040810204080ULL) >> 56));
+      }
+
+    #endif
+  };
+
+// Base open addressing hash table template.  Each hash value maps to a
+// group of slots.  If the group is full, the probe continues to other
+// groups (in a triangular number sequence).  A lookup usually only
+// touches one cache line, and only calls is_key() for slots whose tags
+// match.  Each group has a count of the elements that overflowed past it,
+// so a search can stop at the first group with a zero count, and a
+// removed element's slot can just be made empty.
+//
+// abstractor parameter class must have these public members, or equivalents:
+//
+// Types:
+//
+// handle -- must be copyable.  Each element in the table must be
+//   associated with a unique handle value.
+// index -- an unsigned integral type.
+// key -- some copyable type.
+//
+// Member functions:
+//
+// handle null() -- must always return the same value, a handle value that
+//   is never associated with any element.
+// index hash_key(key) -- returns the hash value of the given key.  The
+//   hash value must be over the whole range of the index type, with the
+//   low and high bits well distributed.
+// index hash_elem(handle) -- returns the hash value of the key of the
+//   element associated with the given handle.  Each element placed into
+//   the hash table must be associated with a unique key value.
+// bool is_key(key, handle) -- returns true if the first parameter is
+//   the key of the element whose handle is the second parameter.
+// index num_groups() -- returns the number of groups.  Must be a power
+//   of 2, and must not change while the table is not empty.
+// open_hash_group<handle> & group(index) -- returns the group with the
+//   given index (which is less than num_groups()).  Groups must initially
+//   be in the clear (empty) state.
+//
+// The table does not grow, so the number of elements in it should be
+// kept well below the number of slots (capacity()).
+//
+template <class abstractor>
+class base_open_hash_table : protected abstractor
+  {
+  protected:
+
+    typedef typename abstractor::index index;
+
+  public:
+
+    typedef typename abstractor::key key;
+    typedef typename abstractor::handle handle;
+    typedef open_hash_group<handle> group;
+
+    base_open_hash_table() = default;
+
+    base_open_hash_table(const base_open_hash_table &) = delete;
+
+    base_open_hash_table & operator = (const base_open_hash_table &) =
+      delete;
+
+    // The hash value can be passed to insert() and search(), to avoid
+    // unnecessary recalculation, as for base_hash_table.
+
+    index hash_key(key k) { return(abstractor::hash_key(k)); }
+
+    index hash_elem(handle h) { return(abstractor::hash_elem(h)); }
+
+    static handle null() { return(abstractor::null()); }
+
+    // Total number of slots.
+    index capacity() { return(abstractor::num_groups() * group::size); }
+
+    // Returns false (and does not insert the element) if every slot
+    // is in use.
+    bool insert(handle h, index hash_value)
+      {
+        probe p(*this, hash_value);
+        unsigned m;
+
+        while (!(m = group_at(p.gi).match_free()))
+          if (!p.next())
+            return(false);
+
+        group &g = group_at(p.gi);
+        unsigned s = lowest(m);
+
+        g.h[s] = h;
+        g.tag[s] = tag_of(hash_value);
+
+        // Count the overflow in the full groups passed.
+        for (probe p2(*this, hash_value); p2.gi != p.gi; p2.next())
+          {
+            std::uint8_t &o = group_at(p2.gi).overflow();
+
+            if (o != group::max_overflow)
+              ++o;
+          }
+
+        return(true);
+      }
+
+    bool insert(handle h) { return(insert(h, hash_elem(h))); }
+
+    // Returns null() if no element has key k.
+    handle search(key k, index hash_value)
+      {
+        index gi;
+        unsigned s;
+
+        return(find(k, hash_value, gi, s) ? group_at(gi).h[s] : null());
+      }
+
+    handle search(key k) { return(search(k, hash_key(k))); }
+
+    // Returns the handle of the removed element, or null() is no element
+    // has key k.
+    handle remove_key(key k)
+      {
+        index hv = hash_key(k);
+        index gi;
+        unsigned s;
+
+        if (!find(k, hv, gi, s))
+          return(null());
+
+        handle h = group_at(gi).h[s];
+
+        free_slot(hv, gi, s);
+
+        return(h);
+      }
+
+    // Removes the specified element (which must be in the table).
+    void remove(handle h)
+      {
+        index hv = hash_elem(h);
+        std::uint8_t t = tag_of(hv);
+
+        for (probe p(*this, hv); ; p.next())
+          {
+            group &g = group_at(p.gi);
+
+            for (unsigned m = g.match(t); m; m &= m - 1)
+              {
+                unsigned s = lowest(m);
+
+                if (g.h[s] == h)
+                  {
+                    free_slot(hv, p.gi, s);
+                    return;
+                  }
+              }
+          }
+      }
+
+    // Make the hash table empty.
+    void purge()
+      {
+        index ng = abstractor::num_groups();
+
+        for (index i = 0; i < ng; ++i)
+          group_at(i).clear();
+      }
+
+    // Note:  removing an element invalidates iterators referencing it,
+    // but no others.
+    //
+    class iter
+      {
+      public:
+
+        void start_iter(base_open_hash_table &ht_)
+          {
+            ht = &ht_;
+
+            gi = 0;
+            s = unsigned(0) - 1;
+
+            advance();
+          }
+
+        iter(base_open_hash_table &ht_) { start_iter(ht_); }
+
+        // Returns handle of element currently referenced by iterator, or
+        // null() if the iterator is past the last element (if any).
+        //
+        handle operator * ()
+          {
+            return(
+              gi < ht->num_groups() ?
+                ht->group_at(gi).h[s] : base_open_hash_table::null());
+          }
+
+        operator bool () { return(gi < ht->num_groups()); }
+
+        base_open_hash_table & table() { return(*ht); }
+
+        void operator ++ () { advance(); }
+
+        void operator ++ (int) { ++(*this); }
+
+      protected:
+
+        // Hash table being iterated over.
+        base_open_hash_table *ht;
+
+        // Current group index and slot.
+        index gi;
+        unsigned s;
+
+        void advance()
+          {
+            index ng = ht->num_groups();
+
+            for ( ; gi < ng; ++gi, s = unsigned(0) - 1)
+              {
+                unsigned m = ~ht->group_at(gi).match_free();
+
+                // Next slot after s holding a handle.
+                m &= ~((1U << (s + 1)) - 1);
+
+                if (m & ((1U << group::size) - 1))
+                  {
+                    s = lowest(m);
+                    return;
+                  }
+              }
+          }
+      };
+
+  protected:
+
+    index num_groups() { return(abstractor::num_groups()); }
+
+    group & group_at(index i) { return(abstractor::group(i)); }
+
+  private:
+
+    // Sequence of groups to probe for a hash value.  Adding successive
+    // triangular numbers visits every group, since the number of groups
+    // is a power of 2.
+    //
+    struct probe
+      {
+        probe(base_open_hash_table &ht, index hash_value)
+          : mask(ht.num_groups() - 1), gi(hash_value & mask), step(0) { }
+
+        // Returns false if all groups have been probed.
+        bool next()
+          {
+            if (step == mask)
+              return(false);
+
+            gi = (gi + ++step) & mask;
+
+            return(true);
+          }
+
+        index mask, gi, step;
+      };
+
+    static std::uint8_t tag_of(index hash_value)
+      {
+        return(
+          std::uint8_t(hash_value >> (std::numeric_limits<index>::digits - 7)));
+      }
+
+    // Index of lowest set bit in non-zero mask.
+    static unsigned lowest(unsigned m)
+      {
+        #if defined(__GNUC__)
+
+        return(unsigned(__builtin_ctz(m)));
+
+        #else
+
+        unsigned i = 0;
+
+        while (!(m & 1))
+          {
+            m >>= 1;
+            ++i;
+          }
+
+        return(i);
+
+        #endif
+      }
+
+    // Returns true and sets gi and s to the group index and slot of the
+    // element with key k, if there is one.
+    bool find(key k, index hash_value, index &gi, unsigned &s)
+      {
+        std::uint8_t t = tag_of(hash_value);
+        probe p(*this, hash_value);
+
+        do
+          {
+            group &g = group_at(p.gi);
+
+            for (unsigned m = g.match(t); m; m &= m - 1)
+              {
+                s = lowest(m);
+
+                if (abstractor::is_key(k, g.h[s]))
+                  {
+                    gi = p.gi;
+                    return(true);
+                  }
+              }
+
+            if (g.overflow() == 0)
+              // No element was pushed past this group.
+              return(false);
+          }
+        while (p.next());
+
+        return(false);
+      }
+
+    // Frees slot s of group gi, holding an element with the given hash
+    // value.
+    void free_slot(index hash_value, index gi, unsigned s)
+      {
+        group_at(gi).tag[s] = group::empty;
+
+        for (probe p(*this, hash_value); p.gi != gi; p.next())
+          {
+            std::uint8_t &o = group_at(p.gi).overflow();
+
+            if (o != group::max_overflow)
+              --o;
+          }
+      }
+  };
+
+namespace impl
+{
+
+template <class abstractor>
+class open_hash_table_abs : protected abstractor
+  {
+  private:
+
+    typedef open_hash_group<typename abstractor::handle> group_;
+
+    static_assert(
+      (abstractor::num_groups & (abstractor::num_groups - 1)) == 0,
+      "num_groups must be a power of 2");
+
+    group_ table[abstractor::num_groups];
+
+  protected:
+
+    static typename abstractor::index num_groups()
+      { return(abstractor::num_groups); }
+
+    group_ & group(typename abstractor::index i) { return(table[i]); }
+  };
+
+}
+
+// Abstractor parameter has same requirements as for the
+// base_open_hash_table template, except that it does not have the
+// group() member function, and num_groups is a static constant (a power
+// of 2) rather than a member function.  To get the cache line alignment
+// of the groups with C++ versions before C++17, an instance should not be
+// allocated dynamically with new.
+//
+template <class abstractor>
+using open_hash_table =
+  base_open_hash_table<impl::open_hash_table_abs<abstractor> >;
+
+} // end namespace abstract_container
+
+#endif /* Include once */
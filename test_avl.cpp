@@ -20,6 +20,22 @@ SOFTWARE.
 // Abstract AVL Tree Template Test Suite.
 // Version: 1.6
 
+// Define as 1 to test trees whose nodes have parent links.
+#ifndef PARENT_LINKS
+#define PARENT_LINKS 0
+#endif
+
+// Define as 1 to test trees whose nodes have subtree sizes.
+#ifndef SUBTREE_SIZES
+#define SUBTREE_SIZES 0
+#endif
+
+// Define as 1 to test trees with the update() member function in the
+// abstractor.  It keeps the greatest node index in each subtree.
+#ifndef NODE_UPDATES
+#define NODE_UPDATES 0
+#endif
+
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
@@ -47,6 +63,12 @@ static struct
 
     unsigned gt, lt;
 
+    unsigned par;
+
+    unsigned sz;
+
+    unsigned mx;
+
   }
 arr[401], arr2[400];
 
@@ -135,10 +157,73 @@ class abstr
 	return(arr[h1 & ~HIGH_BIT].val - arr[h2 & ~HIGH_BIT].val);
       }
 
+    #if PARENT_LINKS
+
+    static handle get_parent(handle h, bool access)
+      {
+	if (!(h & HIGH_BIT))
+	  bail("get_parent");
+	handle parent = arr[h & ~HIGH_BIT].par;
+	if (access and (parent != null()))
+	  parent |= HIGH_BIT;
+	return(parent);
+      }
+
+    static void set_parent(handle h, handle ph)
+      {
+	if (!(h & HIGH_BIT))
+	  bail("set_parent");
+	if (ph != null())
+	  ph &= ~HIGH_BIT;
+	arr[h & ~HIGH_BIT].par = ph;
+      }
+
+    #endif
+
+    #if SUBTREE_SIZES
+
+    static size get_size(handle h)
+      {
+	if (!(h & HIGH_BIT))
+	  bail("get_size");
+	return(arr[h & ~HIGH_BIT].sz);
+      }
+
+    static void set_size(handle h, size s)
+      {
+	if (!(h & HIGH_BIT))
+	  bail("set_size");
+	arr[h & ~HIGH_BIT].sz = s;
+      }
+
+    #endif
+
+    #if NODE_UPDATES
+
+    static void update(handle h)
+      {
+	if (!(h & HIGH_BIT))
+	  bail("update");
+	unsigned i = h & ~HIGH_BIT, mx = i;
+	if ((arr[i].lt != null()) and (arr[arr[i].lt].mx > mx))
+	  mx = arr[arr[i].lt].mx;
+	if ((arr[i].gt != null()) and (arr[arr[i].gt].mx > mx))
+	  mx = arr[arr[i].gt].mx;
+	arr[i].mx = mx;
+      }
+
+    #endif
+
     static handle null(void) { return(~0); }
 
     static bool read_error(void) { return(false); }
 
+    static void prefetch(handle h)
+      {
+	if ((h == null()) or !(h & HIGH_BIT))
+	  bail("prefetch");
+      }
+
   };
 
 // AVL tree with public root for testing purposes.
@@ -161,6 +246,27 @@ int verify_tree(unsigned subroot = tree.pub_root & ~HIGH_BIT)
     int l_depth, g_depth;
     unsigned h;
 
+    #if PARENT_LINKS
+    if ((subroot == (tree.pub_root & ~HIGH_BIT)) and
+        (arr[subroot].par != abstr::null()))
+      {
+	printf("root has parent: %u %u\n", subroot, arr[subroot].par);
+	bail("verify_tree");
+      }
+    if ((arr[subroot].lt != abstr::null()) and
+        (arr[arr[subroot].lt].par != subroot))
+      {
+	printf("bad less parent: %u %u\n", subroot, arr[subroot].lt);
+	bail("verify_tree");
+      }
+    if ((arr[subroot].gt != abstr::null()) and
+        (arr[arr[subroot].gt].par != subroot))
+      {
+	printf("bad greater parent: %u %u\n", subroot, arr[subroot].gt);
+	bail("verify_tree");
+      }
+    #endif
+
     if (arr[subroot].lt == abstr::null())
       l_depth = 0;
     else
@@ -196,6 +302,34 @@ int verify_tree(unsigned subroot = tree.pub_root & ~HIGH_BIT)
 	bail("verify_tree");
       }
 
+    #if SUBTREE_SIZES
+    unsigned sz = 1;
+    if (arr[subroot].lt != abstr::null())
+      sz += arr[arr[subroot].lt].sz;
+    if (arr[subroot].gt != abstr::null())
+      sz += arr[arr[subroot].gt].sz;
+    if (arr[subroot].sz != sz)
+      {
+	printf("bad size: n=%u sz=%u should be %u\n",
+	       subroot, arr[subroot].sz, sz);
+	bail("verify_tree");
+      }
+    #endif
+
+    #if NODE_UPDATES
+    unsigned mx = subroot;
+    if ((arr[subroot].lt != abstr::null()) and (arr[arr[subroot].lt].mx > mx))
+      mx = arr[arr[subroot].lt].mx;
+    if ((arr[subroot].gt != abstr::null()) and (arr[arr[subroot].gt].mx > mx))
+      mx = arr[arr[subroot].gt].mx;
+    if (arr[subroot].mx != mx)
+      {
+	printf("bad update: n=%u mx=%u should be %u\n",
+	       subroot, arr[subroot].mx, mx);
+	bail("verify_tree");
+      }
+    #endif
+
     return((g_depth > l_depth ? g_depth : l_depth) + 1);
   }
 
@@ -218,9 +352,51 @@ void insert(unsigned h)
       }
   }
 
+// Remove the node with key k (if any) using an iterator of type It.
+template <class It>
+unsigned remove_iter(int k)
+  {
+    It it;
+    it.start_iter(tree, k);
+    unsigned rh = tree.remove(it);
+    if (*it != abstr::null())
+      bail("remove - iter");
+    return(rh);
+  }
+
+// Ways for remove() to remove nodes.  By default, remove(key) and
+// remove_node() are both used, depending on the key.  The others are
+// used on their own, in separate passes.
+const unsigned Remove_by_key = 0;
+const unsigned Remove_by_node = 1;
+const unsigned Remove_by_path_iter = 2;
+const unsigned Remove_by_parent_iter = 3;
+
+unsigned remove_way = Remove_by_key;
+
 void remove(int k, bool should_be_null = false)
   {
-    unsigned rh = tree.remove(k);
+    unsigned rh;
+
+    if (remove_way == Remove_by_node)
+      {
+	rh = tree.search(k);
+	if (rh != abstr::null())
+	  rh = tree.remove_node(rh);
+      }
+    else if (remove_way == Remove_by_path_iter)
+      rh = remove_iter<t_avl_tree::path_iter>(k);
+    else if (remove_way == Remove_by_parent_iter)
+      rh = remove_iter<t_avl_tree::parent_iter>(k);
+    // Test both ways of removing.
+    else if (k & 2)
+      {
+	rh = tree.search(k);
+	if (rh != abstr::null())
+	  rh = tree.remove_node(rh);
+      }
+    else
+      rh = tree.remove(k);
     if (rh == abstr::null())
       {
 	if (!should_be_null)
@@ -263,6 +439,9 @@ void mark_bf(void)
       }
   }
 
+// Iterator for finger searches, left where the last one ended.
+t_avl_tree::path_iter finger;
+
 void search_test(int key, abstract_container::search_type st, unsigned rh)
   {
     if (tree.search(key, st) != (rh | HIGH_BIT))
@@ -270,6 +449,12 @@ void search_test(int key, abstract_container::search_type st, unsigned rh)
 	printf("%d %x %u\n", key, (unsigned) st, rh);
 	bail("search_test");
       }
+    if ((tree.search(key, st, finger) != (rh | HIGH_BIT)) or
+	(*finger != (rh | HIGH_BIT)))
+      {
+	printf("%d %x %u\n", key, (unsigned) st, rh);
+	bail("search_test - finger");
+      }
     iter it;
     it.start_iter(tree, key, st);
     if (*it != (rh | HIGH_BIT))
@@ -354,10 +539,59 @@ void search_test(unsigned h)
       }
   }
 
+// Test visit_range() and count_range() against counts of the nodes in
+// the tree with keys in [lo, hi).
+void range_test(void)
+  {
+    for (int lo = -1; lo <= int(2 * max_elems + 1); lo += 3)
+      {
+	int hi = lo + ((lo * 7 + 23) % 23) - 3;
+	unsigned n = 0;
+
+	for (unsigned h = 0; h < max_elems; h++)
+	  if ((arr[h].bf != 123) and (int(2 * h) >= lo) and (int(2 * h) < hi))
+	    n++;
+
+	if (tree.count_range(lo, hi) != n)
+	  {
+	    printf("%d %d %u\n", lo, hi, n);
+	    bail("range_test count");
+	  }
+
+	unsigned visited = 0;
+	int last = lo - 1;
+	bool ok = true;
+
+	if (!tree.visit_range(
+	       lo, hi,
+	       [&](unsigned h)
+		 {
+		   int k = arr[h & ~HIGH_BIT].val;
+		   ok = ok and (k > last) and (k < hi);
+		   last = k;
+		   return(++visited < 2);
+		 }) != (n >= 2))
+	  bail("range_test visit stop");
+	if (!ok or (visited != (n < 2 ? n : 2)))
+	  {
+	    printf("%d %d %u %u\n", lo, hi, n, visited);
+	    bail("range_test visit");
+	  }
+
+	visited = 0;
+	if (!tree.visit_range(
+	       lo, hi, [&visited](unsigned) { ++visited; return(true); }) or
+	    (visited != n))
+	  bail("range_test visit all");
+      }
+  }
+
 void search_all(void)
   {
     unsigned h = max_elems, min = abstr::null(), max = abstr::null();
 
+    finger = t_avl_tree::path_iter();
+
     while (h)
       {
 	h--;
@@ -429,6 +663,80 @@ void search_all(void)
     it--;
     if (*it != abstr::null())
       bail("search_all increment - end");
+
+    // Test batched searches, for keys of nodes and keys between them.
+    {
+      static const abstract_container::search_type st[] =
+	{
+	  abstract_container::EQUAL, abstract_container::LESS,
+	  abstract_container::LESS_EQUAL, abstract_container::GREATER,
+	  abstract_container::GREATER_EQUAL
+	};
+      const unsigned num_keys = 2 * max_elems + 2;
+      int k[2 * 400 + 2];
+      unsigned out[2 * 400 + 2];
+
+      // Not in order, so searches in the same group go different ways.
+      for (unsigned i = 0; i < num_keys; i++)
+	k[i] = int((i * 7) % num_keys) - 1;
+
+      for (unsigned s = 0; s < (sizeof(st) / sizeof(st[0])); s++)
+	// Counts of 0 through 20 keys, then all the keys.
+	for (unsigned c = 0; c <= 21; c++)
+	  {
+	    unsigned n = c <= 20 ? c : num_keys;
+
+	    tree.search_many(k, n, out, st[s]);
+	    for (unsigned i = 0; i < n; i++)
+	      if (out[i] != tree.search(k[i], st[s]))
+		{
+		  printf("%u %u %d %x\n", s, n, k[i], out[i]);
+		  bail("search_all search_many");
+		}
+	  }
+    }
+
+    #if SUBTREE_SIZES
+
+    // Test order statistics.
+    unsigned n = 0;
+    for (h = 0; h < max_elems; h++)
+      if (arr[h].bf != 123)
+	{
+	  if (tree.select(n) != (h | HIGH_BIT))
+	    {
+	      printf("%u %x\n", n, h);
+	      bail("search_all select");
+	    }
+	  if ((tree.rank(2 * h) != n) or (tree.rank(2 * h + 1) != (n + 1)) or
+	      (tree.rank(2 * h - 1) != n))
+	    {
+	      printf("%u %x\n", n, h);
+	      bail("search_all rank");
+	    }
+	  it.start_iter_select(tree, n);
+	  if (*it != (h | HIGH_BIT))
+	    {
+	      printf("%u %x %x\n", n, h, *it);
+	      bail("search_all select - iter");
+	    }
+	  it++;
+	  if (*it != tree.search(2 * h, abstract_container::GREATER))
+	    {
+	      printf("%u %x %x\n", n, h, *it);
+	      bail("search_all select - iter ++");
+	    }
+	  n++;
+	}
+    if ((tree.count() != n) or (tree.select(n) != abstr::null()))
+      bail("search_all count");
+    it.start_iter_select(tree, n);
+    if (*it != abstr::null())
+      bail("search_all select - iter end");
+
+    #endif
+
+    range_test();
   }
 
 void dump(unsigned subroot, unsigned depth)
@@ -588,6 +896,29 @@ class possible_trees
 	  dump(arr2[subroot].gt, depth + 1);
       }
 
+    // Set the parent links, subtree sizes and greatest node indexes in
+    // the main node array.  Returns subtree size.
+    unsigned set_optional(unsigned subroot, unsigned parent)
+      {
+	unsigned sz = 1, mx = subroot;
+	arr[subroot].par = parent;
+	if (arr[subroot].lt != abstr::null())
+	  {
+	    sz += set_optional(arr[subroot].lt, subroot);
+	    if (arr[arr[subroot].lt].mx > mx)
+	      mx = arr[arr[subroot].lt].mx;
+	  }
+	if (arr[subroot].gt != abstr::null())
+	  {
+	    sz += set_optional(arr[subroot].gt, subroot);
+	    if (arr[arr[subroot].gt].mx > mx)
+	      mx = arr[arr[subroot].gt].mx;
+	  }
+	arr[subroot].sz = sz;
+	arr[subroot].mx = mx;
+	return(sz);
+      }
+
   public:
 
     // Copy from shadow node array to main node array and set tree root.
@@ -595,6 +926,7 @@ class possible_trees
       {
 	memcpy(arr, arr2, t.size * sizeof(arr[0]));
 	tree.pub_root = t.root | HIGH_BIT;
+	set_optional(t.root, abstr::null());
       }
 
     void first(unsigned d) { depth_ = d; t = first(0, depth_); }
@@ -668,6 +1000,415 @@ void build_test(void)
       }
   }
 
+// Test the build_unsorted member function template.  The trees it builds
+// must be identical to the ones build builds.
+void build_unsorted_test(void)
+  {
+    unsigned i, j, num_threads;
+    unsigned shuffled[400];
+
+    for (i = 1; i <= 400; i += 7)
+      for (num_threads = 1; num_threads <= 5; num_threads++)
+	{
+	  tree.build(h_arr, i);
+	  memcpy(arr2, arr, sizeof(arr2));
+	  unsigned root = tree.pub_root;
+
+	  // Shuffle (deterministically) the handles.
+	  for (j = 0; j < i; j++)
+	    shuffled[j] = h_arr[(j * 263) % i];
+
+	  mark_bf();
+	  tree.purge();
+	  if (!tree.build_unsorted(shuffled, i, num_threads))
+	    bail("build_unsorted failed");
+	  verify_tree();
+
+	  if (tree.pub_root != root)
+	    bail("build_unsorted root");
+	  for (j = 0; j < i; j++)
+	    if ((shuffled[j] != h_arr[j]) or (arr[j].lt != arr2[j].lt) or
+		(arr[j].gt != arr2[j].gt) or (arr[j].bf != arr2[j].bf))
+	      {
+		printf("%u %u %u\n", i, num_threads, j);
+		bail("build_unsorted");
+	      }
+	}
+
+    // Restore shadow node array.
+    for (i = 0; i < 400; i++)
+      arr2[i].val = i * 2;
+  }
+
+// Test insert() with a hint iterator, for near-ascending inserts and for
+// inserts that jump around.
+void hint_test(void)
+  {
+    t_avl_tree::path_iter hint, it;
+    unsigned i, j, h;
+
+    for (j = 0; j < 3; j++)
+      {
+	tree.purge();
+	mark_bf();
+	hint = t_avl_tree::path_iter();
+
+	for (i = 0; i < max_elems; i++)
+	  {
+	    h = j == 0 ? i : (j == 1 ? (i ^ 3) : ((i * 263) % max_elems));
+	    if ((tree.insert(h | HIGH_BIT, hint) != (h | HIGH_BIT)) or
+		(*hint != (h | HIGH_BIT)))
+	      {
+		printf("%u %u\n", j, h);
+		bail("hint insert");
+	      }
+	    verify_tree();
+
+	    // The path of the hint must be right for the iterator to move.
+	    it = hint;
+	    it++;
+	    if (*it != tree.search(2 * h, abstract_container::GREATER))
+	      bail("hint insert ++");
+	    it = hint;
+	    it--;
+	    if (*it != tree.search(2 * h, abstract_container::LESS))
+	      bail("hint insert --");
+
+	    // Insert of a duplicate key.
+	    arr[400].val = 2 * h;
+	    if ((tree.insert(400 | HIGH_BIT, hint) != (h | HIGH_BIT)) or
+		(*hint != (h | HIGH_BIT)))
+	      bail("hint insert duplicate");
+	  }
+
+	search_all();
+      }
+
+    tree.purge();
+    mark_bf();
+  }
+
+// Abstractor whose read_error() returns the value of a flag.
+class err_abstr : public abstr
+  {
+  public:
+
+    static bool error;
+
+    static bool read_error(void) { return(error); }
+  };
+
+bool err_abstr::error = false;
+
+typedef abstract_container::avl_tree<
+  err_abstr, 32, abstract_container::avl_count_stats> s_avl_tree;
+
+s_avl_tree s_tree;
+
+// Test the stats policy and depth_histogram().
+void stats_test(void)
+  {
+    unsigned i, hist[32];
+
+    // Ascending inserts need a single rotation.
+    s_tree.insert(0 | HIGH_BIT);
+    s_tree.insert(1 | HIGH_BIT);
+    if ((s_tree.single_rotations() != 0) or (s_tree.comparisons() != 1))
+      bail("stats 2 nodes");
+    s_tree.insert(2 | HIGH_BIT);
+    if ((s_tree.single_rotations() != 1) or
+	(s_tree.double_rotations() != 0) or (s_tree.comparisons() != 3))
+      bail("stats single rotation");
+
+    // Tree is now 2 at root, with children 0 and 4.
+    s_tree.reset_stats();
+    s_tree.search(2);
+    if (s_tree.comparisons() != 1)
+      bail("stats search root");
+    s_tree.search(4);
+    s_tree.search(5, abstract_container::LESS);
+    if (s_tree.comparisons() != 5)
+      bail("stats search");
+
+    if (!s_tree.depth_histogram(hist) or (hist[0] != 1) or (hist[1] != 2) or
+	(hist[2] != 0))
+      bail("depth_histogram 3 nodes");
+
+    // Inserting 4, 0, 2 needs a double rotation.
+    s_tree.purge();
+    s_tree.reset_stats();
+    s_tree.insert(2 | HIGH_BIT);
+    s_tree.insert(0 | HIGH_BIT);
+    s_tree.insert(1 | HIGH_BIT);
+    if ((s_tree.single_rotations() != 0) or (s_tree.double_rotations() != 1))
+      bail("stats double rotation");
+
+    // The search reads the less child of the root.
+    err_abstr::error = true;
+    if (s_tree.search(0) != abstr::null())
+      bail("stats read error search");
+    err_abstr::error = false;
+    if (s_tree.read_errors() == 0)
+      bail("stats read errors");
+    s_tree.reset_stats();
+    if (s_tree.read_errors() or s_tree.comparisons() or
+	s_tree.single_rotations() or s_tree.double_rotations())
+      bail("reset_stats");
+
+    s_tree.purge();
+    if (!s_tree.depth_histogram(hist) or (hist[0] != 0))
+      bail("depth_histogram empty");
+
+    // Full tree with 4 levels.
+    s_tree.build(h_arr, 15);
+    if (!s_tree.depth_histogram(hist) or (hist[0] != 1) or (hist[1] != 2) or
+	(hist[2] != 4) or (hist[3] != 8) or (hist[4] != 0))
+      bail("depth_histogram 15 nodes");
+
+    // Many inserts and removes.  Total of histogram is the node count.
+    s_tree.purge();
+    s_tree.reset_stats();
+    for (i = 0; i < 400; i++)
+      s_tree.insert(((i * 7) % 400) | HIGH_BIT);
+    for (i = 0; i < 400; i += 3)
+      s_tree.remove(i * 2);
+    if ((s_tree.single_rotations() + s_tree.double_rotations()) == 0)
+      bail("stats no rotations");
+
+    unsigned total = 0;
+    if (!s_tree.depth_histogram(hist))
+      bail("depth_histogram 266 nodes");
+    for (i = 0; i < 32; i++)
+      {
+	if (hist[i] > (1U << (i < 31 ? i : 31)))
+	  bail("depth_histogram level");
+	total += hist[i];
+      }
+    if (total != (400 - 134))
+      bail("depth_histogram total");
+
+    // Each ascending insert with a hint is only compared with the node
+    // inserted before it.
+    s_tree.purge();
+    s_tree.reset_stats();
+    s_avl_tree::path_iter hint;
+    for (i = 0; i < 400; i++)
+      s_tree.insert(i | HIGH_BIT, hint);
+    if (s_tree.comparisons() != 399)
+      bail("stats hint insert");
+
+    s_tree.purge();
+  }
+
+// Number of keys for the set operation tests.  Node i and node Set_keys + i
+// both have key 2 * i, so two trees can have nodes with the same keys.
+const unsigned Set_keys = 200;
+
+t_avl_tree set_a, set_b, set_c;
+
+// Node (if any) with key 2 * i that is expected in each tree, or null.
+unsigned want_a[Set_keys], want_b[Set_keys], want_c[Set_keys];
+
+// Check that t is valid and has exactly the wanted nodes.
+void set_check(t_avl_tree &t, const unsigned *want, const char *note)
+  {
+    unsigned i, n = 0;
+
+    if (t.pub_root != abstr::null())
+      {
+	verify_tree(t.pub_root & ~HIGH_BIT);
+	#if PARENT_LINKS
+	if (arr[t.pub_root & ~HIGH_BIT].par != abstr::null())
+	  bail(note);
+	#endif
+      }
+
+    t_avl_tree::iter it;
+    it.start_iter_least(t);
+    for (i = 0; i < Set_keys; i++)
+      if (want[i] != abstr::null())
+	{
+	  if (*it != (want[i] | HIGH_BIT))
+	    {
+	      printf("%u %x %x\n", i, *it, want[i]);
+	      bail(note);
+	    }
+	  it++;
+	  n++;
+	}
+    if (*it != abstr::null())
+      bail(note);
+
+    #if SUBTREE_SIZES
+    if (t.count() != n)
+      bail(note);
+    #else
+    (void) n;
+    #endif
+  }
+
+// Fill t with random nodes from base to base + Set_keys - 1.  density is
+// the chance, in eighths, of each node being in t.
+void set_fill(
+  t_avl_tree &t, unsigned *want, unsigned base, unsigned &r, unsigned density)
+  {
+    t.purge();
+    for (unsigned i = 0; i < Set_keys; i++)
+      {
+	r = r * 1103515245 + 12345;
+	if (((r >> 16) % 8) < density)
+	  {
+	    want[i] = base + i;
+	    if (t.insert((base + i) | HIGH_BIT) != ((base + i) | HIGH_BIT))
+	      bail("set_fill");
+	  }
+	else
+	  want[i] = abstr::null();
+      }
+  }
+
+// Test split(), join() and the set operations on random trees.
+void set_test(void)
+  {
+    unsigned i, trial, r = 1;
+    const unsigned null = abstr::null();
+
+    // verify_tree() checks the parent of the root of tree.
+    tree.purge();
+
+    for (i = 0; i < Set_keys; i++)
+      {
+	arr[i].val = 2 * i;
+	arr[Set_keys + i].val = 2 * i;
+	want_c[i] = null;
+      }
+
+    for (trial = 0; trial < 243; trial++)
+      {
+	unsigned num_threads = 1 + (trial % 3);
+
+	// Densities from 0 to 8 eighths, so some trees are empty or small.
+	set_fill(set_a, want_a, 0, r, trial % 9);
+	set_fill(set_b, want_b, Set_keys, r, (trial / 9) % 9);
+	set_check(set_a, want_a, "set fill a");
+	set_check(set_b, want_b, "set fill b");
+
+	// Split a, then join it back together.
+	int k = int((trial * 37) % (2 * Set_keys + 3)) - 1;
+	unsigned found = set_a.split(k, set_c);
+	unsigned want_found = null;
+	for (i = 0; i < Set_keys; i++)
+	  if (int(2 * i) > k)
+	    {
+	      want_c[i] = want_a[i];
+	      want_a[i] = null;
+	    }
+	  else if (int(2 * i) == k)
+	    {
+	      if (want_a[i] != null)
+		want_found = want_a[i] | HIGH_BIT;
+	      want_a[i] = null;
+	    }
+	if (found != want_found)
+	  bail("split found");
+	set_check(set_a, want_a, "split less");
+	set_check(set_c, want_c, "split greater");
+	if (found != null)
+	  {
+	    set_a.insert(found);
+	    want_a[k / 2] = found & ~HIGH_BIT;
+	  }
+	if (!set_a.join(set_c))
+	  bail("join");
+	for (i = 0; i < Set_keys; i++)
+	  if (want_c[i] != null)
+	    {
+	      want_a[i] = want_c[i];
+	      want_c[i] = null;
+	    }
+	set_check(set_a, want_a, "join");
+	set_check(set_c, want_c, "join empty");
+
+	switch (trial % 3)
+	  {
+	  case 0:
+	    if (!set_a.unite(set_b, num_threads))
+	      bail("unite");
+	    for (i = 0; i < Set_keys; i++)
+	      if (want_a[i] == null)
+		{
+		  want_a[i] = want_b[i];
+		  want_b[i] = null;
+		}
+	    set_check(set_a, want_a, "unite");
+	    set_check(set_b, want_b, "unite dups");
+	    break;
+
+	  case 1:
+	    if (!set_a.intersect(set_b, set_c, num_threads))
+	      bail("intersect");
+	    for (i = 0; i < Set_keys; i++)
+	      if (want_b[i] == null)
+		{
+		  want_c[i] = want_a[i];
+		  want_a[i] = null;
+		}
+	    set_check(set_a, want_a, "intersect");
+	    set_check(set_b, want_b, "intersect other");
+	    set_check(set_c, want_c, "intersect removed");
+	    break;
+
+	  default:
+	    if (!set_a.subtract(set_b, set_c, num_threads))
+	      bail("subtract");
+	    for (i = 0; i < Set_keys; i++)
+	      if (want_b[i] != null)
+		{
+		  want_c[i] = want_a[i];
+		  want_a[i] = null;
+		}
+	    set_check(set_a, want_a, "subtract");
+	    set_check(set_b, want_b, "subtract other");
+	    set_check(set_c, want_c, "subtract removed");
+	  }
+
+	set_c.purge();
+	for (i = 0; i < Set_keys; i++)
+	  want_c[i] = null;
+      }
+
+    // Union of a small tree with a big one.
+    set_a.purge();
+    set_b.purge();
+    for (i = 0; i < Set_keys; i++)
+      {
+	want_a[i] = i;
+	set_a.insert(i | HIGH_BIT);
+	want_b[i] = null;
+      }
+    set_b.insert((Set_keys + 7) | HIGH_BIT);
+    set_b.insert((Set_keys + 150) | HIGH_BIT);
+    if (!set_b.unite(set_a, 2))
+      bail("unite small");
+    for (i = 0; i < Set_keys; i++)
+      if ((i == 7) or (i == 150))
+	want_b[i] = Set_keys + i;
+      else
+	{
+	  want_b[i] = i;
+	  want_a[i] = null;
+	}
+    set_check(set_b, want_b, "unite small");
+    set_check(set_a, want_a, "unite small dups");
+
+    set_a.purge();
+    set_b.purge();
+
+    // Restore node values.
+    for (i = 0; i < 400; i++)
+      arr[i].val = i * 2;
+  }
+
 int main()
   {
     unsigned i;
@@ -677,6 +1418,20 @@ int main()
       sizeof(abstract_container::avl_tree<abstr>) == sizeof(unsigned) ?
 	"" : " NOT");
 
+    if (abstract_container::avl_tree<abstr>::parent_links != PARENT_LINKS)
+      bail("parent_links");
+
+    if (abstract_container::avl_tree<abstr>::subtree_sizes != SUBTREE_SIZES)
+      bail("subtree_sizes");
+
+    if (abstract_container::avl_tree<abstr>::augmented != NODE_UPDATES)
+      bail("augmented");
+
+    #if PARENT_LINKS
+    if (sizeof(iter) > (2 * sizeof(void *)))
+      bail("parent_iter size");
+    #endif
+
     for (i = 0; i < 400; i++)
       arr2[i].val = i * 2;
 
@@ -758,10 +1513,44 @@ int main()
 
     all_trees(5);
 
+    for (remove_way = Remove_by_node; remove_way <= Remove_by_parent_iter;
+	 ++remove_way)
+      {
+	printf("remove way %u\n", remove_way);
+
+	// all_trees() leaves the last tree it placed.
+	tree.purge();
+	max_elems = 400;
+	mark_bf();
+
+	big_test(3, 7);
+	big_test(13, 7);
+	all_trees(3);
+	all_trees(4);
+      }
+
+    remove_way = Remove_by_key;
+
     printf("build test\n");
 
     build_test();
 
+    printf("build_unsorted test\n");
+
+    build_unsorted_test();
+
+    printf("hint test\n");
+
+    hint_test();
+
+    printf("stats test\n");
+
+    stats_test();
+
+    printf("set test\n");
+
+    set_test();
+
     printf("SUCCESS!\n");
 
     return(0);
@@ -0,0 +1,322 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for avl_links.h .
+
+#include "avl_links.h"
+#include "avl_links.h"
+
+#include "avl_tree.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+// Check that every index from 0 to null_index, with every balance factor,
+// can be stored in the links without changing the other link.
+//
+template <class Links>
+void links_test()
+  {
+    typedef typename Links::index index;
+
+    const index vals[] =
+      { 0, 1, 2, index(Links::null_index / 2), index(Links::null_index - 1),
+        Links::null_index };
+
+    Links l;
+
+    // Initial state.
+    CHK(l.get_less() == Links::null_index);
+    CHK(l.get_greater() == Links::null_index);
+    CHK(l.get_balance_factor() == 0);
+
+    for (index lt : vals)
+      for (index gt : vals)
+        for (int bf = -1; bf <= 1; ++bf)
+          {
+            l.set_less(lt);
+            l.set_greater(gt);
+            l.set_balance_factor(bf);
+            CHK(l.get_less() == lt);
+            CHK(l.get_greater() == gt);
+            CHK(l.get_balance_factor() == bf);
+
+            // Set in the other order.
+            l.set_balance_factor(-bf);
+            l.set_greater(lt);
+            l.set_less(gt);
+            CHK(l.get_less() == gt);
+            CHK(l.get_greater() == lt);
+            CHK(l.get_balance_factor() == -bf);
+          }
+  }
+
+const unsigned Num_nodes = 120;
+
+template <class Links>
+struct Index_node
+  {
+    int key;
+    Links links;
+  };
+
+template <class Links>
+struct Index_abs :
+  public avl_array_abs<Index_node<Links>, Links, &Index_node<Links>::links>
+  {
+    typedef int key;
+    typedef unsigned size;
+    typedef typename Links::index handle;
+
+    int get_key(handle h) { return(this->node_array[h].key); }
+
+    int compare_key_node(key k, handle h)
+      { return((k > get_key(h)) - (k < get_key(h))); }
+
+    int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(get_key(h1), h2)); }
+
+    static bool read_error() { return(false); }
+  };
+
+struct Ptr_node
+  {
+    int key;
+    avl_tagged_ptr_links<Ptr_node> links;
+  };
+
+struct Ptr_abs : public avl_tagged_ptr_abs<Ptr_node, &Ptr_node::links>
+  {
+    typedef int key;
+    typedef unsigned size;
+
+    static int get_key(handle h) { return(h->key); }
+
+    static int compare_key_node(key k, handle h)
+      { return((k > h->key) - (k < h->key)); }
+
+    static int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(h1->key, h2)); }
+
+    static bool read_error() { return(false); }
+  };
+
+// Tree with members to check the validity of its structure.
+//
+template <class Abs>
+class Tree : public avl_tree<Abs>
+  {
+  public:
+
+    typedef typename Abs::handle handle;
+
+    Abs & get_abs() { return(this->abs); }
+
+    // Check the balance factors and key order, and return the number of
+    // nodes.
+    unsigned validate()
+      {
+        unsigned n = 0;
+
+        height(this->abs.root, n);
+
+        return(n);
+      }
+
+  private:
+
+    int height(handle h, unsigned &n)
+      {
+        if (h == this->abs.null())
+          return(0);
+
+        ++n;
+
+        handle lt = this->abs.get_less(h, true);
+        handle gt = this->abs.get_greater(h, true);
+
+        if (lt != this->abs.null())
+          CHK(this->abs.get_key(lt) < this->abs.get_key(h));
+        if (gt != this->abs.null())
+          CHK(this->abs.get_key(h) < this->abs.get_key(gt));
+
+        int lh = height(lt, n), gh = height(gt, n);
+
+        CHK(this->abs.get_balance_factor(h) == (gh - lh));
+
+        return(1 + (lh > gh ? lh : gh));
+      }
+  };
+
+// Random inserts and removes, checked against std::set.  to_handle(i)
+// returns the handle of the node i, and node(i) returns a reference to
+// it.
+//
+template <class T, class To_handle, class Node_ref>
+void tree_test(T &t, To_handle to_handle, Node_ref node)
+  {
+    typedef typename T::handle handle;
+
+    std::set<int> s;
+    unsigned r = 1;
+
+    for (unsigned i = 0; i < Num_nodes; ++i)
+      node(i).key = int(i * 3);
+
+    for (unsigned n = 0; n < 3000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        unsigned i = (r >> 16) % Num_nodes;
+
+        if ((r >> 8) & 1)
+          {
+            // A node must not be inserted if it is already in the tree.
+            if (!s.count(node(i).key))
+              {
+                CHK(t.insert(to_handle(i)) == to_handle(i));
+                s.insert(node(i).key);
+              }
+          }
+        else
+          {
+            handle h = t.remove(node(i).key);
+
+            CHK(
+              h == (s.erase(node(i).key) ? to_handle(i) : t.get_abs().null()));
+          }
+
+        if ((n % 37) == 0)
+          {
+            CHK(t.validate() == s.size());
+
+            typename T::iter it;
+            std::set<int>::const_iterator si = s.begin();
+
+            for (it.start_iter_least(t); *it != t.get_abs().null();
+                 ++it, ++si)
+              CHK(t.get_abs().get_key(*it) == *si);
+            CHK(si == s.end());
+
+            for (unsigned j = 0; j < Num_nodes; ++j)
+              CHK(
+                t.search(node(j).key) ==
+                (s.count(node(j).key) ? to_handle(j) : t.get_abs().null()));
+          }
+      }
+  }
+
+template <class Links>
+void index_test()
+  {
+    typedef Index_abs<Links> A;
+    typedef typename Links::index index;
+
+    static Index_node<Links> nodes[Num_nodes];
+
+    Tree<A> t;
+
+    t.get_abs().node_array = nodes;
+
+    tree_test(
+      t, [](unsigned i) { return(index(i)); },
+      [](unsigned i) -> Index_node<Links> & { return(nodes[i]); });
+  }
+
+int main()
+  {
+    links_test<avl_index_links<std::uint8_t> >();
+    links_test<avl_index_links<std::uint8_t, true> >();
+    links_test<avl_index_links<std::uint16_t> >();
+    links_test<avl_index_links<std::uint16_t, true> >();
+    links_test<avl_index_links<std::uint32_t> >();
+    links_test<avl_index_links<std::uint32_t, true> >();
+    links_test<avl_index_links<std::uint64_t> >();
+
+    CHK(sizeof(avl_index_links<std::uint16_t>) == 4);
+    CHK(sizeof(avl_index_links<std::uint32_t>) == 8);
+    CHK(sizeof(Index_node<avl_index_links<std::uint32_t> >) == 12);
+    CHK((sizeof(void *) != 8) or (sizeof(Ptr_node) == 24));
+    CHK(sizeof(avl_tagged_ptr_links<Ptr_node>) == (2 * sizeof(void *)));
+
+    // Tagged pointers.
+    {
+      static Ptr_node nodes[2];
+      avl_tagged_ptr_links<Ptr_node> l;
+
+      Ptr_node * const vals[] = { nullptr, nodes, nodes + 1 };
+
+      CHK(l.get_less() == nullptr);
+      CHK(l.get_greater() == nullptr);
+      CHK(l.get_balance_factor() == 0);
+
+      for (Ptr_node *lt : vals)
+        for (Ptr_node *gt : vals)
+          for (int bf = -1; bf <= 1; ++bf)
+            {
+              l.set_less(lt);
+              l.set_greater(gt);
+              l.set_balance_factor(bf);
+              CHK(l.get_less() == lt);
+              CHK(l.get_greater() == gt);
+              CHK(l.get_balance_factor() == bf);
+              l.set_greater(lt);
+              l.set_less(gt);
+              CHK(l.get_less() == gt);
+              CHK(l.get_greater() == lt);
+              CHK(l.get_balance_factor() == bf);
+            }
+    }
+
+    index_test<avl_index_links<std::uint8_t> >();
+    index_test<avl_index_links<std::uint8_t, true> >();
+    index_test<avl_index_links<std::uint16_t> >();
+    index_test<avl_index_links<std::uint32_t, true> >();
+
+    {
+      static Ptr_node nodes[Num_nodes];
+
+      Tree<Ptr_abs> t;
+
+      tree_test(
+        t, [](unsigned i) { return(nodes + i); },
+        [](unsigned i) -> Ptr_node & { return(nodes[i]); });
+    }
+
+    return(0);
+  }
@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for avl_mmap.h .
+
+#include "avl_mmap.h"
+#include "avl_mmap.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const char File_name[] = "test_avl_mmap.tmp";
+
+const unsigned Num_nodes = 1000;
+
+struct Node
+  {
+    std::uint64_t key;
+    avl_index_links<std::uint32_t> links;
+  };
+
+typedef avl_index_links<std::uint32_t> Links;
+
+template <bool Checked>
+struct Abs : public avl_mmap_abs<Node, Links, &Node::links, Checked>
+  {
+    typedef std::uint64_t key;
+    typedef std::uint32_t size;
+    typedef std::uint32_t handle;
+
+    int compare_key_node(key k, handle h)
+      {
+        key hk = this->node_array[h].key;
+
+        return((k > hk) - (k < hk));
+      }
+
+    int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(this->node_array[h1].key, h2)); }
+  };
+
+typedef avl_mmap_tree<Abs<false>, 16> Tree;
+
+typedef avl_mmap_tree<Abs<true>, 16> Checked_tree;
+
+// Key of node i.
+std::uint64_t key_of(unsigned i) { return((std::uint64_t(i) << 32) + 2 * i); }
+
+// Check that the tree has the nodes 0 to n - 1 (with keys key_of(i)),
+// and nothing else.
+//
+template <class T>
+void scan(T &t, unsigned n)
+  {
+    for (unsigned i = 0; i < n; ++i)
+      {
+        CHK(t.search(key_of(i)) == i);
+        CHK(t.search(key_of(i) + 1, LESS) == i);
+        CHK(
+          t.search(key_of(i) + 1, GREATER) ==
+          ((i + 1) < n ? i + 1 : t.null()));
+      }
+    CHK(t.search(key_of(n)) == t.null());
+
+    typename T::iter it;
+    unsigned i = 0;
+
+    for (it.start_iter_least(t); *it != t.null(); ++it, ++i)
+      CHK(*it == i);
+    CHK(i == n);
+
+    CHK(!t.read_error());
+  }
+
+int main()
+  {
+    // This abstractor can never report a read error.
+    static_assert(
+      !impl::avl_may_read_error<Abs<false> >::value, "has_read_error");
+    static_assert(
+      impl::avl_may_read_error<Abs<true> >::value, "has_read_error");
+
+    Tree t;
+
+    CHK(!t.open("no_such_directory/no_such_file"));
+
+    // Build a tree in new file.
+    CHK(t.create(File_name, Num_nodes));
+    CHK(t.num_nodes() == Num_nodes);
+    for (unsigned i = 0; i < Num_nodes; ++i)
+      t.get_node(i).key = key_of(i);
+    CHK(t.build_all());
+    scan(t, Num_nodes);
+    t.close();
+    CHK(!t.is_open());
+    CHK(t.search(key_of(0)) == t.null());
+
+    // Reopen read-only.
+    CHK(t.open(File_name));
+    scan(t, Num_nodes);
+
+    // A second tree can map the same file.
+    {
+      Tree t2;
+
+      CHK(t2.open(File_name));
+      scan(t2, Num_nodes);
+    }
+    t.close();
+
+    // Change the tree, in a file opened for writing.
+    CHK(t.open(File_name, true));
+    for (unsigned i = Num_nodes / 2; i < Num_nodes; ++i)
+      CHK(t.remove(key_of(i)) == i);
+    scan(t, Num_nodes / 2);
+    t.close();
+
+    CHK(t.open(File_name));
+    scan(t, Num_nodes / 2);
+    t.close();
+
+    // Insert in random order into a new file.
+    CHK(t.create(File_name, Num_nodes));
+    for (unsigned i = 0; i < Num_nodes; ++i)
+      {
+        unsigned j = (i * 7919) % Num_nodes;
+
+        t.get_node(j).key = key_of(j);
+        CHK(t.insert(j) == j);
+      }
+    CHK(t.commit());
+    t.close();
+
+    CHK(t.open(File_name));
+    scan(t, Num_nodes);
+    t.close();
+
+    // Corrupt a link.  The checked tree detects it.
+    {
+      mapped_file f;
+
+      CHK(f.open(File_name, true));
+
+      Node *n =
+        reinterpret_cast<Node *>(
+          static_cast<char *>(f.data()) + avl_file_header::nodes_offset);
+
+      for (unsigned i = 0; i < Num_nodes; ++i)
+        if (n[i].links.get_less() != Links::null_index)
+          {
+            n[i].links.set_less(Num_nodes + 5);
+            break;
+          }
+
+      CHK(f.sync());
+    }
+
+    {
+      Checked_tree ct;
+
+      CHK(ct.open(File_name));
+
+      unsigned found = 0;
+
+      for (unsigned i = 0; i < Num_nodes; ++i)
+        found += ct.search(key_of(i)) == i;
+
+      // Searches through the bad link fail.
+      CHK((found > 0) and (found < Num_nodes));
+      CHK(!ct.read_error());
+    }
+
+    // Bad header.
+    {
+      mapped_file f;
+
+      CHK(f.open(File_name, true));
+      static_cast<avl_file_header *>(f.data())->node_bytes = 4;
+    }
+    CHK(!t.open(File_name));
+
+    CHK(std::remove(File_name) == 0);
+
+    return(0);
+  }
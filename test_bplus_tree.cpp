@@ -0,0 +1,516 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for bplus_tree.h .
+
+#include "bplus_tree.h"
+#include "bplus_tree.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <utility>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_elem = 600;
+
+// Element keys are even, so odd keys can be used to search between them.
+struct Elem
+  {
+    int key;
+  };
+
+Elem e[Num_elem];
+
+// If non-zero, allocate_node() fails when this count down reaches zero.
+unsigned fail_countdown;
+
+// Number of nodes currently allocated with allocate_node().
+unsigned nodes_in_use;
+
+template <unsigned Node_bytes>
+class Abs
+  {
+  protected:
+
+    typedef Elem * handle;
+    typedef int key;
+    typedef unsigned size;
+
+    static const unsigned node_bytes = Node_bytes;
+
+    static handle null() { return(nullptr); }
+
+    key get_key(handle h) { return(h->key); }
+
+    void * allocate_node()
+      {
+        if (fail_countdown and (--fail_countdown == 0))
+          return(nullptr);
+
+        void *p = ::operator new(node_bytes);
+
+        CHK((reinterpret_cast<std::size_t>(p) % 16) == 0);
+
+        ++nodes_in_use;
+
+        return(p);
+      }
+
+    void free_node(void *p)
+      {
+        --nodes_in_use;
+        ::operator delete(p);
+      }
+  };
+
+// Tree with members to check the validity of its structure.
+//
+template <class Base>
+class Tree : public Base
+  {
+  public:
+
+    typedef typename Base::key key;
+
+    // Check the invariants, and return the number of elements.
+    unsigned validate()
+      {
+        if (!this->root)
+          {
+            CHK(this->height == 0);
+            CHK(this->count_ == 0);
+
+            return(0);
+          }
+
+        prev_leaf = nullptr;
+
+        unsigned n =
+          validate_sub(this->root, this->height, true, nullptr, nullptr);
+
+        CHK(prev_leaf->next == nullptr);
+        CHK(n == this->count_);
+
+        return(n);
+      }
+
+    unsigned levels() { return(this->height); }
+
+  private:
+
+    typedef typename Base::leaf leaf;
+    typedef typename Base::inner inner;
+
+    leaf *prev_leaf;
+
+    // lo and hi, if not null, point to bounds on the keys in the subtree
+    // (lo <= key < hi).
+    unsigned validate_sub(
+      void *p, unsigned lv, bool is_root, const key *lo, const key *hi)
+      {
+        if (lv == 1)
+          {
+            leaf *l = static_cast<leaf *>(p);
+
+            CHK(l->n <= Base::leaf_cap);
+            CHK(l->n >= (is_root ? 1 : Base::leaf_min));
+
+            for (unsigned i = 0; i < l->n; ++i)
+              {
+                CHK(this->get_key(l->h[i]) == l->k[i]);
+
+                if (i)
+                  CHK(l->k[i - 1] < l->k[i]);
+              }
+
+            CHK(!lo or !(l->k[0] < *lo));
+            CHK(!hi or (l->k[l->n - 1] < *hi));
+
+            CHK(l->prev == prev_leaf);
+            if (prev_leaf)
+              {
+                CHK(prev_leaf->next == l);
+                CHK(prev_leaf->k[prev_leaf->n - 1] < l->k[0]);
+              }
+
+            prev_leaf = l;
+
+            return(l->n);
+          }
+
+        inner *in = static_cast<inner *>(p);
+
+        CHK(in->n <= Base::inner_cap);
+        CHK(in->n >= (is_root ? 1 : Base::inner_min));
+
+        unsigned n = 0;
+
+        for (unsigned i = 0; i <= in->n; ++i)
+          {
+            const key *clo = i ? in->k + i - 1 : lo;
+            const key *chi = i < in->n ? in->k + i : hi;
+
+            if (i and (i < in->n))
+              CHK(in->k[i - 1] < in->k[i]);
+
+            n += validate_sub(in->child[i], lv - 1, false, clo, chi);
+          }
+
+        return(n);
+      }
+  };
+
+// Check the tree against the set of keys of the elements in it.
+//
+template <class T>
+void scan(T &t, const std::set<int> &s)
+  {
+    CHK(t.validate() == s.size());
+    CHK(t.count() == s.size());
+    CHK(t.is_empty() == s.empty());
+
+    if (s.empty())
+      {
+        CHK(t.search_least() == nullptr);
+        CHK(t.search_greatest() == nullptr);
+      }
+    else
+      {
+        CHK(t.search_least()->key == *s.begin());
+        CHK(t.search_greatest()->key == *s.rbegin());
+      }
+
+    // Search for every key and every key between them.
+    for (int k = -1; k <= int(2 * Num_elem); ++k)
+      {
+        std::set<int>::const_iterator ge = s.lower_bound(k);
+        std::set<int>::const_iterator gt = s.upper_bound(k);
+
+        bool in = (ge != s.end()) and (*ge == k);
+
+        Elem *h = t.search(k);
+        CHK(in ? (h and (h->key == k)) : !h);
+
+        h = t.search(k, GREATER_EQUAL);
+        CHK(ge == s.end() ? !h : (h and (h->key == *ge)));
+
+        h = t.search(k, GREATER);
+        CHK(gt == s.end() ? !h : (h and (h->key == *gt)));
+
+        h = t.search(k, LESS_EQUAL);
+        CHK(gt == s.begin() ? !h : (h and (h->key == *std::prev(gt))));
+
+        h = t.search(k, LESS);
+        CHK(ge == s.begin() ? !h : (h and (h->key == *std::prev(ge))));
+      }
+
+    // Iterate forward and backward.
+
+    typename T::iter it;
+
+    it.start_iter_least(t);
+    for (std::set<int>::const_iterator si = s.begin(); si != s.end(); ++si)
+      {
+        CHK(*it and ((*it)->key == *si));
+        ++it;
+      }
+    CHK(!*it);
+
+    it.start_iter_greatest(t);
+    for (std::set<int>::const_reverse_iterator si = s.rbegin();
+         si != s.rend(); ++si)
+      {
+        CHK(*it and ((*it)->key == *si));
+        it--;
+      }
+    CHK(!*it);
+
+    if (s.size() > 2)
+      {
+        int mid = *std::next(s.begin(), s.size() / 2);
+
+        it.start_iter(t, mid - 1, GREATER);
+        CHK((*it)->key == mid);
+        ++it;
+        CHK((*it)->key == *s.upper_bound(mid));
+        --it;
+        --it;
+        CHK((*it)->key == *std::prev(s.find(mid)));
+      }
+
+    it.start_iter(t, 1);
+    CHK(!*it);
+  }
+
+template <unsigned Node_bytes>
+void test()
+  {
+    typedef Tree<base_bplus_tree<Abs<Node_bytes> > > T;
+
+    std::cout << "NODE BYTES " << Node_bytes << " LEAF CAP " << T::leaf_cap
+              << " INNER CAP " << T::inner_cap << std::endl;
+
+    T t;
+    std::set<int> s;
+    unsigned r = 1;
+
+    scan(t, s);
+
+    // Random inserts and removes.
+    for (unsigned n = 0; n < 4000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        unsigned i = (r >> 16) % Num_elem;
+
+        if ((r >> 8) & 1)
+          {
+            Elem *h = t.insert(e + i);
+
+            CHK(h == (e + i));
+
+            s.insert(e[i].key);
+          }
+        else
+          {
+            Elem *h = t.remove(e[i].key);
+
+            CHK(h == (s.erase(e[i].key) ? e + i : nullptr));
+          }
+
+        if ((n % 97) == 0)
+          scan(t, s);
+      }
+
+    scan(t, s);
+
+    // Insert duplicate key.
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        Elem dup = e[i];
+
+        t.insert(e + i);
+        CHK(t.insert(&dup) == (e + i));
+      }
+    s.clear();
+    for (unsigned i = 0; i < Num_elem; ++i)
+      s.insert(e[i].key);
+    scan(t, s);
+
+    if (Node_bytes <= 128)
+      CHK(t.levels() > 2);
+
+    // Remove in ascending order, then fill and remove in descending order.
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        CHK(t.remove(e[i].key) == (e + i));
+        s.erase(e[i].key);
+        if ((i % 50) == 0)
+          scan(t, s);
+      }
+    scan(t, s);
+    CHK(nodes_in_use == 0);
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      t.insert(e + i);
+    for (unsigned i = Num_elem; i-- > 0; )
+      {
+        CHK(t.remove(e[i].key) == (e + i));
+        if ((i % 50) == 0)
+          {
+            s.clear();
+            for (unsigned j = 0; j < i; ++j)
+              s.insert(e[j].key);
+            scan(t, s);
+          }
+      }
+    CHK(nodes_in_use == 0);
+
+    // Build.
+
+    Elem *ha[Num_elem];
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      ha[i] = e + i;
+
+    for (unsigned n = 0; n <= Num_elem; n += (n < 40 ? 1 : 37))
+      {
+        CHK(t.build(ha, n));
+
+        s.clear();
+        for (unsigned i = 0; i < n; ++i)
+          s.insert(e[i].key);
+        scan(t, s);
+
+        // Tree is usable after build.
+        if (n > 3)
+          {
+            CHK(t.remove(e[1].key) == (e + 1));
+            s.erase(e[1].key);
+            Elem *h = t.insert(e + Num_elem - 1);
+            CHK(h == (e + Num_elem - 1));
+            s.insert(e[Num_elem - 1].key);
+            scan(t, s);
+          }
+      }
+
+    t.purge();
+    CHK(nodes_in_use == 0);
+
+    // Allocation failures.
+
+    s.clear();
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        fail_countdown = 1 + (i % 3);
+
+        Elem *h = t.insert(e + i);
+
+        if (h)
+          {
+            CHK(h == (e + i));
+            s.insert(e[i].key);
+          }
+      }
+    fail_countdown = 0;
+    CHK(!s.empty() and (s.size() < Num_elem));
+
+    // Fail each allocation in turn, until build() needs fewer nodes than
+    // the count down.
+    unsigned f = 1;
+
+    for ( ; ; ++f)
+      {
+        fail_countdown = f;
+
+        if (t.build(ha, Num_elem))
+          break;
+
+        CHK(nodes_in_use == 0);
+        s.clear();
+        scan(t, s);
+      }
+    fail_countdown = 0;
+
+    CHK(f > 2);
+    CHK(nodes_in_use == (f - 1));
+    t.purge();
+    CHK(nodes_in_use == 0);
+  }
+
+// Key that is not an arithmetic type, so nodes are binary searched.
+//
+typedef std::pair<int, int> Pkey;
+
+class Pair_abs
+  {
+  protected:
+
+    typedef Elem * handle;
+    typedef Pkey key;
+    typedef unsigned size;
+
+    static const unsigned node_bytes = 192;
+
+    static handle null() { return(nullptr); }
+
+    key get_key(handle h) { return(Pkey(h->key / 10, h->key % 10)); }
+  };
+
+void pair_test()
+  {
+    std::cout << "PAIR KEYS" << std::endl;
+
+    bplus_tree<Pair_abs> t;
+
+    for (unsigned i = 0; i < Num_elem; i += 2)
+      CHK(t.insert(e + i) == (e + i));
+    for (unsigned i = Num_elem; i-- > 0; )
+      if (i & 1)
+        CHK(t.insert(e + i) == (e + i));
+
+    CHK(t.count() == Num_elem);
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        Pkey k(e[i].key / 10, e[i].key % 10);
+
+        CHK(t.search(k) == (e + i));
+
+        // Keys of e[i] are 2 * i, so 2 * i + 1 is between elements.
+        k.second += 1;
+        if (k.second < 10)
+          {
+            CHK(!t.search(k));
+            CHK(t.search(k, LESS) == (e + i));
+            CHK(
+              t.search(k, GREATER) ==
+              ((i + 1) < Num_elem ? e + i + 1 : nullptr));
+          }
+      }
+
+    bplus_tree<Pair_abs>::iter it;
+    unsigned i = 0;
+
+    for (it.start_iter_least(t); *it; ++it, ++i)
+      CHK(*it == (e + i));
+    CHK(i == Num_elem);
+
+    for (i = 0; i < Num_elem; i += 3)
+      CHK(t.remove(Pkey(e[i].key / 10, e[i].key % 10)) == (e + i));
+    for (i = 0; i < Num_elem; ++i)
+      CHK(t.search(Pkey(e[i].key / 10, e[i].key % 10)) ==
+          ((i % 3) ? e + i : nullptr));
+  }
+
+int main()
+  {
+    for (unsigned i = 0; i < Num_elem; ++i)
+      e[i].key = int(2 * i);
+
+    CHK(base_bplus_tree<Abs<64> >::leaf_cap == 3);
+    CHK(base_bplus_tree<Abs<64> >::inner_cap == 4);
+
+    test<64>();
+    test<128>();
+    test<256>();
+    test<4096>();
+
+    pair_test();
+
+    return(0);
+  }
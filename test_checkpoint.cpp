@@ -0,0 +1,418 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for checkpoint.h .
+
+#include "checkpoint.h"
+#include "checkpoint.h"
+
+#include "avl_tree.h"
+#include "hash_table.h"
+#include "list.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const char File_name[] = "test_checkpoint.tmp";
+
+const unsigned Num_elem = 5000;
+
+const unsigned Num_buckets = 64;
+
+struct Elem
+  {
+    unsigned key;
+
+    // Tree links.
+    Elem *lt, *gt;
+    int bf;
+    unsigned sz;
+
+    // Hash table link.
+    Elem *hlink;
+  };
+
+// Elements saved from, and elements loaded into.
+Elem src[Num_elem], dst[Num_elem];
+
+unsigned num_loaded;
+
+unsigned long compares, hash_elem_calls, less_sets;
+
+struct Tree_abs
+  {
+    typedef Elem *handle;
+    typedef unsigned key;
+    typedef unsigned size;
+
+    static handle get_less(handle h, bool) { return(h->lt); }
+    static void set_less(handle h, handle lh) { ++less_sets; h->lt = lh; }
+    static handle get_greater(handle h, bool) { return(h->gt); }
+    static void set_greater(handle h, handle gh) { h->gt = gh; }
+    static int get_balance_factor(handle h) { return(h->bf); }
+    static void set_balance_factor(handle h, int bf) { h->bf = bf; }
+
+    static int compare_key_node(key k, handle h)
+      {
+        ++compares;
+
+        return((k > h->key) - (k < h->key));
+      }
+
+    static int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(h1->key, h2)); }
+
+    static handle null() { return(nullptr); }
+
+    static const bool has_read_error = false;
+  };
+
+struct Sized_tree_abs : public Tree_abs
+  {
+    static size get_size(handle h) { return(h->sz); }
+    static void set_size(handle h, size s) { h->sz = s; }
+  };
+
+// Derived class to get at the root.
+template <class abstr>
+class Tree : public avl_tree<abstr>
+  {
+  public:
+
+    Elem * root() { return(this->abs.root); }
+  };
+
+class Hash_abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Elem *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->hlink); }
+        static void link(handle h, handle link_h) { h->hlink = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef unsigned index;
+    typedef unsigned key;
+
+    static const index num_hash_values = Num_buckets;
+
+    static const index min_buckets = 4;
+
+    static const index load_factor = 2;
+
+    bool is_key(key k, Elem *h) { return(h->key == k); }
+
+    index hash_key(key k) { return((k * 2654435761U) % Num_buckets); }
+
+    index hash_elem(Elem *h)
+      {
+        ++hash_elem_calls;
+
+        return(hash_key(h->key));
+      }
+  };
+
+typedef hash_table<Hash_abs> Hash;
+
+typedef linear_hash_table<Hash_abs> Linear_hash;
+
+template <class sink>
+bool save_elem(sink &s, Elem *h) { return(checkpoint_write(s, h->key)); }
+
+bool load_elem(fd_source &s, Elem * &h)
+  {
+    if (num_loaded == Num_elem)
+      return(false);
+
+    h = dst + num_loaded++;
+
+    return(checkpoint_read(s, h->key));
+  }
+
+int open_read()
+  {
+    int fd = ::open(File_name, O_RDONLY);
+
+    CHK(fd >= 0);
+
+    return(fd);
+  }
+
+int open_write()
+  {
+    int fd = ::open(File_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    CHK(fd >= 0);
+
+    return(fd);
+  }
+
+// Checks the subtree with root h, and returns its depth.
+int verify(Elem *h, unsigned lo, unsigned hi)
+  {
+    if (!h)
+      return(0);
+
+    CHK((h >= dst) and (h < (dst + Num_elem)));
+    CHK((h->key > lo) and (h->key < hi));
+
+    int ld = verify(h->lt, lo, h->key), gd = verify(h->gt, h->key, hi);
+
+    CHK(h->bf == (gd - ld));
+
+    return((ld > gd ? ld : gd) + 1);
+  }
+
+// The keys of the elements in the tree are 1, 3, 5, ...
+template <class abstr>
+void fill_tree(Tree<abstr> &t, unsigned n)
+  {
+    t.purge();
+
+    for (unsigned i = 0; i < n; ++i)
+      {
+        src[i].key = (((i * 7919) % n) * 2) + 1;
+        CHK(t.insert(src + i) == (src + i));
+      }
+  }
+
+template <class abstr>
+void check_tree(Tree<abstr> &t, unsigned n)
+  {
+    typename Tree<abstr>::iter it;
+    unsigned i = 0;
+
+    for (it.start_iter_least(t); *it; ++it, ++i)
+      CHK((*it)->key == ((i * 2) + 1));
+    CHK(i == n);
+    verify(t.root(), 0, n * 2);
+  }
+
+template <class abstr, class sink>
+void tree_test(unsigned n)
+  {
+    Tree<abstr> t, t2;
+
+    fill_tree(t, n);
+
+    {
+      int fd = open_write();
+
+      {
+        sink s(fd, 100);
+
+        CHK(save_avl_tree(t, s, save_elem<sink>));
+        CHK(s.flush());
+      }
+
+      ::close(fd);
+    }
+
+    int fd = open_read();
+    fd_source s(fd, 100);
+
+    num_loaded = 0;
+    compares = 0;
+    CHK(load_avl_tree(t2, s, load_elem));
+    CHK(num_loaded == n);
+    CHK(compares == 0);
+    check_tree(t2, n);
+
+    // Nothing after the tree.
+    unsigned char c;
+    CHK(!s.read(&c, 1));
+
+    ::close(fd);
+  }
+
+// The tree, and a hash table with the same elements, in one stream.
+void hash_test()
+  {
+    const unsigned n = 1000;
+
+    Tree<Sized_tree_abs> t, t2;
+    Hash h, h2;
+    Linear_hash lh;
+
+    fill_tree(t, n);
+
+    for (unsigned i = 0; i < n; ++i)
+      h.insert(src + i);
+
+    {
+      int fd = open_write();
+
+      {
+        async_fd_sink s(fd, 64);
+
+        CHK(save_hash_table(h, s, save_elem<async_fd_sink>));
+        CHK(save_avl_tree(t, s, save_elem<async_fd_sink>));
+        CHK(save_hash_table(h, s, save_elem<async_fd_sink>));
+        CHK(s.flush());
+      }
+
+      ::close(fd);
+    }
+
+    int fd = open_read();
+    fd_source s(fd);
+
+    // Into a table with the same buckets, without rehashing.
+    num_loaded = 0;
+    hash_elem_calls = 0;
+    CHK(load_hash_table(h2, s, load_elem));
+    CHK(num_loaded == n);
+    CHK(hash_elem_calls == 0);
+
+    for (unsigned i = 0; i < n; ++i)
+      {
+        Elem *e = h2.search((i * 2) + 1);
+
+        CHK(e and (e >= dst) and (e < (dst + n)));
+        CHK(h2.hash_key(e->key) == h.hash_key(e->key));
+      }
+
+    // Wrong kind.
+    num_loaded = 0;
+    CHK(!load_hash_table(lh, s, load_elem));
+    CHK(num_loaded == 0);
+    ::close(fd);
+
+    fd = open_read();
+
+    fd_source s2(fd);
+
+    num_loaded = 0;
+    CHK(load_hash_table(h2, s2, load_elem));
+    h2.purge();
+
+    num_loaded = 0;
+    compares = 0;
+    CHK(load_avl_tree(t2, s2, load_elem));
+    CHK(compares == 0);
+    CHK(t2.count() == n);
+    check_tree(t2, n);
+
+    // Into a linear hash table, whose number of buckets changes, so the
+    // elements are rehashed.
+    num_loaded = 0;
+    CHK(load_hash_table(lh, s2, load_elem));
+    CHK(num_loaded == n);
+    CHK(lh.count() == n);
+    CHK(lh.num_buckets() == Num_buckets);
+
+    for (unsigned i = 0; i < n; ++i)
+      CHK(lh.search((i * 2) + 1));
+
+    ::close(fd);
+  }
+
+// Loads from a file cut short.
+void short_test()
+  {
+    const unsigned n = 300;
+
+    Tree<Tree_abs> t;
+
+    fill_tree(t, n);
+
+    int fd = open_write();
+
+    {
+      fd_sink s(fd);
+
+      CHK(save_avl_tree(t, s, save_elem<fd_sink>));
+      CHK(s.flush());
+    }
+
+    CHK(::ftruncate(fd, off_t(sizeof(checkpoint_header) + (n * 2))) == 0);
+    ::close(fd);
+
+    fd = open_read();
+
+    fd_source s(fd);
+
+    // The build stops at the first element that fails to load, so only
+    // the elements before it are linked.
+    num_loaded = 0;
+    less_sets = 0;
+    CHK(!load_avl_tree(t, s, load_elem));
+    CHK(t.is_empty());
+    CHK(num_loaded == ((n / 2) + 1));
+    CHK(less_sets < num_loaded);
+    ::close(fd);
+
+    // Header with the wrong magic number.
+    fd = open_write();
+    CHK(::ftruncate(fd, off_t(sizeof(checkpoint_header))) == 0);
+    ::close(fd);
+
+    fd = open_read();
+
+    fd_source s2(fd);
+
+    CHK(!load_avl_tree(t, s2, load_elem));
+    ::close(fd);
+  }
+
+int main()
+  {
+    tree_test<Tree_abs, fd_sink>(0);
+    tree_test<Tree_abs, fd_sink>(1);
+    tree_test<Tree_abs, fd_sink>(2);
+    tree_test<Tree_abs, fd_sink>(Num_elem);
+    tree_test<Sized_tree_abs, fd_sink>(Num_elem);
+    tree_test<Tree_abs, async_fd_sink>(Num_elem - 1);
+    tree_test<Sized_tree_abs, async_fd_sink>(17);
+
+    hash_test();
+    short_test();
+
+    std::remove(File_name);
+
+    return(0);
+  }
@@ -0,0 +1,296 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for concurrent_hash_table.h .  Build with -pthread .
+
+#include "concurrent_hash_table.h"
+#include "concurrent_hash_table.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_keys = 40;
+
+const unsigned Num_buckets = 8;
+
+const unsigned Num_readers = 3;
+
+// Key of an element that has been reclaimed.  Readers must never see it.
+const int Poison = -1;
+
+struct Elem
+  {
+    // Atomic only so the poisoning of reclaimed elements is not a data
+    // race with readers, in the case the table is broken.
+    std::atomic<int> key;
+
+    std::atomic<Elem *> link;
+
+    int k() { return(key.load(std::memory_order_relaxed)); }
+  };
+
+// Number of keys whose elements are never removed in the stress test.
+const unsigned Num_stable = 8;
+
+// Two elements per key, plus the stable elements.
+Elem e[2 * Num_keys + Num_stable];
+
+class Abs
+  {
+  protected:
+
+    typedef Elem *handle;
+    typedef unsigned index;
+    typedef int key;
+
+    static const index num_hash_values = Num_buckets;
+    static const unsigned num_locks = 3;
+    static const unsigned max_readers = Num_readers;
+
+    static handle null() { return(nullptr); }
+
+    static std::atomic<Elem *> & link(handle h) { return(h->link); }
+
+    bool is_key(key k, handle h)
+      {
+        int hk = h->k();
+
+        CHK(hk != Poison);
+
+        return(hk == k);
+      }
+
+    index hash_key(key k) { return(k % Num_buckets); }
+
+    index hash_elem(handle h) { return(hash_key(h->k())); }
+  };
+
+typedef concurrent_hash_table<Abs> Ht;
+
+Ht ht;
+
+// Single-threaded checks.
+//
+void basic_test()
+  {
+    std::cout << "BASIC" << std::endl;
+
+    {
+      Ht::read_guard rg(ht, 0);
+
+      CHK(!Ht::iter(ht));
+      CHK(ht.search(5) == Ht::null());
+    }
+
+    for (unsigned i = 0; i < Num_keys; ++i)
+      {
+        e[i].key = i;
+        ht.insert(e + i);
+      }
+
+    {
+      Ht::read_guard rg(ht, 0);
+
+      for (unsigned i = 0; i < Num_keys; ++i)
+        CHK(ht.search(i) == (e + i));
+
+      CHK(ht.search(Num_keys) == Ht::null());
+
+      unsigned cnt = 0;
+      for (Ht::iter it(ht); it; ++it)
+        {
+          CHK((*it >= e) and (*it < (e + Num_keys)));
+          ++cnt;
+        }
+      CHK(cnt == Num_keys);
+    }
+
+    for (unsigned i = 0; i < Num_keys; i += 2)
+      CHK(ht.remove_key(i) == (e + i));
+
+    CHK(ht.remove_key(0) == Ht::null());
+
+    for (unsigned i = 1; i < Num_keys; i += 4)
+      ht.remove(e + i);
+
+    ht.synchronize();
+
+    {
+      Ht::read_guard rg(ht, 1);
+
+      unsigned cnt = 0;
+      for (Ht::iter it(ht); it; ++it)
+        {
+          CHK(((*it)->k() % 4) == 3);
+          ++cnt;
+        }
+      CHK(cnt == (Num_keys / 4));
+
+      for (unsigned i = 0; i < Num_keys; ++i)
+        CHK((ht.search(i) == Ht::null()) == ((i % 4) != 3));
+    }
+
+    ht.purge();
+    ht.synchronize();
+
+    {
+      Ht::read_guard rg(ht, 2);
+
+      CHK(!Ht::iter(ht));
+    }
+  }
+
+std::atomic<bool> done;
+
+void reader(unsigned slot)
+  {
+    unsigned long n = 0;
+
+    while (!done.load())
+      {
+        Ht::read_guard rg(ht, slot);
+
+        for (unsigned i = 0; i < Num_keys; ++i)
+          {
+            Elem *h = ht.search(i);
+
+            if ((i % 8) == 0)
+              // Give the writer a chance to remove the found element
+              // while in the critical section.
+              std::this_thread::yield();
+
+            // A search may miss an element that is being replaced,
+            // since it can pass the position of the new element before
+            // the old element is removed.
+            CHK((h == Ht::null()) or (h->k() == int(i)));
+          }
+
+        for (unsigned i = 0; i < Num_stable; ++i)
+          CHK(ht.search(Num_keys + i) == (e + (2 * Num_keys) + i));
+
+        if ((++n % 16) == 0)
+          {
+            unsigned cnt = 0;
+            for (Ht::iter it(ht); it; ++it)
+              {
+                CHK((*it)->k() != Poison);
+                ++cnt;
+              }
+            CHK(cnt >= Num_stable);
+          }
+      }
+  }
+
+// Writer replaces the element for each key with the spare element for
+// the key, then reclaims the replaced elements after a grace period.
+// Readers check that they never see a reclaimed element.
+//
+void stress_test()
+  {
+    std::cout << "STRESS" << std::endl;
+
+    for (unsigned i = 0; i < Num_keys; ++i)
+      {
+        e[i].key = i;
+        ht.insert(e + i);
+        e[Num_keys + i].key = Poison;
+      }
+
+    for (unsigned i = 0; i < Num_stable; ++i)
+      {
+        e[(2 * Num_keys) + i].key = Num_keys + i;
+        ht.insert(e + (2 * Num_keys) + i);
+      }
+
+    done = false;
+
+    std::vector<std::thread> rt;
+    for (unsigned i = 0; i < Num_readers; ++i)
+      rt.push_back(std::thread(reader, i));
+
+    unsigned in_table = 0;
+
+    for (unsigned round = 0; round < 20000; ++round)
+      {
+        unsigned spare = Num_keys - in_table;
+
+        for (unsigned i = 0; i < Num_keys; ++i)
+          {
+            e[spare + i].key = i;
+            ht.insert(e + spare + i);
+
+            // remove_key() would find the element just inserted, so
+            // remove the old one by handle.
+            ht.remove(e + in_table + i);
+          }
+
+        ht.synchronize();
+
+        for (unsigned i = 0; i < Num_keys; ++i)
+          e[in_table + i].key = Poison;
+
+        in_table = spare;
+      }
+
+    done = true;
+
+    for (unsigned i = 0; i < Num_readers; ++i)
+      rt[i].join();
+
+    for (unsigned i = 0; i < Num_keys; ++i)
+      CHK(ht.remove_key(i) == (e + in_table + i));
+
+    for (unsigned i = 0; i < Num_stable; ++i)
+      CHK(ht.remove_key(Num_keys + i) == (e + (2 * Num_keys) + i));
+
+    ht.synchronize();
+
+    Ht::read_guard rg(ht, 0);
+
+    CHK(!Ht::iter(ht));
+  }
+
+int main()
+  {
+    basic_test();
+
+    stress_test();
+
+    return(0);
+  }
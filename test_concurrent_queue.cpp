@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for concurrent_queue.h .
+
+#include "concurrent_queue.h"
+#include "concurrent_queue.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_producers = 3;
+
+const unsigned Per_producer = 20000;
+
+struct Elem
+  {
+    unsigned producer, seq;
+
+    std::atomic<std::uint32_t> link;
+  };
+
+// Elements with index handles.
+Elem e[Num_producers * Per_producer + 1];
+
+struct Abs
+  {
+    typedef std::uint32_t handle;
+
+    static handle null() { return(~std::uint32_t(0)); }
+
+    static std::atomic<handle> & link(handle h) { return(e[h].link); }
+  };
+
+typedef mpsc_queue<Abs> Mpsc;
+
+// The last element of e is the stub for mpmc_queue.
+const std::uint32_t Stub = Num_producers * Per_producer;
+
+// Start a thread for each producer, that pushes its elements (in order)
+// to q.
+//
+template <class Q>
+void produce(Q &q, std::vector<std::thread> &t)
+  {
+    for (unsigned p = 0; p < Num_producers; ++p)
+      t.emplace_back(
+        [&q, p]()
+          {
+            for (unsigned i = 0; i < Per_producer; ++i)
+              {
+                std::uint32_t h = (p * Per_producer) + i;
+
+                e[h].producer = p;
+                e[h].seq = i;
+                q.push(h);
+              }
+          });
+  }
+
+void p_list_test()
+  {
+    p_mpsc_queue q;
+    p_mpsc_queue::elem pe[4];
+    p_mpsc_queue::list_type l;
+
+    CHK(q.empty());
+    CHK(q.pop() == nullptr);
+
+    q.push(pe + 0);
+    CHK(!q.empty());
+    CHK(q.pop() == pe + 0);
+    CHK(q.empty());
+    CHK(q.pop() == nullptr);
+
+    for (unsigned i = 0; i < 4; ++i)
+      q.push(pe + i);
+    CHK(q.pop() == pe + 0);
+    q.pop_all(l);
+    CHK(q.empty());
+    CHK(q.pop() == nullptr);
+    q.pop_all(l);
+
+    for (unsigned i = 1; i < 4; ++i)
+      CHK(l.pop() == (pe + i));
+    CHK(l.empty());
+
+    // An element from a list can go back in the queue.
+    l.push(pe + 2);
+    q.push(l.pop());
+    q.push(pe + 1);
+    CHK(pe[2].link() == (pe + 1));
+    CHK(q.pop() == pe + 2);
+    CHK(q.pop() == pe + 1);
+    CHK(q.pop() == nullptr);
+  }
+
+void mpsc_test()
+  {
+    Mpsc q;
+    std::vector<std::thread> t;
+    unsigned next_seq[Num_producers] = { 0 };
+    unsigned n = 0, r = 1;
+    Mpsc::list_type l;
+
+    produce(q, t);
+
+    while (n < (Num_producers * Per_producer))
+      {
+        r = r * 1103515245 + 12345;
+
+        if ((r >> 16) % 16)
+          {
+            std::uint32_t h = q.pop();
+
+            if (h != Abs::null())
+              l.push(h, reverse);
+          }
+        else
+          q.pop_all(l);
+
+        // Elements from each producer are popped in the order pushed.
+        while (!l.empty())
+          {
+            Elem &el = e[l.pop()];
+
+            CHK(el.seq == next_seq[el.producer]);
+            ++next_seq[el.producer];
+            ++n;
+          }
+      }
+
+    for (std::thread &th : t)
+      th.join();
+
+    CHK(q.empty());
+    CHK(q.pop() == Abs::null());
+  }
+
+void mpmc_test()
+  {
+    const unsigned Num_consumers = 3;
+
+    typedef mpmc_queue<Abs> Mpmc;
+
+    Mpmc q(Stub);
+
+    CHK(q.empty());
+    CHK(q.pop() == Abs::null());
+    q.push(5);
+    CHK(!q.empty());
+    CHK(q.pop() == 5);
+    CHK(q.pop() == Abs::null());
+    q.push(5);
+    q.push(6);
+    CHK(q.pop() == 5);
+    q.push(7);
+    CHK(q.pop() == 6);
+    CHK(q.pop() == 7);
+    CHK(q.empty());
+
+    std::vector<std::thread> t;
+
+    // Number of times each element has been popped.
+    static std::atomic<unsigned> times[Num_producers * Per_producer];
+
+    // Total number of pops.  Consumers push popped elements again, until
+    // there have been Total_pops pushes.
+    std::atomic<unsigned> total(0);
+
+    const unsigned Total_pops = 3 * Num_producers * Per_producer;
+
+    for (unsigned c = 0; c < Num_consumers; ++c)
+      t.emplace_back(
+        [&q, &total]()
+          {
+            while (total.load() < Total_pops)
+              {
+                std::uint32_t h = q.pop();
+
+                if (h == Abs::null())
+                  {
+                    std::this_thread::yield();
+                    continue;
+                  }
+
+                CHK(h < Stub);
+                times[h].fetch_add(1);
+
+                if ((total.fetch_add(1) + Num_producers * Per_producer) <
+                    Total_pops)
+                  q.push(h);
+              }
+          });
+
+    produce(q, t);
+
+    for (std::thread &th : t)
+      th.join();
+
+    // Each element was popped once for its first push, and once for each
+    // time it was pushed again.
+    unsigned sum = 0;
+
+    for (unsigned i = 0; i < Stub; ++i)
+      {
+        CHK(times[i] >= 1);
+        sum += times[i];
+      }
+    CHK(sum == Total_pops);
+    CHK(q.pop() == Abs::null());
+    CHK(q.empty());
+  }
+
+int main()
+  {
+    p_list_test();
+    mpsc_test();
+    mpmc_test();
+
+    return(0);
+  }
@@ -0,0 +1,276 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for concurrent_stack.h .
+
+#include "concurrent_stack.h"
+#include "concurrent_stack.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_elems = 10000;
+
+const unsigned Num_threads = 4;
+
+struct Elem
+  {
+    // Number of threads that have popped (or stolen) the element, and not
+    // pushed it again.  Must never be more than 1.
+    std::atomic<unsigned> holders;
+
+    std::atomic<std::uint32_t> link;
+  };
+
+Elem e[Num_elems];
+
+struct Abs
+  {
+    typedef std::uint32_t handle;
+
+    static handle null() { return(~std::uint32_t(0)); }
+
+    static std::atomic<handle> & link(handle h) { return(e[h].link); }
+  };
+
+typedef treiber_stack<Abs> Stack;
+
+typedef work_stealing_deque<Abs, 4> Deque;
+
+void take(std::uint32_t h)
+  {
+    CHK(h < Num_elems);
+    CHK(e[h].holders.fetch_add(1) == 0);
+  }
+
+void give(std::uint32_t h) { e[h].holders.fetch_sub(1); }
+
+void stack_test()
+  {
+    Stack s;
+    Stack::list_type l;
+
+    CHK(s.empty());
+    CHK(s.pop() == s.null());
+
+    s.make_detached(3);
+    CHK(s.is_detached(3));
+
+    for (std::uint32_t i = 0; i < 5; ++i)
+      s.push(i);
+    CHK(!s.is_detached(3));
+    CHK(!s.empty());
+    CHK(s.pop() == 4);
+    CHK(s.pop() == 3);
+    s.push(3);
+    s.pop_all(l);
+    CHK(s.empty());
+    CHK(s.pop() == s.null());
+    s.pop_all(l);
+
+    for (std::uint32_t i = 4; i-- > 0; )
+      CHK(l.pop() == i);
+    CHK(l.empty());
+
+    // Threads pop elements and push them back.
+    for (std::uint32_t i = 0; i < Num_elems; ++i)
+      s.push(i);
+
+    std::vector<std::thread> t;
+
+    for (unsigned i = 0; i < Num_threads; ++i)
+      t.emplace_back(
+        [&s, i]()
+          {
+            std::vector<std::uint32_t> mine;
+            unsigned r = i + 1;
+
+            for (unsigned n = 0; n < 50000; ++n)
+              {
+                r = r * 1103515245 + 12345;
+
+                if (((r >> 16) % 3) and (mine.size() < 50))
+                  {
+                    std::uint32_t h = s.pop();
+
+                    if (h != s.null())
+                      {
+                        take(h);
+                        mine.push_back(h);
+                      }
+                  }
+                else if (!mine.empty())
+                  {
+                    give(mine.back());
+                    s.push(mine.back());
+                    mine.pop_back();
+                  }
+              }
+
+            for (std::uint32_t h : mine)
+              {
+                give(h);
+                s.push(h);
+              }
+          });
+
+    for (std::thread &th : t)
+      th.join();
+
+    // Every element is in the stack once.
+    s.pop_all(l);
+
+    std::vector<bool> seen(Num_elems, false);
+
+    while (!l.empty())
+      {
+        std::uint32_t h = l.pop();
+
+        CHK(!seen[h]);
+        seen[h] = true;
+      }
+    for (bool b : seen)
+      CHK(b);
+  }
+
+void deque_test()
+  {
+    static Deque d;
+
+    CHK(d.empty());
+    CHK(d.pop() == d.null());
+    CHK(d.steal() == d.null());
+
+    d.make_detached(7);
+    CHK(d.is_detached(7));
+
+    for (std::uint32_t i = 0; i < Deque::capacity; ++i)
+      CHK(d.push(i));
+    CHK(!d.push(Deque::capacity));
+    CHK(!d.is_detached(7));
+    CHK(d.size() == Deque::capacity);
+    CHK(d.steal() == 0);
+    CHK(d.steal() == 1);
+    CHK(d.pop() == (Deque::capacity - 1));
+    CHK(d.push(100));
+    CHK(d.push(101));
+    CHK(d.push(102));
+    CHK(!d.push(103));
+    CHK(d.pop() == 102);
+    CHK(d.pop() == 101);
+    CHK(d.pop() == 100);
+    for (std::uint32_t i = 2; i < (Deque::capacity - 1); ++i)
+      CHK(d.steal() == i);
+    CHK(d.pop() == d.null());
+    CHK(d.steal() == d.null());
+
+    // The owner pushes every element once, and pops some of them, while
+    // thieves steal.  Each element must be taken once.
+    std::atomic<unsigned> num_taken(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> t;
+
+    for (unsigned i = 1; i < Num_threads; ++i)
+      t.emplace_back(
+        [&num_taken, &done]()
+          {
+            while (!done.load())
+              {
+                std::uint32_t h = d.steal();
+
+                if (h != d.null())
+                  {
+                    take(h);
+                    num_taken.fetch_add(1);
+                  }
+                else
+                  std::this_thread::yield();
+              }
+          });
+
+    unsigned r = 1;
+
+    for (std::uint32_t i = 0; i < Num_elems; )
+      {
+        r = r * 1103515245 + 12345;
+
+        if ((r >> 16) % 4)
+          {
+            if (d.push(i))
+              ++i;
+          }
+        else
+          {
+            std::uint32_t h = d.pop();
+
+            if (h != d.null())
+              {
+                take(h);
+                num_taken.fetch_add(1);
+              }
+          }
+      }
+
+    for (std::uint32_t h; (h = d.pop()) != d.null(); )
+      {
+        take(h);
+        num_taken.fetch_add(1);
+      }
+
+    // Wait for any steal that is in progress.
+    while (num_taken.load() < Num_elems)
+      std::this_thread::yield();
+
+    done.store(true);
+
+    for (std::thread &th : t)
+      th.join();
+
+    CHK(num_taken.load() == Num_elems);
+    CHK(d.empty());
+  }
+
+int main()
+  {
+    stack_test();
+    deque_test();
+
+    return(0);
+  }
@@ -0,0 +1,380 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for cow_avl_tree.h .
+
+#include "cow_avl_tree.h"
+#include "cow_avl_tree.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_nodes = 20000;
+
+const unsigned Num_keys = 300;
+
+const unsigned Num_readers = 3;
+
+struct Node
+  {
+    int key;
+    unsigned lt, gt, sz;
+    int bf;
+
+    // True while the node is in the free pool.
+    std::atomic<bool> is_free;
+  };
+
+Node node[Num_nodes];
+
+// Free nodes, and retired nodes with the epoch number they were retired
+// for.  Only used by the writer.
+std::vector<unsigned> free_nodes;
+std::vector<std::pair<unsigned, unsigned long> > retired;
+
+unsigned alloc()
+  {
+    CHK(!free_nodes.empty());
+
+    unsigned h = free_nodes.back();
+
+    free_nodes.pop_back();
+    node[h].is_free.store(false, std::memory_order_relaxed);
+
+    return(h);
+  }
+
+struct Abs
+  {
+    typedef unsigned handle;
+    typedef int key;
+    typedef unsigned size;
+
+    static handle get_less(handle h, bool) { return(node[h].lt); }
+    static void set_less(handle h, handle lh) { node[h].lt = lh; }
+    static handle get_greater(handle h, bool) { return(node[h].gt); }
+    static void set_greater(handle h, handle gh) { node[h].gt = gh; }
+    static int get_balance_factor(handle h) { return(node[h].bf); }
+    static void set_balance_factor(handle h, int bf) { node[h].bf = bf; }
+    static size get_size(handle h) { return(node[h].sz); }
+    static void set_size(handle h, size s) { node[h].sz = s; }
+
+    static int compare_key_node(key k, handle h)
+      { return((k > node[h].key) - (k < node[h].key)); }
+
+    static int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(node[h1].key, h2)); }
+
+    static handle null() { return(~0U); }
+
+    static const bool has_read_error = false;
+
+    static handle copy_node(handle h)
+      {
+        unsigned c = alloc();
+
+        node[c].key = node[h].key;
+
+        return(c);
+      }
+
+    static void retire(handle h, unsigned long epoch)
+      { retired.push_back(std::make_pair(h, epoch)); }
+
+    static const unsigned max_readers = Num_readers + 1;
+  };
+
+typedef cow_avl_tree<Abs> Tree;
+
+Tree tree;
+
+// Frees the retired nodes that no reader can be using.
+void reclaim()
+  {
+    unsigned long oldest = tree.oldest_epoch();
+    std::size_t i = 0;
+
+    while (i < retired.size())
+      if (retired[i].second <= oldest)
+        {
+          unsigned h = retired[i].first;
+
+          CHK(!node[h].is_free.load(std::memory_order_relaxed));
+          node[h].key = -1;
+          node[h].is_free.store(true, std::memory_order_relaxed);
+          free_nodes.push_back(h);
+          retired[i] = retired.back();
+          retired.pop_back();
+        }
+      else
+        ++i;
+  }
+
+// Checks the subtree with root h of a snapshot, and returns its depth.
+int verify(unsigned h, int lo, int hi)
+  {
+    if (h == Abs::null())
+      return(0);
+
+    const Node &n = node[h];
+
+    CHK(!n.is_free.load(std::memory_order_relaxed));
+    CHK((n.key > lo) and (n.key < hi));
+
+    int ld = verify(n.lt, lo, n.key), gd = verify(n.gt, n.key, hi);
+
+    CHK(n.bf == (gd - ld));
+    CHK(n.sz ==
+        (1 + (n.lt == Abs::null() ? 0 : node[n.lt].sz) +
+         (n.gt == Abs::null() ? 0 : node[n.gt].sz)));
+
+    return((ld > gd ? ld : gd) + 1);
+  }
+
+// Checks that the snapshot has exactly the keys in model.
+void verify(Tree::read_guard &g, const std::set<int> &model)
+  {
+    Tree::tree_type &t = g.tree();
+    Tree::tree_type::iter it;
+
+    it.start_iter_least(t);
+    for (int k : model)
+      {
+        CHK(*it != Abs::null());
+        CHK(node[*it].key == k);
+        CHK(t.search(k) == *it);
+        ++it;
+      }
+    CHK(*it == Abs::null());
+    CHK(t.count() == model.size());
+    verify(g.root(), -1, int(Num_keys));
+  }
+
+// One writer and no concurrent readers.  Old snapshots must not change.
+void single_test()
+  {
+    std::set<int> model, old_model;
+    unsigned r = 1;
+
+    CHK(tree.is_empty());
+
+    unsigned long e = tree.epoch();
+
+    {
+      Tree::read_guard g(tree, 0);
+
+      CHK(tree.oldest_epoch() == e);
+      CHK(g.tree().is_empty());
+    }
+
+    Tree::read_guard *old = new Tree::read_guard(tree, 1);
+    unsigned long old_epoch = tree.epoch();
+
+    for (unsigned n = 0; n < 20000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        int k = int((r >> 16) % Num_keys);
+
+        if ((r >> 8) % 3)
+          {
+            unsigned h = alloc();
+
+            node[h].key = k;
+            e = tree.epoch();
+
+            unsigned ih = tree.insert(h);
+
+            if (model.count(k))
+              {
+                CHK((ih != h) and (node[ih].key == k));
+                CHK(tree.epoch() == e);
+                node[h].is_free.store(true, std::memory_order_relaxed);
+                free_nodes.push_back(h);
+              }
+            else
+              {
+                CHK(ih == h);
+                CHK(tree.epoch() == (e + 1));
+                model.insert(k);
+              }
+          }
+        else
+          {
+            unsigned rh = tree.remove(k);
+
+            if (model.count(k))
+              {
+                CHK((rh != Abs::null()) and (node[rh].key == k));
+                model.erase(k);
+              }
+            else
+              CHK(rh == Abs::null());
+          }
+
+        // The nodes of the old snapshot are not reclaimed.
+        CHK(tree.oldest_epoch() <= old_epoch);
+        reclaim();
+
+        if ((n % 97) == 0)
+          {
+            verify(*old, old_model);
+
+            {
+              Tree::read_guard g(tree, 0);
+
+              verify(g, model);
+            }
+
+            delete old;
+            old = new Tree::read_guard(tree, 1);
+            old_model = model;
+            old_epoch = tree.epoch();
+          }
+      }
+
+    delete old;
+    reclaim();
+
+    // Remove everything.
+    while (!model.empty())
+      {
+        CHK(tree.remove(*model.begin()) != Abs::null());
+        model.erase(model.begin());
+      }
+    CHK(tree.is_empty());
+    reclaim();
+    CHK(retired.empty());
+    CHK(free_nodes.size() == Num_nodes);
+  }
+
+// One writer thread, and readers that scan snapshots while it changes the
+// tree.
+void concurrent_test()
+  {
+    std::atomic<bool> done(false);
+    std::vector<std::thread> t;
+
+    for (unsigned i = 0; i < Num_readers; ++i)
+      t.emplace_back(
+        [&done, i]()
+          {
+            unsigned scans = 0;
+
+            while (!done.load() or (scans < 10))
+              {
+                Tree::read_guard g(tree, i);
+                Tree::tree_type &s = g.tree();
+                Tree::tree_type::iter it;
+                unsigned n = 0;
+                int last = -1;
+
+                for (it.start_iter_least(s); *it != Abs::null(); ++it)
+                  {
+                    const Node &nd = node[*it];
+
+                    CHK(nd.key > last);
+                    last = nd.key;
+                    CHK(!nd.is_free.load(std::memory_order_relaxed));
+                    ++n;
+                  }
+
+                // The snapshot does not change during the scan.
+                CHK(n == s.count());
+                verify(g.root(), -1, int(Num_keys));
+                ++scans;
+              }
+          });
+
+    std::set<int> model;
+    unsigned r = 7;
+
+    for (unsigned n = 0; n < 100000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        int k = int((r >> 16) % Num_keys);
+
+        if (model.count(k))
+          {
+            CHK(tree.remove(k) != Abs::null());
+            model.erase(k);
+          }
+        else
+          {
+            unsigned h = alloc();
+
+            node[h].key = k;
+            CHK(tree.insert(h) == h);
+            model.insert(k);
+          }
+
+        reclaim();
+      }
+
+    done.store(true);
+
+    for (std::thread &th : t)
+      th.join();
+
+    {
+      Tree::read_guard g(tree, Num_readers);
+
+      verify(g, model);
+    }
+
+    tree.purge();
+    CHK(tree.is_empty());
+  }
+
+int main()
+  {
+    for (unsigned i = 0; i < Num_nodes; ++i)
+      {
+        node[i].is_free.store(true, std::memory_order_relaxed);
+        free_nodes.push_back(Num_nodes - 1 - i);
+      }
+
+    single_test();
+    concurrent_test();
+
+    return(0);
+  }
@@ -63,6 +63,9 @@ struct Elem
 
 Elem e[30];
 
+// Number of calls to Abs::prefetch().
+unsigned prefetches;
+
 class Abs
   {
   private:
@@ -90,6 +93,8 @@ class Abs
     index hash_key(key k) { return(k / 10); }
 
     index hash_elem(Elem *h) { return(h->key / 10); }
+
+    void prefetch(Elem *h) { CHK(h != nullptr); ++prefetches; }
   };
 
 struct Ht : public hash_table<Abs>
@@ -152,10 +157,436 @@ void scan()
 
     CHK(cnt == icnt);
 
+    // Batched search of every key, and some that are not in any bucket
+    // (to have lanes finish at different times).
+    const unsigned Num_keys = 10 * Num_buckets;
+    int k[Num_keys];
+    Elem *out[Num_keys];
+
+    for (unsigned i = 0; i < Num_keys; ++i)
+      k[i] = (i * 7) % Num_keys;
+
+    unsigned p = prefetches;
+
+    ht.search_many(k, Num_keys, out);
+
+    for (unsigned i = 0; i < Num_keys; ++i)
+      CHK(out[i] == ht.search(k[i]));
+
+    CHK((prefetches > p) == (cnt > 0));
+
   } // end scan()
 
 #define SCAN { std::cout << "SCAN line " << __LINE__ << std::endl; scan(); }
 
+// Linear hash table test.
+
+const unsigned Lin_max_buckets = 16;
+
+class Lin_abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Elem *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->link); }
+        static void link(handle h, handle link_h) { h->link = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef unsigned index;
+
+    static const index num_hash_values = Lin_max_buckets;
+    static const index min_buckets = 2;
+    static const index load_factor = 1;
+
+    typedef int key;
+
+    bool is_key(key k, Elem *h) { return(h->key == k); }
+
+    index hash_key(key k) { return(k * 7); }
+
+    index hash_elem(Elem *h) { return(hash_key(h->key)); }
+  };
+
+struct Lht : public linear_hash_table<Lin_abs>
+  {
+    typedef list p_list;
+
+    p_list & p_bucket(index hash_value) { return(bucket(hash_value)); }
+
+    index address(key k) { return(hash_key(k)); }
+  };
+
+Lht lht;
+
+// Check if linear hash table is sane.
+//
+void lin_scan()
+  {
+    unsigned cnt = 0;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      if (!e[i].is_detached())
+        {
+          ++cnt;
+
+          unsigned a = lht.address(e[i].key);
+
+          CHK(a < lht.num_buckets());
+
+          Lht::p_list & b = lht.p_bucket(a);
+
+          Elem *ep = b.start();
+
+          for ( ; ; )
+            {
+              CHK(ep != Lht::null());
+
+              if (ep == (e + i))
+                break;
+
+              ep = b.link(ep);
+            }
+
+          CHK(lht.search(e[i].key) == (e + i));
+        }
+
+    CHK(cnt == lht.count());
+
+    // All elements beyond the initial number of buckets must cause a
+    // bucket split (until the maximum number of buckets).
+    if (cnt <= Lin_max_buckets)
+      CHK(lht.num_buckets() >= cnt);
+
+    unsigned icnt = 0;
+
+    for (Lht::iter it(lht); it; ++it)
+      {
+        ++icnt;
+
+        CHK(!(*it)->is_detached());
+      }
+
+    CHK(cnt == icnt);
+
+    int k[Num_elem + 1];
+    Elem *out[Num_elem + 1];
+
+    for (unsigned i = 0; i <= Num_elem; ++i)
+      k[i] = (i * 11) % (Num_elem + 1);
+
+    lht.search_many(k, Num_elem + 1, out);
+
+    for (unsigned i = 0; i <= Num_elem; ++i)
+      CHK(out[i] == lht.search(k[i]));
+
+  } // end lin_scan()
+
+void linear_test()
+  {
+    std::cout << "LINEAR" << std::endl;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      e[i].make_detached();
+
+    CHK(lht.num_buckets() == 2);
+
+    lin_scan();
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        e[i].key = (i * 11) % Num_elem;
+        lht.insert(e + i);
+        lin_scan();
+      }
+
+    CHK(lht.num_buckets() == Lin_max_buckets);
+
+    for (unsigned i = 0; i < Num_elem; i += 2)
+      {
+        CHK(lht.remove_key(e[i].key) == (e + i));
+        e[i].make_detached();
+        lin_scan();
+      }
+
+    CHK(lht.remove_key(e[0].key) == Lht::null());
+
+    for (unsigned i = 1; i < Num_elem; i += 2)
+      {
+        lht.remove(e + i);
+        e[i].make_detached();
+        lin_scan();
+      }
+
+    CHK(lht.count() == 0);
+
+    for (unsigned i = 0; i < 5; ++i)
+      {
+        e[i].key = i;
+        lht.insert(e + i);
+      }
+
+    lht.purge();
+    CHK(lht.num_buckets() == 2);
+
+    for (unsigned i = 0; i < 5; ++i)
+      e[i].make_detached();
+    lin_scan();
+  }
+
+// Same as Abs, except negative keys all hash to bucket 0.
+//
+class Stats_abs : public Abs
+  {
+  protected:
+
+    index hash_key(key k) { return(k < 0 ? 0 : Abs::hash_key(k)); }
+
+    index hash_elem(Elem *h) { return(hash_key(h->key)); }
+  };
+
+void stats_test()
+  {
+    std::cout << "STATS" << std::endl;
+
+    // The default policy adds nothing to the size.
+    CHK(sizeof(hash_table<Abs>) == sizeof(impl::hash_table_abs<Abs>));
+
+    static hash_table<Stats_abs, hash_count_stats> sht;
+
+    hash_table_stats st = sht.stats();
+
+    CHK(st.num_buckets == Num_buckets);
+    CHK(st.num_elems == 0);
+    CHK(st.empty_buckets == Num_buckets);
+    CHK(st.chain_hist[0] == Num_buckets);
+    CHK(st.max_chain == 0);
+    CHK(st.mean_chain == 0);
+    CHK(st.searches == 0);
+    CHK(st.mean_is_key_calls == 0);
+
+    const int Key[] = { 11, 12, 13, 20, 91, 92 };
+    const unsigned Num_key = sizeof(Key) / sizeof(Key[0]);
+
+    for (unsigned i = 0; i < Num_key; ++i)
+      {
+        e[i].key = Key[i];
+        sht.insert(e + i);
+      }
+
+    // Chains are bucket 1: 13 12 11, bucket 2: 20, bucket 9: 92 91 .
+
+    CHK(sht.search(11) == (e + 0));
+    CHK(sht.search(13) == (e + 2));
+    CHK(sht.search(19) == nullptr);
+    CHK(sht.search(50) == nullptr);
+
+    st = sht.stats();
+
+    CHK(st.searches == 4);
+    CHK(st.is_key_calls == (3 + 1 + 3 + 0));
+    CHK(st.mean_is_key_calls == (7.0 / 4));
+    CHK(st.num_elems == Num_key);
+    CHK(st.empty_buckets == (Num_buckets - 3));
+    CHK(st.max_chain == 3);
+    CHK(st.mean_chain == 2);
+    CHK(st.chain_hist[0] == (Num_buckets - 3));
+    CHK(st.chain_hist[1] == 1);
+    CHK(st.chain_hist[2] == 1);
+    CHK(st.chain_hist[3] == 1);
+    CHK(st.chain_hist[4] == 0);
+
+    // remove_key() is not counted.
+    CHK(sht.remove_key(20) == (e + 3));
+    CHK(sht.searches() == 4);
+
+    sht.reset_stats();
+
+    int k[] = { 91, 50, 12, 21 };
+    Elem *out[4];
+
+    sht.search_many(k, 4, out);
+
+    CHK(out[0] == (e + 4));
+    CHK(out[1] == nullptr);
+    CHK(out[2] == (e + 1));
+    CHK(out[3] == nullptr);
+
+    CHK(sht.searches() == 4);
+    CHK(sht.is_key_calls() == (2 + 0 + 2 + 0));
+
+    // A chain longer than the histogram.
+    sht.purge();
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        e[i].key = -int(i) - 1;
+        sht.insert(e + i);
+      }
+
+    st = sht.stats();
+
+    CHK(st.max_chain == Num_elem);
+    CHK(st.chain_hist[hash_table_stats::hist_size - 1] == 1);
+    CHK(st.empty_buckets == (Num_buckets - 1));
+
+    sht.purge();
+    detach_all();
+  }
+
+// Element for hash tables with bidir_list buckets.
+//
+struct Belem
+  {
+    int key;
+    Belem *link[2];
+  };
+
+Belem be[Num_elem];
+
+class Bidir_abs
+  {
+  protected:
+
+    typedef Belem *handle;
+
+    static handle null() { return(nullptr); }
+
+    static handle link(handle h, bool is_forward)
+      { return(h->link[is_forward]); }
+
+    static void link(handle h, handle link_h, bool is_forward)
+      { h->link[is_forward] = link_h; }
+
+    typedef unsigned index;
+
+    static const index num_hash_values = Num_buckets;
+
+    typedef int key;
+
+    bool is_key(key k, Belem *h) { return(h->key == k); }
+
+    index hash_key(key k) { return(k / 10); }
+
+    index hash_elem(Belem *h) { return(h->key / 10); }
+  };
+
+// Same, but for a linear hash table.
+//
+class Bidir_lin_abs : public Bidir_abs
+  {
+  protected:
+
+    static const index num_hash_values = Lin_max_buckets;
+    static const index min_buckets = 2;
+    static const index load_factor = 1;
+
+    index hash_key(key k) { return(k * 7); }
+
+    index hash_elem(Belem *h) { return(hash_key(h->key)); }
+  };
+
+// Check that the elements of be with in[i] set are the elements of the
+// table, and can be found.
+//
+template <class Table>
+void bidir_scan(Table &t, const bool *in)
+  {
+    unsigned cnt = 0;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        CHK(t.search(be[i].key) == (in[i] ? (be + i) : nullptr));
+        cnt += in[i];
+      }
+
+    unsigned icnt = 0;
+
+    for (typename Table::iter it(t); it; ++it)
+      {
+        CHK(in[*it - be]);
+        ++icnt;
+      }
+
+    CHK(cnt == icnt);
+  }
+
+// Random inserts and removes, by handle and by key.
+//
+template <class Table>
+void bidir_ops(Table &t)
+  {
+    bool in[Num_elem] = { false };
+    unsigned r = 1;
+
+    t.purge();
+
+    // The keys are 40 to 40 + Num_elem - 1.
+    for (unsigned i = 0; i < Num_elem; ++i)
+      be[i].key = int((i * 11) % Num_elem) + 40;
+
+    for (unsigned n = 0; n < 2000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        unsigned i = (r >> 16) % Num_elem;
+
+        if (!in[i])
+          t.insert(be + i);
+        else if ((r >> 8) & 1)
+          t.remove(be + i);
+        else
+          CHK(t.remove_key(be[i].key) == (be + i));
+
+        in[i] = !in[i];
+
+        bidir_scan(t, in);
+      }
+
+    // One more than the greatest key, which must hash to a bucket in use.
+    const int miss = int(Num_elem) + 40;
+
+    CHK(t.hash_key(miss) < t.num_buckets());
+    CHK(t.remove_key(miss) == nullptr);
+  }
+
+void bidir_test()
+  {
+    std::cout << "BIDIR" << std::endl;
+
+    static bidir_hash_table<Bidir_abs> bht;
+
+    bidir_ops(bht);
+
+    // A chain is bucket 4: 42 41 40 .  Remove from the middle, end and
+    // front.
+    bht.purge();
+    for (unsigned i = 0; i < 3; ++i)
+      {
+        be[i].key = 40 + int(i);
+        bht.insert(be + i);
+      }
+    bht.remove(be + 1);
+    CHK(be[2].link[true] == (be + 0));
+    CHK(be[0].link[false] == (be + 2));
+    bht.remove(be + 0);
+    CHK(be[2].link[true] == nullptr);
+    bht.remove(be + 2);
+    CHK(bht.search(40) == nullptr);
+    CHK(bht.search(42) == nullptr);
+
+    static linear_hash_table<impl::bidir_bucket_abs<Bidir_lin_abs> > blht;
+
+    bidir_ops(blht);
+
+    CHK(blht.num_buckets() > 2);
+  }
+
 int main()
   {
     detach_all(); SCAN
@@ -217,5 +648,11 @@ int main()
     I(91)
     I(92)
 
+    linear_test();
+
+    stats_test();
+
+    bidir_test();
+
     return(0);
   }
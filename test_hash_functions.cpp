@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for hash_functions.h .  Build with -msse4.2 (on x86) or
+// +crc (on ARM) to test the hardware CRC32C against the software version.
+
+#include "hash_functions.h"
+#include "hash_functions.h"
+
+#include "hash_table.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+using std::uint32_t;
+using std::uint64_t;
+
+// Pseudo-random number generator.
+uint64_t rand_state = 1;
+
+uint64_t rnd()
+  {
+    rand_state = rand_state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return(rand_state ^ (rand_state >> 29));
+  }
+
+uint32_t crc_sw(const void *data, std::size_t len)
+  {
+    return(
+      ~impl::crc32c_sw(
+        ~uint32_t(0), static_cast<const unsigned char *>(data), len));
+  }
+
+void crc_test()
+  {
+    std::cout << "CRC32C" << std::endl;
+
+    // Check values from RFC 3720 (iSCSI), B.4 .
+
+    unsigned char buf[48];
+
+    const char *digits = "123456789";
+
+    CHK(crc32c(digits, 9) == 0xe3069283);
+    CHK(crc_sw(digits, 9) == 0xe3069283);
+
+    CHK(crc32c(buf, 0) == 0);
+
+    std::memset(buf, 0, 32);
+    CHK(crc32c(buf, 32) == 0x8a9136aa);
+    CHK(crc_sw(buf, 32) == 0x8a9136aa);
+
+    std::memset(buf, 0xff, 32);
+    CHK(crc32c(buf, 32) == 0x62a8ab43);
+    CHK(crc_sw(buf, 32) == 0x62a8ab43);
+
+    for (unsigned i = 0; i < 32; ++i)
+      buf[i] = (unsigned char)(i);
+    CHK(crc32c(buf, 32) == 0x46dd794e);
+    CHK(crc_sw(buf, 32) == 0x46dd794e);
+
+    for (unsigned i = 0; i < 32; ++i)
+      buf[i] = (unsigned char)(31 - i);
+    CHK(crc32c(buf, 32) == 0x113fdb5c);
+    CHK(crc_sw(buf, 32) == 0x113fdb5c);
+
+    // Random data, all lengths and alignments, whole and in pieces.
+    for (unsigned n = 0; n < 2000; ++n)
+      {
+        for (unsigned i = 0; i < sizeof(buf); ++i)
+          buf[i] = (unsigned char)(rnd());
+
+        unsigned off = n % 8;
+        unsigned len = unsigned(rnd() % (sizeof(buf) - off + 1));
+        uint32_t c = crc32c(buf + off, len);
+
+        CHK(c == crc_sw(buf + off, len));
+
+        unsigned split = len ? unsigned(rnd() % (len + 1)) : 0;
+
+        CHK(crc32c(buf + off + split, len - split, crc32c(buf + off, split)) ==
+            c);
+      }
+  }
+
+void reduce_test()
+  {
+    std::cout << "REDUCE" << std::endl;
+
+    CHK(reduce_range32(0, 100) == 0);
+    CHK(reduce_range32(~uint32_t(0), 100) == 99);
+    CHK(reduce_range32(~uint32_t(0), ~uint32_t(0)) == (~uint32_t(0) - 1));
+    CHK(reduce_range32(uint32_t(1) << 31, 7) == 3);
+
+    CHK(reduce_range64(0, 100) == 0);
+    CHK(reduce_range64(~uint64_t(0), 100) == 99);
+    CHK(reduce_range64(~uint64_t(0), ~uint64_t(0)) == (~uint64_t(0) - 1));
+    CHK(reduce_range64(uint64_t(1) << 63, 7) == 3);
+
+    for (unsigned i = 0; i < 100000; ++i)
+      {
+        uint64_t h = rnd(), n = rnd();
+
+        if (i & 1)
+          n >>= (i >> 1) % 64;
+
+        uint64_t r = reduce_range64(h, n);
+
+        CHK(r == impl::mul_high64(h, n));
+        CHK((n == 0) or (r < n));
+
+        #if defined(__SIZEOF_INT128__)
+        __extension__ typedef unsigned __int128 uint128;
+
+        CHK(r == uint64_t((uint128(h) * n) >> 64));
+        #endif
+
+        uint32_t h32 = uint32_t(h), n32 = uint32_t(n);
+
+        CHK(reduce_range32(h32, n32) == ((uint64_t(h32) * n32) >> 32));
+      }
+  }
+
+const unsigned Num_buckets = 64;
+
+// Checks that sequential keys are spread evenly over the buckets.
+//
+template <class Hash_fn>
+void spread_test(Hash_fn hash_fn)
+  {
+    const unsigned Num_keys = 64 * 1024;
+
+    unsigned cnt[Num_buckets] = { 0 };
+
+    for (uint64_t k = 0; k < Num_keys; ++k)
+      ++cnt[hash_fn(k)];
+
+    for (unsigned i = 0; i < Num_buckets; ++i)
+      CHK((cnt[i] > (Num_keys / Num_buckets) * 3 / 4) and
+          (cnt[i] < (Num_keys / Num_buckets) * 5 / 4));
+  }
+
+uint32_t crc_bucket(uint64_t k)
+  { return(reduce_range32(crc32c_hash<uint64_t>()(k), Num_buckets)); }
+
+uint32_t mix_bucket(uint64_t k)
+  { return(uint32_t(reduce_range64(mix64_hash()(k), Num_buckets))); }
+
+struct Elem
+  {
+    uint64_t key;
+    Elem *link;
+  };
+
+const unsigned Num_elem = 1000;
+
+Elem e[Num_elem];
+
+// Abstractor for base_hash_table using the hash functions.
+//
+class Abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Elem *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->link); }
+        static void link(handle h, handle link_h) { h->link = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef unsigned index;
+    typedef uint64_t key;
+
+    static const index num_hash_values = 97;
+
+    index hash_key(key k)
+      { return(reduce_range32(crc32c_hash<key>()(k), num_hash_values)); }
+
+    index hash_elem(Elem *h) { return(hash_key(h->key)); }
+
+    bool is_key(key k, Elem *h) { return(h->key == k); }
+
+    list & bucket(index hv) { return(table[hv]); }
+
+  private:
+
+    list table[num_hash_values];
+  };
+
+void table_test()
+  {
+    std::cout << "TABLE" << std::endl;
+
+    static base_hash_table<Abs> ht;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        e[i].key = uint64_t(i) << 32;
+        ht.insert(e + i);
+      }
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      CHK(ht.search(uint64_t(i) << 32) == (e + i));
+
+    CHK(ht.search(1) == nullptr);
+  }
+
+int main()
+  {
+    crc_test();
+
+    reduce_test();
+
+    CHK(mix64(0) == 0);
+    CHK(mix64(1) != mix64(2));
+
+    spread_test(crc_bucket);
+    spread_test(mix_bucket);
+
+    table_test();
+
+    return(0);
+  }
@@ -19,8 +19,13 @@ SOFTWARE.
 
 // Unit testing for list.h and bidir_list.h .
 
+#ifndef BIDIR
 #define BIDIR 1
+#endif
+
+#ifndef STORE_TAIL
 #define STORE_TAIL true
+#endif
 
 #if BIDIR
 
@@ -95,6 +100,11 @@ void scan()
           #if BIDIR
           CHK(lst.link(e + i, reverse) == last);
           #endif
+          CHK(lst.link<reverse>(e + i) == last);
+          if (last)
+            CHK(lst.link<forward>(last) == (e + i));
+          else
+            CHK(lst.start<forward>() == (e + i));
           if (last)
             CHK(lst.link(last) == (e + i));
           else
@@ -103,6 +113,7 @@ void scan()
         }
 
     CHK(lst.start(reverse) == last);
+    CHK(lst.start<reverse>() == last);
     CHK(lst.empty() == (last == nullptr));
     if (last)
       CHK(lst.link(last) == nullptr); 
@@ -112,6 +123,105 @@ void scan()
 
 #define SCAN { std::cout << "SCAN line " << __LINE__ << std::endl; scan(); }
 
+const unsigned num_f = 8;
+
+elem_t f[num_f];
+
+// Check that the elements of l, from first to last in the forward
+// direction, are f[expect[0] - '0'], f[expect[1] - '0'], ...
+//
+void contents(list_t &l, const char *expect)
+  {
+    elem_t *h = static_cast<elem_t *>(l.start()), *last = nullptr;
+
+    for ( ; *expect; ++expect)
+      {
+        CHK(h == (f + (*expect - '0')));
+        CHK(l.link(h, reverse) == last);
+        last = h;
+        h = static_cast<elem_t *>(l.link(h));
+      }
+
+    CHK(h == nullptr);
+    CHK(l.start(reverse) == last);
+    CHK(l.empty() == (last == nullptr));
+  }
+
+// Make l contain the elements f[*s - '0'] ... in forward order.
+//
+void fill(list_t &l, const char *s)
+  {
+    l.purge();
+
+    for ( ; *s; ++s)
+      l.push(f + (*s - '0'), reverse);
+  }
+
+// Splice, range remove and split.
+//
+void multi_test()
+  {
+    list_t l1, l2;
+
+    // Push a list.
+    fill(l1, "012"); fill(l2, "345");
+    l1.push(l2); contents(l1, "345012"); contents(l2, "");
+    fill(l2, "67");
+    l1.push(l2, reverse); contents(l1, "34501267"); contents(l2, "");
+    l1.push(l2); contents(l1, "34501267");
+    l2.push(l1, reverse); contents(l2, "34501267"); contents(l1, "");
+    l1.push(l2); contents(l1, "34501267"); contents(l2, "");
+
+    // Insert a list.
+    fill(l1, "012"); fill(l2, "345");
+    l1.insert(f + 1, l2); contents(l1, "013452"); contents(l2, "");
+    fill(l2, "67");
+    l1.insert(f + 2, l2); contents(l1, "01345267");
+    fill(l1, "012"); fill(l2, "345");
+    l1.insert(f + 1, l2, reverse); contents(l1, "034512");
+    fill(l2, "67");
+    l1.insert(f + 0, l2, reverse); contents(l1, "67034512");
+    l1.insert(f + 0, l2, reverse); contents(l1, "67034512");
+
+    // Remove a range.
+    fill(l1, "01234567");
+    l1.remove(f + 2, f + 4); contents(l1, "01567");
+    l1.remove(f + 0, f + 0); contents(l1, "1567");
+    l1.remove(f + 6, f + 7); contents(l1, "15");
+    l1.remove(f + 1, f + 5); contents(l1, "");
+    l1.push(f + 3); contents(l1, "3");
+
+    #if !BIDIR
+    fill(l1, "01234567");
+    l1.remove_forward(f + 0, f + 3); contents(l1, "04567");
+    l1.remove_forward(f + 5, f + 7); contents(l1, "045");
+    #endif
+
+    // Split.
+    fill(l1, "01234567");
+    {
+      list_t l3(l1, f + 2, f + 5);
+
+      contents(l1, "0167"); contents(l3, "2345");
+
+      list_t l4(l3, f + 2, f + 2);
+
+      contents(l3, "345"); contents(l4, "2");
+
+      list_t l5(l1, f + 6, f + 7);
+
+      contents(l1, "01"); contents(l5, "67");
+
+      list_t l6(l1, f + 0, f + 1);
+
+      contents(l1, ""); contents(l6, "01");
+
+      // Join them back together.
+      l6.push(l4, reverse); l6.push(l3, reverse); l6.push(l5, reverse);
+      contents(l6, "01234567");
+    }
+  }
+
 int main()
   {
     #if BIDIR or STORE_TAIL
@@ -172,8 +282,22 @@ int main()
     lst.pop(reverse); lst.make_detached(e + 3); SCAN
     lst.pop(); lst.make_detached(e + 1); SCAN
 
+    // Direction as a template parameter.
+    CHK(lst.pop<forward>() == (e + 2)); lst.make_detached(e + 2); SCAN
+    CHK(lst.empty());
+    lst.push<reverse>(e + 2); SCAN
+    lst.push<forward>(e + 1); SCAN
+    lst.insert<forward>(e + 2, e + 3); SCAN
+    lst.insert<reverse>(e + 1, e + 0); SCAN
+    CHK(lst.pop<reverse>() == (e + 3)); lst.make_detached(e + 3); SCAN
+    CHK(lst.pop<forward>() == (e + 0)); lst.make_detached(e + 0); SCAN
+    CHK(lst.pop<reverse>() == (e + 2)); lst.make_detached(e + 2); SCAN
+    CHK(lst.pop<forward>() == (e + 1)); lst.make_detached(e + 1); SCAN
+
     lst.purge();
     CHK(lst.empty());
 
+    multi_test();
+
     return(0);
   }
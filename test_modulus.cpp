@@ -27,6 +27,7 @@ SOFTWARE.
 #include <cstdint>
 
 void second_test();
+void batch_test();
 
 using std::uint8_t;
 using std::uint16_t;
@@ -34,6 +35,7 @@ using std::uint32_t;
 using std::cout;
 using std::endl;
 using abstract_container::modulus_hash;
+using abstract_container::modulus_hash_n;
 
 struct Tr
   {
@@ -125,6 +127,8 @@ int main()
 
     second_test();
 
+    batch_test();
+
     return(0);
   }
 
@@ -163,3 +167,156 @@ void second_test()
     if (m1 != h1) cout << "FAIL 1\n";
     if (m2 != h2) cout << "FAIL 2\n";
   }
+
+// Pseudo-random number generator.
+uint32_t rand_state = 1;
+
+uint32_t rnd()
+  {
+    rand_state = rand_state * 1103515245 + 12345;
+
+    return((rand_state >> 16) ^ (rand_state << 16));
+  }
+
+// Terms summed in 64 bits.
+struct Tr3
+  {
+    typedef uint16_t modulus_t;
+    typedef uint32_t product_t;
+
+    static const unsigned key_segment_bits = 15;
+    static const unsigned num_key_segments = 6;
+    static const modulus_t modulus = 65521;
+
+    typedef const uint16_t *key;
+
+    template<unsigned Key_segment> static uint16_t get_segment(key k)
+      { return(k[Key_segment] & 0x7fff); }
+  };
+
+// Sum of terms could overflow 64 bits, so no lazy reduction.
+struct Tr4
+  {
+    typedef uint32_t modulus_t;
+    typedef uint64_t product_t;
+
+    static const unsigned key_segment_bits = 31;
+    static const unsigned num_key_segments = 4;
+    static const modulus_t modulus = 4294967291U;
+
+    typedef const uint32_t *key;
+
+    template<unsigned Key_segment> static uint32_t get_segment(key k)
+      { return(k[Key_segment] & 0x7fffffff); }
+  };
+
+// Modulus hash of all segments of a key that is an array of segments,
+// calculated the naive way.
+//
+template <class Traits>
+uint64_t ref_hash(typename Traits::key k)
+  {
+    const uint64_t Mask = (uint64_t(1) << Traits::key_segment_bits) - 1;
+
+    uint64_t h = 0;
+
+    // Horner's rule, from the most significant segment.
+    for (unsigned s = Traits::num_key_segments; s > 0; --s)
+      h = ((h << Traits::key_segment_bits) + (k[s - 1] & Mask)) %
+          Traits::modulus;
+
+    return(h);
+  }
+
+const unsigned Max_batch = 200;
+
+// Check modulus_hash() against the naive calculation and the
+// reduce-every-segment calculation in impl::modulus_hash, and
+// modulus_hash_n() against modulus_hash(), for batches of 0 to Max_batch
+// keys.
+//
+template <class Traits, typename Seg>
+void batch_test1(const char *name, bool lazy)
+  {
+    typedef abstract_container::impl::modulus_hash<
+      Traits, Traits::num_key_segments - 1> Mh;
+
+    if (abstract_container::impl::modulus_hash_acc<Traits>::lazy != lazy)
+      cout << "FAIL lazy " << name << '\n';
+
+    static Seg data[Max_batch][Traits::num_key_segments];
+
+    static typename Traits::key k[Max_batch];
+
+    typename Traits::modulus_t out[Max_batch + 1];
+
+    for (unsigned i = 0; i < Max_batch; ++i)
+      {
+        for (unsigned j = 0; j < Traits::num_key_segments; ++j)
+          data[i][j] = Seg(rnd());
+
+        // All bits set in some keys.
+        if ((i % 17) == 0)
+          for (unsigned j = 0; j < Traits::num_key_segments; ++j)
+            data[i][j] = Seg(~Seg(0));
+
+        k[i] = data[i];
+
+        if ((modulus_hash<Traits>(k[i]) != ref_hash<Traits>(k[i])) or
+            (modulus_hash<Traits>(k[i]) != Mh::val(k[i])))
+          {
+            cout << "FAIL ref " << name << ' ' << i << '\n';
+            return;
+          }
+
+        for (unsigned c = 1; c <= Traits::num_key_segments; ++c)
+          if (modulus_hash<Traits>(k[i], c) != Mh::val(k[i], c))
+            {
+              cout << "FAIL count " << name << ' ' << i << ' ' << c << '\n';
+              return;
+            }
+      }
+
+    for (unsigned n = 0; n <= Max_batch; ++n)
+      {
+        // Guard value past the last key.
+        out[n] = 1;
+
+        modulus_hash_n<Traits>(k, n, out);
+
+        for (unsigned i = 0; i < n; ++i)
+          if (out[i] != modulus_hash<Traits>(k[i]))
+            {
+              cout << "FAIL batch " << name << ' ' << n << ' ' << i << '\n';
+              return;
+            }
+
+        if (out[n] != 1)
+          cout << "FAIL batch overrun " << name << ' ' << n << '\n';
+      }
+  }
+
+void batch_test()
+  {
+    batch_test1<Tr, uint16_t>("Tr", true);
+    batch_test1<Tr3, uint16_t>("Tr3", true);
+    batch_test1<Tr4, uint32_t>("Tr4", false);
+
+    // Keys that are integers rather than arrays.
+
+    uint64_t k2[Max_batch];
+    Tr2::modulus_t out[Max_batch];
+
+    for (unsigned i = 0; i < Max_batch; ++i)
+      k2[i] = (uint64_t(rnd()) << 32) + rnd();
+
+    modulus_hash_n<Tr2>(k2, Max_batch, out);
+
+    for (unsigned i = 0; i < Max_batch; ++i)
+      if ((out[i] != modulus_hash<Tr2>(k2[i])) or
+          (out[i] != (k2[i] % Tr2::modulus)))
+        {
+          cout << "FAIL batch Tr2 " << i << '\n';
+          break;
+        }
+  }
@@ -0,0 +1,237 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for multi_index.h .
+
+#include "multi_index.h"
+#include "multi_index.h"
+
+#include "avl_tree.h"
+#include "hash_table.h"
+#include "list.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_elem = 200;
+
+const unsigned Num_buckets = 16;
+
+// Element with an ID (the hash table key), and an expiry time (the tree
+// key).
+//
+struct Session
+  {
+    unsigned id;
+    int expiry;
+
+    // Hash table link.
+    Session *hlink;
+
+    // Tree links.
+    Session *lt, *gt;
+    int bf;
+  };
+
+Session e[Num_elem];
+
+class Hash_abs
+  {
+  private:
+
+    struct List_abs
+      {
+        static const bool store_tail = false;
+        typedef Session *handle;
+        static handle null() { return(nullptr); }
+        static handle link(handle h) { return(h->hlink); }
+        static void link(handle h, handle link_h) { h->hlink = link_h; }
+      };
+
+  protected:
+
+    typedef abstract_container::list<List_abs> list;
+    typedef unsigned index;
+    typedef unsigned key;
+
+    static const index num_hash_values = Num_buckets;
+
+    bool is_key(key k, Session *h) { return(h->id == k); }
+
+    index hash_key(key k) { return(k % Num_buckets); }
+
+    index hash_elem(Session *h) { return(hash_key(h->id)); }
+  };
+
+struct Tree_abs
+  {
+    typedef Session *handle;
+    typedef int key;
+    typedef unsigned size;
+
+    static handle get_less(handle h, bool) { return(h->lt); }
+    static void set_less(handle h, handle lh) { h->lt = lh; }
+    static handle get_greater(handle h, bool) { return(h->gt); }
+    static void set_greater(handle h, handle gh) { h->gt = gh; }
+    static int get_balance_factor(handle h) { return(h->bf); }
+    static void set_balance_factor(handle h, int bf) { h->bf = bf; }
+
+    static int compare_key_node(key k, handle h)
+      { return((k > h->expiry) - (k < h->expiry)); }
+
+    static int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(h1->expiry, h2)); }
+
+    static handle null() { return(nullptr); }
+
+    static const bool has_read_error = false;
+  };
+
+typedef avl_tree<Tree_abs> Tree;
+
+typedef multi_index<hash_table<Hash_abs>, Tree> Sessions;
+
+Sessions s;
+
+// IDs of the sessions in s, by expiry.
+std::map<int, unsigned> model;
+
+// Check that s has the elements in model, and no others.
+//
+void verify()
+  {
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        bool in = model.count(e[i].expiry) and
+                  (model[e[i].expiry] == e[i].id);
+
+        CHK(s.hash_index().search(e[i].id) == (in ? e + i : nullptr));
+        CHK(s.tree_index().search(e[i].expiry) == (in ? e + i : nullptr));
+        n += in;
+      }
+
+    CHK(n == model.size());
+
+    Tree::iter it;
+    auto mi = model.begin();
+
+    for (it.start_iter_least(s.tree_index()); *it; ++it, ++mi)
+      {
+        CHK(mi != model.end());
+        CHK((*it)->expiry == mi->first);
+      }
+    CHK(mi == model.end());
+    CHK(s.is_empty() == model.empty());
+  }
+
+int main()
+  {
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        e[i].id = 1000 + i * 7;
+        e[i].expiry = int((i * 37) % Num_elem);
+      }
+
+    verify();
+
+    unsigned r = 1;
+
+    for (unsigned n = 0; n < 20000; ++n)
+      {
+        r = r * 1103515245 + 12345;
+
+        Session *h = e + ((r >> 16) % Num_elem);
+        bool in = s.hash_index().search(h->id) == h;
+
+        switch ((r >> 8) % 4)
+          {
+          case 0:
+          case 1:
+            if (!in)
+              {
+                CHK(s.insert(h) == h);
+                model[h->expiry] = h->id;
+              }
+            break;
+
+          case 2:
+            if (in)
+              {
+                s.remove(h);
+                model.erase(h->expiry);
+              }
+            break;
+
+          default:
+            if ((r >> 4) & 1)
+              CHK(s.remove_hash_key(h->id) == (in ? h : nullptr));
+            else
+              CHK(s.remove_tree_key(h->expiry) == (in ? h : nullptr));
+            model.erase(h->expiry);
+          }
+
+        if ((n % 97) == 0)
+          verify();
+      }
+
+    verify();
+
+    // An element with the same tree key as one already in is not
+    // inserted.
+    {
+      static Session dup;
+
+      if (model.empty())
+        CHK(s.insert(e) == e);
+
+      Session *in = s.tree_index().search_least();
+
+      dup.id = 1;
+      dup.expiry = in->expiry;
+      CHK(s.insert(&dup) == in);
+      CHK(s.hash_index().search(1) == nullptr);
+      CHK(s.remove_hash_key(1) == nullptr);
+    }
+
+    s.purge();
+    model.clear();
+    verify();
+
+    return(0);
+  }
@@ -0,0 +1,321 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for node_pool.h .
+
+#include "node_pool.h"
+#include "node_pool.h"
+
+#include "avl_links.h"
+#include "avl_tree.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+// Element that counts constructions and destructions.
+//
+struct Counted
+  {
+    static int live;
+
+    unsigned val;
+
+    Counted() : val(12345) { ++live; }
+
+    ~Counted() { --live; }
+  };
+
+int Counted::live;
+
+struct alignas(64) Line_elem
+  {
+    unsigned val;
+  };
+
+struct Node
+  {
+    std::uint32_t key;
+    avl_index_links<std::uint32_t> links;
+  };
+
+typedef avl_index_links<std::uint32_t> Links;
+
+struct Abs : public avl_array_abs<Node, Links, &Node::links>
+  {
+    typedef std::uint32_t key;
+    typedef std::uint32_t size;
+
+    int compare_key_node(key k, handle h)
+      {
+        key hk = node_array[h].key;
+
+        return((k > hk) - (k < hk));
+      }
+
+    int compare_node_node(handle h1, handle h2)
+      { return(compare_key_node(node_array[h1].key, h2)); }
+
+    static bool read_error() { return(false); }
+  };
+
+class Tree : public avl_tree<Abs>
+  {
+  public:
+
+    void set_nodes(Node *n) { abs.node_array = n; }
+  };
+
+const unsigned Cap = 1000;
+
+// Allocate all the elements of a pool, checking that the handles are
+// distinct elements of the arena.
+//
+template <class Pool, class Alloc>
+void alloc_all(Pool &p, Alloc alloc, std::vector<bool> &used)
+  {
+    used.assign(p.capacity(), false);
+
+    for (unsigned i = 0; i < p.capacity(); ++i)
+      {
+        auto h = alloc();
+
+        CHK(h < p.capacity());
+        CHK(!used[h]);
+        used[h] = true;
+        CHK(p.handle_of(&p[h]) == h);
+      }
+
+    CHK(alloc() == p.null());
+  }
+
+void thread_test()
+  {
+    const unsigned Num_threads = 4, Per_thread = 200;
+
+    node_pool<unsigned> p;
+
+    CHK(p.init(Num_threads * Per_thread));
+
+    std::vector<std::thread> t;
+    bool ok[Num_threads];
+
+    for (unsigned i = 0; i < Num_threads; ++i)
+      t.emplace_back(
+        [&p, &ok, i]()
+          {
+            node_pool<unsigned>::cache c(p, 8);
+            std::vector<unsigned> mine;
+            unsigned r = i + 1;
+
+            ok[i] = true;
+
+            for (unsigned n = 0; n < 20000; ++n)
+              {
+                r = r * 1103515245 + 12345;
+
+                if (((r >> 16) & 1) and (mine.size() < Per_thread))
+                  {
+                    unsigned h = c.alloc();
+
+                    if (h == p.null())
+                      {
+                        ok[i] = false;
+                        break;
+                      }
+
+                    p[h] = i;
+                    mine.push_back(h);
+                  }
+                else if (!mine.empty())
+                  {
+                    unsigned h = mine.back();
+
+                    mine.pop_back();
+
+                    // No other thread was given this element.
+                    if (p[h] != i)
+                      ok[i] = false;
+
+                    // Alternate between the cache and the pool.
+                    if (n & 2)
+                      c.free(h);
+                    else
+                      p.free(h);
+                  }
+              }
+
+            for (unsigned h : mine)
+              c.free(h);
+          });
+
+    for (std::thread &th : t)
+      th.join();
+
+    for (unsigned i = 0; i < Num_threads; ++i)
+      CHK(ok[i]);
+
+    // All the elements have been returned to the pool.
+    std::vector<bool> used;
+
+    alloc_all(p, [&p]() { return(p.alloc()); }, used);
+  }
+
+int main()
+  {
+    {
+      node_pool<Counted> p;
+
+      CHK(p.capacity() == 0);
+      CHK(p.alloc() == p.null());
+
+      CHK(!p.init(p.null() + 1u));
+      CHK(p.init(Cap));
+      CHK(p.capacity() == Cap);
+      CHK((reinterpret_cast<std::uintptr_t>(p.data()) % 64) == 0);
+
+      std::vector<bool> used;
+
+      alloc_all(p, [&p]() { return(p.alloc()); }, used);
+      CHK(Counted::live == int(Cap));
+      CHK(p[0].val == 12345);
+
+      // Freed elements are reused.
+      p.free(7);
+      p.free(500);
+      CHK(Counted::live == int(Cap - 2));
+      {
+        unsigned a = p.alloc(), b = p.alloc();
+
+        CHK(((a == 7) and (b == 500)) or ((a == 500) and (b == 7)));
+      }
+      CHK(p.alloc() == p.null());
+
+      // Caches.
+      {
+        node_pool<Counted>::cache c1(p, 4), c2(p);
+
+        for (unsigned i = 0; i < 100; ++i)
+          c1.free(i);
+        CHK(Counted::live == int(Cap - 100));
+
+        // c1 gave all but the last batch of up to 8 back to the pool.
+        unsigned n = 0;
+
+        while (c2.alloc() != p.null())
+          ++n;
+        CHK((n >= 92) and (n < 100));
+
+        unsigned h = c1.alloc();
+
+        CHK(h != p.null());
+        c1.free(h);
+        CHK(Counted::live == int(Cap - 100 + n));
+      }
+
+      // Bulk free.  Does not call destructors.
+      int live = Counted::live;
+
+      p.reset();
+      CHK(Counted::live == live);
+      Counted::live = 0;
+      alloc_all(p, [&p]() { return(p.alloc()); }, used);
+      CHK(Counted::live == int(Cap));
+
+      {
+        node_pool<Counted>::cache c(p);
+
+        CHK(c.alloc() == p.null());
+      }
+
+      p.release();
+      CHK(p.capacity() == 0);
+    }
+
+    {
+      node_pool<Line_elem, std::uint16_t> p;
+
+      CHK(p.init(Cap));
+
+      node_pool<Line_elem, std::uint16_t>::cache c(p, 3);
+      std::vector<bool> used;
+
+      alloc_all(p, [&c]() { return(c.alloc()); }, used);
+      for (unsigned i = 0; i < Cap; ++i)
+        CHK((reinterpret_cast<std::uintptr_t>(&p[i]) % 64) == 0);
+    }
+
+    // The pool as the node array of an AVL tree.
+    {
+      node_pool<Node> p;
+      Tree t;
+
+      CHK(p.init(Cap));
+      t.set_nodes(p.data());
+
+      for (unsigned pass = 0; pass < 2; ++pass)
+        {
+          for (unsigned i = 0; i < Cap; ++i)
+            {
+              std::uint32_t h = p.alloc();
+
+              p[h].key = (i * 7919) % Cap;
+              CHK(t.insert(h) == h);
+            }
+
+          CHK(p.alloc() == p.null());
+
+          for (unsigned i = 0; i < Cap; ++i)
+            CHK(p[t.search(i)].key == i);
+
+          for (unsigned i = 0; i < Cap; i += 2)
+            p.free(t.remove(i));
+
+          for (unsigned i = 0; i < Cap; ++i)
+            CHK((t.search(i) == p.null()) == !(i & 1));
+
+          // Drop the tree and all its nodes.
+          t.purge();
+          p.reset();
+        }
+    }
+
+    thread_test();
+
+    return(0);
+  }
@@ -0,0 +1,326 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Unit testing for open_hash_table.h .
+
+#include "open_hash_table.h"
+#include "open_hash_table.h"
+
+// Put a breakpoint on this function to break after a check fails.
+void bp() { }
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+void check(bool expr, int line)
+  {
+    if (!expr)
+      {
+        std::cout << "*** fail line " << line << std::endl;
+        bp();
+        std::exit(1);
+      }
+  }
+
+#define CHK(EXPR) check((EXPR), __LINE__)
+
+using namespace abstract_container;
+
+const unsigned Num_groups = 4;
+
+struct Elem
+  {
+    unsigned key;
+    bool in_table;
+  };
+
+// More elements than slots.
+const unsigned Num_elem = 60;
+
+Elem e[Num_elem];
+
+// If true, all keys hash to group 0, and there are only 3 distinct tags.
+bool collide;
+
+// Number of calls to is_key().
+unsigned is_key_calls;
+
+// If Small_handle is true, handles are 32-bit indexes, so there are more
+// slots in a group.
+//
+template <bool Small_handle>
+class Abs
+  {
+  protected:
+
+    typedef
+      typename std::conditional<Small_handle, std::uint32_t, Elem *>::type
+      handle;
+    typedef std::uint32_t index;
+    typedef unsigned key;
+
+    static const index num_groups = Num_groups;
+
+    static handle null() { return(to_handle(nullptr)); }
+
+    bool is_key(key k, handle h)
+      { ++is_key_calls; return(to_elem(h)->key == k); }
+
+    index hash_key(key k)
+      {
+        if (collide)
+          return(index(k % 3) << 25);
+
+        return(index(k * 0x9e3779b1u));
+      }
+
+    index hash_elem(handle h) { return(hash_key(to_elem(h)->key)); }
+
+  public:
+
+    static Elem * to_elem(Elem *h) { return(h); }
+
+    static Elem * to_elem(std::uint32_t h)
+      { return(h == ~std::uint32_t(0) ? nullptr : e + h); }
+
+    static handle to_handle(Elem *ep)
+      {
+        return(
+          make_handle(ep, std::integral_constant<bool, Small_handle>()));
+      }
+
+  private:
+
+    static Elem * make_handle(Elem *ep, std::false_type) { return(ep); }
+
+    static std::uint32_t make_handle(Elem *ep, std::true_type)
+      { return(ep ? std::uint32_t(ep - e) : ~std::uint32_t(0)); }
+  };
+
+template <bool Small_handle>
+struct Ht : public open_hash_table<Abs<Small_handle> >
+  {
+    typedef Abs<Small_handle> A;
+
+    using A::to_elem;
+    using A::to_handle;
+
+    // Sum of the overflow counts of all groups.
+    unsigned total_overflow()
+      {
+        unsigned t = 0;
+
+        for (unsigned i = 0; i < Num_groups; ++i)
+          t += this->group_at(i).overflow();
+
+        return(t);
+      }
+  };
+
+Ht<false> ht_big;
+
+Ht<true> ht_small;
+
+// Check if hash table is sane.
+//
+template <class Table>
+void scan(Table &ht)
+  {
+    unsigned cnt = 0;
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        if (e[i].in_table)
+          {
+            ++cnt;
+            CHK(ht.to_elem(ht.search(e[i].key)) == (e + i));
+          }
+        else
+          CHK(ht.search(e[i].key) == Table::null());
+      }
+
+    unsigned icnt = 0;
+
+    for (typename Table::iter it(ht); it; ++it)
+      {
+        ++icnt;
+
+        Elem *ep = ht.to_elem(*it);
+
+        CHK((ep >= e) and (ep < (e + Num_elem)));
+        CHK(ep->in_table);
+      }
+
+    CHK(cnt == icnt);
+
+  } // end scan()
+
+template <class Table>
+void test(Table &ht, bool collide_)
+  {
+    std::cout << (collide_ ? "COLLIDE" : "SPREAD") << std::endl;
+
+    collide = collide_;
+
+    const unsigned Capacity = Num_groups * Table::group::size;
+
+    CHK(ht.capacity() == Capacity);
+    CHK(Capacity < Num_elem);
+
+    ht.purge();
+    for (unsigned i = 0; i < Num_elem; ++i)
+      {
+        e[i].key = i * 5;
+        e[i].in_table = false;
+      }
+    scan(ht);
+
+    // Fill the table.
+    for (unsigned i = 0; i < Capacity; ++i)
+      {
+        CHK(ht.insert(ht.to_handle(e + i)));
+        e[i].in_table = true;
+        scan(ht);
+      }
+
+    CHK(!ht.insert(ht.to_handle(e + Capacity)));
+    scan(ht);
+
+    // Spread keys are evenly divided between the groups.
+    CHK((ht.total_overflow() > 0) == collide);
+
+    // Remove every third, alternating remove() and remove_key().
+    for (unsigned i = 0; i < Capacity; i += 3)
+      {
+        if (i & 1)
+          ht.remove(ht.to_handle(e + i));
+        else
+          CHK(ht.to_elem(ht.remove_key(e[i].key)) == (e + i));
+        e[i].in_table = false;
+        scan(ht);
+      }
+
+    CHK(ht.remove_key(e[0].key) == Table::null());
+
+    // Fill the freed slots with other elements.
+    for (unsigned i = Capacity; i < Num_elem; ++i)
+      {
+        bool ins = ht.insert(ht.to_handle(e + i));
+
+        CHK(ins == ((i - Capacity) < ((Capacity + 2) / 3)));
+        e[i].in_table = ins;
+        scan(ht);
+      }
+
+    for (unsigned i = 0; i < Num_elem; ++i)
+      if (e[i].in_table)
+        {
+          ht.remove(ht.to_handle(e + i));
+          e[i].in_table = false;
+          scan(ht);
+        }
+
+    // Removals undo the overflow counts.
+    CHK(ht.total_overflow() == 0);
+
+    for (unsigned i = 0; i < 5; ++i)
+      {
+        ht.insert(ht.to_handle(e + i));
+        e[i].in_table = true;
+      }
+    scan(ht);
+
+    ht.purge();
+    for (unsigned i = 0; i < 5; ++i)
+      e[i].in_table = false;
+    scan(ht);
+  }
+
+// Compare tag matching (which may be vectorized) to a plain loop.
+//
+template <class Group>
+void match_test()
+  {
+    Group g;
+    unsigned r = 1;
+
+    for (unsigned n = 0; n < 2000; ++n)
+      {
+        for (unsigned i = 0; i < Group::tag_bytes; ++i)
+          {
+            r = r * 1103515245 + 12345;
+
+            // Mostly a few distinct tags, so there are multiple matches.
+            g.tag[i] =
+              std::uint8_t((r >> 16) & 1 ? (r >> 20) & 3 : r >> 24);
+          }
+
+        if (n & 1)
+          g.overflow() = Group::empty;
+
+        unsigned free_m = 0;
+
+        for (unsigned i = 0; i < Group::size; ++i)
+          free_m |= unsigned((g.tag[i] & 0x80) != 0) << i;
+
+        CHK(g.match_free() == free_m);
+
+        for (unsigned t = 0; t < 256; ++t)
+          {
+            unsigned m = 0;
+
+            for (unsigned i = 0; i < Group::size; ++i)
+              m |= unsigned(g.tag[i] == t) << i;
+
+            CHK(g.match(std::uint8_t(t)) == m);
+          }
+      }
+  }
+
+int main()
+  {
+    match_test<Ht<false>::group>();
+    match_test<Ht<true>::group>();
+    match_test<open_hash_group<std::uint16_t> >();
+
+    CHK(sizeof(Ht<false>::group) == 64);
+    CHK(sizeof(Ht<true>::group) == 64);
+    CHK(Ht<true>::group::size > Ht<false>::group::size);
+
+    test(ht_big, false);
+    test(ht_big, true);
+
+    std::cout << "SMALL HANDLES" << std::endl;
+
+    test(ht_small, false);
+    test(ht_small, true);
+
+    // Tags avoid most is_key() calls when keys do not collide.
+    collide = false;
+    for (unsigned i = 0; i < Num_groups; ++i)
+      CHK(ht_big.insert(e + i));
+    is_key_calls = 0;
+    for (unsigned i = 0; i < Num_groups; ++i)
+      CHK(ht_big.search(e[i].key) == (e + i));
+    CHK(is_key_calls < (2 * Num_groups));
+
+    return(0);
+  }